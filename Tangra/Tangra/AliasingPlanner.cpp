@@ -0,0 +1,153 @@
+#include "AliasingPlanner.h"
+
+#include <algorithm>
+
+namespace
+{
+    uint64_t AlignUp(uint64_t a_Value, uint64_t a_Alignment)
+    {
+        return (a_Value + a_Alignment - 1) & ~(a_Alignment - 1);
+    }
+
+    struct MemoryRange
+    {
+        uint64_t m_Begin;
+        uint64_t m_End;
+    };
+
+    // Returns true if the ranges together cover all of [a_Begin, a_End)
+    bool IsCovered(std::vector<MemoryRange> a_Ranges, uint64_t a_Begin, uint64_t a_End)
+    {
+        std::sort(a_Ranges.begin(), a_Ranges.end(), [](const MemoryRange& a_Left, const MemoryRange& a_Right)
+        {
+            return a_Left.m_Begin < a_Right.m_Begin;
+        });
+
+        uint64_t position = a_Begin;
+        for (const MemoryRange& range : a_Ranges)
+        {
+            if (range.m_Begin > position)
+            {
+                break;
+            }
+            position = std::max(position, range.m_End);
+            if (position >= a_End)
+            {
+                return true;
+            }
+        }
+        return position >= a_End;
+    }
+}
+
+size_t AliasingPlanner::AddResource(uint64_t a_Size, uint64_t a_Alignment, size_t a_FirstUse, size_t a_LastUse)
+{
+    m_Resources.push_back({ a_Size, a_Alignment, a_FirstUse, a_LastUse });
+    return m_Resources.size() - 1;
+}
+
+AliasingPlanner::Plan AliasingPlanner::CreatePlan() const
+{
+    Plan plan;
+    plan.m_Placements.resize(m_Resources.size());
+    plan.m_HeapAlignment = 1;
+
+    // Placing the large resources first leaves gaps the small ones can fill
+    std::vector<size_t> order(m_Resources.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a_Left, size_t a_Right)
+    {
+        return m_Resources[a_Left].m_Size > m_Resources[a_Right].m_Size;
+    });
+
+    auto lifetimesOverlap = [this](size_t a_Left, size_t a_Right)
+    {
+        return m_Resources[a_Left].m_FirstUse <= m_Resources[a_Right].m_LastUse && m_Resources[a_Right].m_FirstUse <= m_Resources[a_Left].m_LastUse;
+    };
+
+    std::vector<size_t> placed;
+    for (size_t resourceIndex : order)
+    {
+        const Resource& resource = m_Resources[resourceIndex];
+
+        // Memory taken by the resources which are alive at the same time
+        std::vector<MemoryRange> takenRanges;
+        for (size_t other : placed)
+        {
+            if (lifetimesOverlap(resourceIndex, other))
+            {
+                uint64_t offset = plan.m_Placements[other].m_Offset;
+                takenRanges.push_back({ offset, offset + m_Resources[other].m_Size });
+            }
+        }
+        std::sort(takenRanges.begin(), takenRanges.end(), [](const MemoryRange& a_Left, const MemoryRange& a_Right)
+        {
+            return a_Left.m_Begin < a_Right.m_Begin;
+        });
+
+        // Take the first gap which is large enough
+        uint64_t offset = 0;
+        for (const MemoryRange& range : takenRanges)
+        {
+            if (AlignUp(offset, resource.m_Alignment) + resource.m_Size <= range.m_Begin)
+            {
+                break;
+            }
+            offset = std::max(offset, range.m_End);
+        }
+        offset = AlignUp(offset, resource.m_Alignment);
+
+        plan.m_Placements[resourceIndex].m_Offset = offset;
+        plan.m_HeapSize = std::max(plan.m_HeapSize, offset + resource.m_Size);
+        plan.m_HeapAlignment = std::max(plan.m_HeapAlignment, resource.m_Alignment);
+        plan.m_DedicatedSize += AlignUp(resource.m_Size, resource.m_Alignment);
+        placed.push_back(resourceIndex);
+    }
+
+    // Resources sharing memory with a resource that was used before them need an aliasing barrier, but only from the most recent resource in that memory.
+    // An older one was already replaced, and aliasing from it could activate this resource while the one in between is still in use.
+    for (size_t i = 0; i < m_Resources.size(); i++)
+    {
+        uint64_t begin = plan.m_Placements[i].m_Offset;
+        uint64_t end = begin + m_Resources[i].m_Size;
+
+        std::vector<size_t> earlier;
+        for (size_t other = 0; other < m_Resources.size(); other++)
+        {
+            uint64_t otherBegin = plan.m_Placements[other].m_Offset;
+            uint64_t otherEnd = otherBegin + m_Resources[other].m_Size;
+            bool memoryOverlaps = begin < otherEnd && otherBegin < end;
+            if (other != i && memoryOverlaps && m_Resources[other].m_LastUse < m_Resources[i].m_FirstUse)
+            {
+                earlier.push_back(other);
+            }
+        }
+
+        // Going from the most recent to the oldest, a resource only counts if part of the shared memory isn't covered by a more recent one yet
+        std::stable_sort(earlier.begin(), earlier.end(), [this](size_t a_Left, size_t a_Right)
+        {
+            return m_Resources[a_Left].m_LastUse > m_Resources[a_Right].m_LastUse;
+        });
+        std::vector<MemoryRange> covered;
+        for (size_t other : earlier)
+        {
+            uint64_t overlapBegin = std::max(begin, plan.m_Placements[other].m_Offset);
+            uint64_t overlapEnd = std::min(end, plan.m_Placements[other].m_Offset + m_Resources[other].m_Size);
+            if (!IsCovered(covered, overlapBegin, overlapEnd))
+            {
+                plan.m_Placements[i].m_AliasedResources.push_back(other);
+            }
+            covered.push_back({ overlapBegin, overlapEnd });
+        }
+    }
+
+    return plan;
+}
+
+void AliasingPlanner::Clear()
+{
+    m_Resources.clear();
+}
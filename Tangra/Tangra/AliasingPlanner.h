@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Places resources with known lifetimes in a single heap so resources which are never alive at the same time share memory.
+// Lifetimes are inclusive ranges of steps, like the steps of a render graph schedule. Doesn't depend on D3D12, so plans can be checked on the CPU.
+class AliasingPlanner
+{
+public:
+
+    struct Placement
+    {
+        uint64_t m_Offset = 0;
+        // Resources which were the last to use some of this resource's memory before it. The memory needs an aliasing barrier from each of them
+        // right before this resource is first used. Resources which were followed by another one in the same memory aren't included.
+        std::vector<size_t> m_AliasedResources;
+    };
+
+    struct Plan
+    {
+        std::vector<Placement> m_Placements;
+        // Size and alignment of the heap which holds all the resources
+        uint64_t m_HeapSize = 0;
+        uint64_t m_HeapAlignment = 0;
+        // Memory the resources would take with a dedicated allocation each
+        uint64_t m_DedicatedSize = 0;
+
+        uint64_t GetMemorySaved() const { return m_DedicatedSize - m_HeapSize; }
+    };
+
+    // Add a resource which is used from the first until the last step. The alignment needs to be a power of two. Returns the index of the resource.
+    size_t AddResource(uint64_t a_Size, uint64_t a_Alignment, size_t a_FirstUse, size_t a_LastUse);
+
+    // Place all the resources, largest first, at the lowest offset which doesn't overlap a resource that is alive at the same time
+    Plan CreatePlan() const;
+
+    void Clear();
+private:
+
+    struct Resource
+    {
+        uint64_t m_Size;
+        uint64_t m_Alignment;
+        size_t m_FirstUse;
+        size_t m_LastUse;
+    };
+
+    std::vector<Resource> m_Resources;
+};
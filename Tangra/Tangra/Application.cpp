@@ -2,13 +2,22 @@
 
 #include "GraphicsCommandList.h"
 #include "CommandQueue.h"
+#include "ParallelCommandRecorder.h"
+#include "DeferredReleaseQueue.h"
 #include "Device.h"
+#include "GpuMemoryAllocator.h"
+#include "ResidencyManager.h"
 #include "SwapChain.h"
 #include "PipelineState.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "RenderGraph.h"
+#include "RenderGraphExecutor.h"
+#include "ThreadPool.h"
+#include "UploadManager.h"
 
 #include "ServiceLocator.h"
+#include "ShaderStore.h"
 
 #include "Helpers.h"
 
@@ -18,6 +27,8 @@
 #include <fcntl.h>
 #include <io.h>
 #include <algorithm>
+#include <cmath>
+#include <string>
 #include <d3dcompiler.h>
 
 namespace fs = std::experimental::filesystem;
@@ -103,6 +114,8 @@ void Application::Initialize(InitInfo& a_InitInfo)
     m_ScreenWidth = a_InitInfo.m_Width;
     m_ScreenHeight = a_InitInfo.m_Height;
 
+    m_FramePacer = std::make_unique<FramePacer>(a_InitInfo.m_FramesInFlight);
+
     CreateDXGIFactory();
     auto graphicsAdapter = QueryGraphicsAdapters();
 
@@ -140,13 +153,28 @@ void Application::Initialize(InitInfo& a_InitInfo)
     std::cout << "Working directory set to: " << fs::current_path() << std::endl;
     std::cout << "Creating direct command queue" << std::endl;
 
+    // Maps the compiled shaders once, the working directory needs to be the assets folder already
+    g_ServiceLocator.m_ShaderStore = std::make_unique<ShaderStore>();
+
+    g_ServiceLocator.m_ThreadPool = std::make_unique<ThreadPool>();
+    std::cout << "Created thread pool with " << g_ServiceLocator.m_ThreadPool->GetNumThreads() << " worker threads" << std::endl;
+
+    // The frame's draws are recorded by the calling thread and all the worker threads
+    m_NumDraws = a_InitInfo.m_NumDraws;
+    m_NumDrawJobs = static_cast<uint32_t>(g_ServiceLocator.m_ThreadPool->GetNumThreads() + 1);
+
     g_ServiceLocator.m_Device = std::make_unique<Device>(graphicsAdapter, g_ServiceLocator);
     g_ServiceLocator.m_Device->Initialize();
+    g_ServiceLocator.m_ResidencyManager = std::make_unique<ResidencyManager>(g_ServiceLocator);
+    g_ServiceLocator.m_DeferredReleaseQueue = std::make_unique<DeferredReleaseQueue>(g_ServiceLocator);
+    g_ServiceLocator.m_MemoryAllocator = std::make_unique<GpuMemoryAllocator>(g_ServiceLocator);
     CommandQueue* commandQueue = g_ServiceLocator.m_Device->GetCommandQueue();
+    g_ServiceLocator.m_UploadManager = std::make_unique<UploadManager>(g_ServiceLocator);
+    m_GraphExecutor = std::make_unique<RenderGraphExecutor>(g_ServiceLocator);
 
     g_ServiceLocator.m_SwapChain = std::make_unique<SwapChain>(g_ServiceLocator, m_HWND, a_InitInfo.m_NumBuffers);
-    std::cout << "Creating descriptor heaps" << std::endl;
-    g_ServiceLocator.m_SwapChain->CreateDescriptorHeaps();
+    std::cout << "Allocating swap chain descriptors" << std::endl;
+    g_ServiceLocator.m_SwapChain->AllocateDescriptors();
 
     GraphicsCommandList* commandList = commandQueue->GetCommandList();
 
@@ -157,36 +185,30 @@ void Application::Initialize(InitInfo& a_InitInfo)
     std::cout << "Creating depth stencil buffer" << std::endl;
     g_ServiceLocator.m_SwapChain->CreateDepthStencilBuffer(*commandList);
 
+    // The PSOs compile on the compiler's worker threads while the geometry and textures are loaded
+    std::cout << "Requesting pipeline state objects" << std::endl;
+    m_PipelineCompiler = std::make_unique<PipelineStateCompiler>(g_ServiceLocator);
+    LoadPSOs();
 
-    std::cout << "Creating triangle vertex buffer" << std::endl;
 
-    struct vertex
-    {
-        DirectX::XMFLOAT3 p;
-        DirectX::XMFLOAT2 t;
-    };
+    std::cout << "Creating triangle vertex buffer" << std::endl;
 
-    vertex v1, v2, v3;
-    v1 = vertex{ DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f), DirectX::XMFLOAT2(0.0f, 0.0f) };
-    v2 = vertex{ DirectX::XMFLOAT3(-0.5f, -0.5f, 0.5f), DirectX::XMFLOAT2(1.0f, 1.0f) };
-    v3 = vertex{ DirectX::XMFLOAT3(-0.5f, 0.5f, 0.5f) , DirectX::XMFLOAT2(1.0f, 0.0f) };
+    Vertex v1, v2, v3;
+    v1 = Vertex{ DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f), DirectX::XMFLOAT2(0.0f, 0.0f) };
+    v2 = Vertex{ DirectX::XMFLOAT3(-0.5f, -0.5f, 0.5f), DirectX::XMFLOAT2(1.0f, 1.0f) };
+    v3 = Vertex{ DirectX::XMFLOAT3(-0.5f, 0.5f, 0.5f) , DirectX::XMFLOAT2(1.0f, 0.0f) };
 
-    std::vector<vertex> vertices = { v1, v2, v3 };
+    // The vertex shader reads the vertices from a structured buffer, so they are kept around to bind them every frame
+    m_TriangleVertices = { v1, v2, v3 };
     std::vector<UINT> indices = { 0, 1, 2 };
     //std::reverse(vertices.begin(), vertices.end());
-    //m_Buffer = std::make_unique<VertexBuffer>(g_ServiceLocator, vertices, *commandList);
-    m_Buffer = commandList->CreateVertexBuffer(vertices);
-
-    //m_IndexBuffer = std::make_unique<IndexBuffer>(g_ServiceLocator, indices, *commandList);
-    m_IndexBuffer = commandList->CreateIndexBuffer(indices);
+    m_GeometryPool = std::make_unique<GeometryPool>(g_ServiceLocator);
+    m_TriangleMesh = m_GeometryPool->AddMesh(*commandList, m_TriangleVertices, indices);
 
     std::wstring path = L"Textures/debugTex.png";
 
     m_Texture = commandList->CreateTextureFromFilePath(path);
 
-    std::cout << "Creating pipeline state object" << std::endl;
-    LoadPSOs();
-
 
     m_Viewport.TopLeftX = 0.0f;
     m_Viewport.TopLeftY = 0.0f;
@@ -205,6 +227,14 @@ void Application::Initialize(InitInfo& a_InitInfo)
     commandQueue->ExecuteCommandList(*commandList);
     commandQueue->Flush();
 
+    // Waiting for the startup PSOs here keeps the first frames from skipping their draws
+    FinishLoadingPSOs();
+
+    if (a_InitInfo.m_RunRecordingBenchmark)
+    {
+        RunRecordingBenchmark(10000);
+    }
+
     std::cout << "Initialization completed." << std::endl;
     ::ShowWindow(m_HWND, SW_SHOW);
 
@@ -289,6 +319,21 @@ Application::Application()
     m_ScreenHeight = 0;
     m_ScreenWidth = 0;
     m_HWND = NULL;
+    m_MainPSO = PipelineStateCompiler::s_InvalidPipeline;
+    m_UseBindlessTextures = true;
+    m_NumDraws = 0;
+    m_NumDrawJobs = 1;
+}
+
+Application::~Application()
+{
+    // The textures, meshes and pools are released after this, the queues need to be idle by then
+    if (g_ServiceLocator.m_Device)
+    {
+        g_ServiceLocator.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)->Flush();
+        g_ServiceLocator.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE)->Flush();
+        g_ServiceLocator.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY)->Flush();
+    }
 }
 
 void Application::CreateDebugConsole()
@@ -391,14 +436,26 @@ void Application::LoadPSOs()
         D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
 
-    CD3DX12_DESCRIPTOR_RANGE descriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 1);
+    // The pixel shader reads its texture from an unbounded table over the whole shader visible heap, indexed with a root constant.
+    // Unbounded tables need resource binding tier 2, on tier 1 every draw binds a table with just its texture instead.
+    m_UseBindlessTextures = g_ServiceLocator.m_Device->GetResourceBindingTier() >= D3D12_RESOURCE_BINDING_TIER_2;
+    // Textures are created and freed while the heap is bound, so the descriptors are volatile. Texture data is uploaded before the lists which read it run.
+    CD3DX12_DESCRIPTOR_RANGE1 descriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, m_UseBindlessTextures ? UINT_MAX : 1, 0, 2,
+        D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, 0);
+    if (!m_UseBindlessTextures)
+    {
+        std::cout << "Resource binding tier 1, textures are bound per draw instead of through the bindless table." << std::endl;
+    }
 
     initData.m_RootParameters.emplace_back();
     initData.m_RootParameters.back().InitAsConstants(sizeof(DirectX::XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
     initData.m_RootParameters.emplace_back();
     initData.m_RootParameters.back().InitAsDescriptorTable(1u, &descriptorRange, D3D12_SHADER_VISIBILITY_PIXEL);
     initData.m_RootParameters.emplace_back();
-    initData.m_RootParameters.back().InitAsShaderResourceView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+    // The vertices are written to dynamic upload memory before the list is submitted and don't change while it runs
+    initData.m_RootParameters.back().InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
+    initData.m_RootParameters.emplace_back();
+    initData.m_RootParameters.back().InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 
     initData.m_StaticSamplers.emplace_back();
     initData.m_StaticSamplers.back().RegisterSpace = 1;
@@ -441,11 +498,156 @@ void Application::LoadPSOs()
 
     initData.m_DSVFormat = g_ServiceLocator.m_SwapChain->GetDepthStencilFormat();
     initData.m_VertexShaderPath = L"ShaderCSOs/VertexShader.cso";
-    initData.m_PixelShaderPath = L"ShaderCSOs/PixelShader.cso";
+    initData.m_PixelShaderPath = m_UseBindlessTextures ? L"ShaderCSOs/PixelShader.cso" : L"ShaderCSOs/PixelShaderSingleTexture.cso";
     initData.m_PrimitiveTopology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     initData.m_RTVFormats.push_back(g_ServiceLocator.m_SwapChain->GetBackBufferFormat());
 
-    m_MainPSO = std::make_unique<PipelineState>(initData, g_ServiceLocator);
+    m_MainPSO = m_PipelineCompiler->RequestPipelineState(initData);
+}
+
+void Application::FinishLoadingPSOs()
+{
+    m_PipelineCompiler->WaitForAll();
+
+    // Store newly compiled pipelines right away, instead of only when the application shuts down cleanly
+    PipelineStateCache& pipelineCache = g_ServiceLocator.m_Device->GetPipelineStateCache();
+    pipelineCache.Save();
+
+    // A warm start loads the pipelines compiled by an earlier run, a cold start has to compile them all.
+    // The latency runs from the request until the PSO was ready, which includes the time spent waiting for a worker thread.
+    PipelineStateCache::Statistics cacheStats = pipelineCache.GetStatistics();
+    PipelineStateCompiler::Statistics compilerStats = m_PipelineCompiler->GetStatistics();
+    std::cout << (cacheStats.m_LibraryLoadedFromDisk ? "Warm" : "Cold") << " pipeline state startup: "
+        << compilerStats.m_NumCompleted << " ready after at most " << compilerStats.m_MaxLatencyMilliseconds << " ms, "
+        << cacheStats.m_NumLibraryHits << " loaded from the pipeline library in " << cacheStats.m_LoadMilliseconds << " ms, "
+        << cacheStats.m_NumCompiled << " compiled in " << cacheStats.m_CompileMilliseconds << " ms" << std::endl;
+    if (compilerStats.m_NumFailed > 0)
+    {
+        std::cout << "ERROR: " << compilerStats.m_NumFailed << " pipeline states failed to compile." << std::endl;
+    }
+}
+
+void Application::RecordDraws(GraphicsCommandList& a_CommandList, uint32_t a_FirstDraw, uint32_t a_NumDraws, uint32_t a_TotalDraws, float a_Rotation)
+{
+    namespace sm = DirectX::SimpleMath;
+
+    // Every pass has its own command list, so the pipeline state needs to be set up for each of them
+    if (!SetupDrawState(a_CommandList))
+    {
+        return;
+    }
+
+    a_CommandList.SetStructuredBuffer(2, m_TriangleVertices);
+    if (m_UseBindlessTextures)
+    {
+        UINT textureIndex = a_CommandList.UseBindlessTexture(m_Texture);
+        a_CommandList.SetRoot32BitConstant(3, textureIndex);
+    }
+    else
+    {
+        a_CommandList.SetTexture(1, m_Texture);
+    }
+
+    // The triangles are laid out in a grid which fills the screen, small enough to not overlap while they rotate
+    uint32_t numColumns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(a_TotalDraws))));
+    uint32_t numRows = (a_TotalDraws + numColumns - 1) / numColumns;
+    float cellSize = std::min(float(m_ScreenWidth) / numColumns, float(m_ScreenHeight) / numRows);
+
+    sm::Matrix projection = sm::Matrix::CreateOrthographic(float(m_ScreenWidth), float(m_ScreenHeight), 0.00001f, 100000.0f);
+    sm::Matrix rotation = sm::Matrix::CreateRotationZ(DirectX::XMConvertToRadians(a_Rotation));
+    sm::Matrix scale = sm::Matrix::CreateScale(sm::Vector3(0.7f * cellSize));
+
+    for (uint32_t draw = a_FirstDraw; draw < a_FirstDraw + a_NumDraws; draw++)
+    {
+        float x = -1.0f + (float(draw % numColumns) + 0.5f) * 2.0f / numColumns;
+        float y = 1.0f - (float(draw / numColumns) + 0.5f) * 2.0f / numRows;
+        sm::Matrix mat = projection * rotation * scale * sm::Matrix::CreateTranslation(sm::Vector3(x, y, 0.0f));
+
+        a_CommandList.SetRoot32BitConstant(0, mat);
+        m_GeometryPool->DrawMesh(a_CommandList, m_TriangleMesh);
+    }
+}
+
+void Application::RunRecordingBenchmark(uint32_t a_NumDraws)
+{
+    CommandQueue* directQueue = g_ServiceLocator.m_Device->GetCommandQueue();
+    ParallelCommandRecorder recorder(g_ServiceLocator, *directQueue);
+    const RenderResource& backBuffer = g_ServiceLocator.m_SwapChain->GetCurrentBackBuffer();
+    const RenderResource& depthBuffer = g_ServiceLocator.m_SwapChain->GetDepthStencilBuffer();
+
+    const uint32_t numIterations = 10;
+    const size_t maxJobs = g_ServiceLocator.m_ThreadPool->GetNumThreads() + 1;
+    double singleJobTime = 0.0;
+
+    std::cout << "Recording benchmark: " << a_NumDraws << " draws, " << numIterations << " iterations per job count" << std::endl;
+    for (size_t numJobs = 1; ; numJobs = std::min(numJobs * 2, maxJobs))
+    {
+        // The first iteration creates the command lists and pages the later ones reuse, so it isn't timed
+        double totalTime = 0.0;
+        for (uint32_t iteration = 0; iteration <= numIterations; iteration++)
+        {
+            for (size_t job = 0; job < numJobs; job++)
+            {
+                uint32_t firstDraw = static_cast<uint32_t>(a_NumDraws * job / numJobs);
+                uint32_t numDraws = static_cast<uint32_t>(a_NumDraws * (job + 1) / numJobs) - firstDraw;
+                recorder.AddJob([this, &backBuffer, &depthBuffer, firstDraw, numDraws, a_NumDraws](GraphicsCommandList& a_CommandList)
+                {
+                    a_CommandList.TransitionResource(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+                    a_CommandList.TransitionResource(depthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+                    RecordDraws(a_CommandList, firstDraw, numDraws, a_NumDraws, 0.0f);
+                });
+            }
+
+            std::vector<GraphicsCommandList*> commandLists = recorder.Record();
+            if (iteration > 0)
+            {
+                totalTime += recorder.GetLastRecordingTime();
+            }
+
+            // Waiting keeps the GPU from competing with the recording of the next iteration
+            directQueue->ExecuteCommandLists(commandLists);
+            directQueue->Flush();
+        }
+
+        double averageTime = totalTime / numIterations;
+        if (numJobs == 1)
+        {
+            singleJobTime = averageTime;
+        }
+        std::cout << "  " << numJobs << " jobs: " << averageTime << " ms, speedup " << singleJobTime / averageTime << "x" << std::endl;
+
+        if (numJobs == maxJobs)
+        {
+            break;
+        }
+    }
+
+    // The frames expect the back buffer in the present state
+    GraphicsCommandList* commandList = directQueue->GetCommandList();
+    commandList->TransitionResource(backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+    directQueue->ExecuteCommandList(*commandList);
+    directQueue->Flush();
+}
+
+bool Application::SetupDrawState(GraphicsCommandList& a_CommandList)
+{
+    PipelineState* pipelineState = m_PipelineCompiler->GetPipelineState(m_MainPSO);
+    if (pipelineState == nullptr)
+    {
+        return false;
+    }
+
+    a_CommandList.SetPipelineState(*pipelineState);
+    a_CommandList.SetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    a_CommandList.SetViewport(m_Viewport);
+    a_CommandList.SetScissorRect(m_ScissorRect);
+    a_CommandList.SetRenderTargets(std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>{g_ServiceLocator.m_SwapChain->GetCurrentRTVHandle()}, TRUE, g_ServiceLocator.m_SwapChain->GetDSVHandle());
+    m_GeometryPool->SetBuffers(a_CommandList, m_TriangleMesh);
+    if (m_UseBindlessTextures)
+    {
+        a_CommandList.SetBindlessTextureTable(1);
+    }
+    return true;
 }
 
 void Application::Render()
@@ -455,62 +657,58 @@ void Application::Render()
 
 
     auto directCommandQueue = g_ServiceLocator.m_Device->GetCommandQueue();
-    // for simplicity, use a single command list for clearing, drawing and presenting
-    auto commandList = directCommandQueue->GetCommandList();
-    
-    g_ServiceLocator.m_SwapChain->ClearBackBuffer(*commandList);
-    g_ServiceLocator.m_SwapChain->ClearDSV(*commandList);
-
-    auto srvHeap = g_ServiceLocator.m_Device->GetSRVHeap().Get();
-       
-    commandList->SetPipelineState(*m_MainPSO);
-    commandList->SetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    commandList->SetViewport(m_Viewport);
-    commandList->SetScissorRect(m_ScissorRect);
-    commandList->SetRenderTargets(std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>{g_ServiceLocator.m_SwapChain->GetCurrentRTVHandle()}, TRUE, g_ServiceLocator.m_SwapChain->GetDSVHandle());
-    commandList->SetVertexBuffer(m_Buffer);
-    commandList->SetIndexBuffer(m_IndexBuffer);
-    commandList->SetDescriptorHeap(srvHeap);
-    commandList->SetTexture(1, m_Texture);
 
-    namespace sm = DirectX::SimpleMath;
+    // Only wait for the frame which last used this frame's context, so the CPU can stay a few frames ahead of the GPU
+    directCommandQueue->WaitForFenceValue(m_FramePacer->BeginFrame());
 
-    sm::Matrix mat;
+    // Stream in queued uploads within the frame's budget
+    g_ServiceLocator.m_UploadManager->ProcessUploads();
+    // Free the resources which were dropped in earlier frames and are no longer used by the GPU
+    g_ServiceLocator.m_DeferredReleaseQueue->ReleaseCompleted();
 
     static float f = 0.0f;
     f += 3.0f;
 
-    mat = sm::Matrix::Identity;
-
-    mat *= sm::Matrix::CreateOrthographic(float(m_ScreenWidth), float(m_ScreenHeight), 0.00001f, 100000.0f);
-    //mat *= sm::Matrix::CreateTranslation(sm::Vector3(0.0f, 0.0f, 0.0f));
-    mat *= sm::Matrix::CreateRotationZ(DirectX::XMConvertToRadians(f));
-    //mat *= sm::Matrix::CreateRotationY(180.0f);
-    mat *= sm::Matrix::CreateScale(sm::Vector3(400.0f));
+    // The passes only declare what they use, the graph works out the order, the transitions and the present transition at the end
+    using Usage = RenderGraph::ResourceUsage;
+    RenderGraph graph;
+    RenderGraph::ResourceHandle backBuffer = graph.ImportResource("Back Buffer", Usage::Present, Usage::Present);
+    RenderGraph::ResourceHandle depthBuffer = graph.ImportResource("Depth Buffer", Usage::DepthWrite, Usage::DepthWrite);
 
-    struct vertex
+    graph.AddPass("Clear", RenderGraph::PassType::Graphics, [](GraphicsCommandList& a_CommandList)
     {
-        DirectX::XMFLOAT3 p;
-        DirectX::XMFLOAT2 t;
-    };
-
-    vertex v1, v2, v3;
-    v1 = vertex{ DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f), DirectX::XMFLOAT2(0.0f, 0.0f) };
-    v2 = vertex{ DirectX::XMFLOAT3(-0.5f, -0.5f, 0.5f), DirectX::XMFLOAT2(1.0f, 1.0f) };
-    v3 = vertex{ DirectX::XMFLOAT3(-0.5f, 0.5f, 0.5f) , DirectX::XMFLOAT2(1.0f, 0.0f) };
+        g_ServiceLocator.m_SwapChain->ClearBackBuffer(a_CommandList);
+        g_ServiceLocator.m_SwapChain->ClearDSV(a_CommandList);
+    })
+        .Write(backBuffer, Usage::RenderTarget)
+        .Write(depthBuffer, Usage::DepthWrite);
+
+    // Every pass is recorded as its own job, so splitting the draws over the passes records them on all the cores
+    for (uint32_t job = 0; job < m_NumDrawJobs; job++)
+    {
+        uint32_t firstDraw = m_NumDraws * job / m_NumDrawJobs;
+        uint32_t numDraws = m_NumDraws * (job + 1) / m_NumDrawJobs - firstDraw;
+        if (numDraws == 0)
+        {
+            continue;
+        }
 
-    std::vector<vertex> vertices = { v1, v2, v3 };
+        float rotation = f;
+        graph.AddPass("Triangles " + std::to_string(job), RenderGraph::PassType::Graphics, [this, firstDraw, numDraws, rotation](GraphicsCommandList& a_CommandList)
+        {
+            RecordDraws(a_CommandList, firstDraw, numDraws, m_NumDraws, rotation);
+        })
+            .Write(backBuffer, Usage::RenderTarget)
+            .Write(depthBuffer, Usage::DepthWrite);
+    }
 
-    commandList->SetRoot32BitConstant(0, mat);
-    commandList->SetStructuredBuffer(2, vertices);
-    //commandList->GetCommandListPtr()->SetGraphicsRoot32BitConstants(0, sizeof(mat) / 4, &mat, 0);
-    
-    commandList->DrawIndexed(m_IndexBuffer.GetNumIndices());
+    m_GraphExecutor->BindResource(backBuffer, g_ServiceLocator.m_SwapChain->GetCurrentBackBuffer());
+    m_GraphExecutor->BindResource(depthBuffer, g_ServiceLocator.m_SwapChain->GetDepthStencilBuffer());
 
-    directCommandQueue->ExecuteCommandList(*commandList);
+    // Remember when the frame's work finishes so the context is not reused before that
+    m_FramePacer->EndFrame(m_GraphExecutor->Execute(graph));
 
     g_ServiceLocator.m_SwapChain->Present();
-
 }
 
 LRESULT WindowsCallback(HWND a_HWND, UINT a_Message, WPARAM a_WParam, LPARAM a_LParam)
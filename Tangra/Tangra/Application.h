@@ -1,14 +1,19 @@
 #pragma once
 #include <memory>
+#include <vector>
 
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
 #include "wrl.h"
 #include "d3d12.h"
 #include "dxgi1_6.h"
+#include "DirectXMath.h"
 #include "Texture.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "GeometryPool.h"
+#include "PipelineStateCompiler.h"
+#include "FramePacer.h"
 
 #ifdef max
 #undef max
@@ -25,6 +30,8 @@ class SwapChain;
 class VertexBuffer;
 class PipelineState;
 class IndexBuffer;
+class GraphicsCommandList;
+class RenderGraphExecutor;
 
 LRESULT CALLBACK WindowsCallback(HWND a_HWND, UINT a_Message, WPARAM a_WParam, LPARAM a_LParam);
 
@@ -41,8 +48,15 @@ public:
         uint32_t m_Width = 0;
         uint32_t m_Height = 0;
         uint8_t m_NumBuffers = 2;
+        // Maximum number of frames the CPU is allowed to record ahead of the GPU
+        uint8_t m_FramesInFlight = 2;
 
         bool m_CreateDebugConsole = true;
+
+        // Number of triangles drawn every frame, split over one recording job per core
+        uint32_t m_NumDraws = 256;
+        // Print how long recording thousands of draws takes with a growing number of jobs before the first frame
+        bool m_RunRecordingBenchmark = false;
     };
 
     // Application creation is done via a static function due to the dependency of DirectX 12 on WndProc
@@ -51,6 +65,9 @@ public:
 
     static void Run();
 
+    // Waits for the GPU, so the resources the application owns can be released right away
+    ~Application();
+
     // Called in the WindowsCallback to process the events
     LRESULT ProcessCallback(HWND a_HWND, UINT a_Message, WPARAM a_WParam, LPARAM a_LParam);
 
@@ -64,6 +81,12 @@ public:
 
 private:
 
+    struct Vertex
+    {
+        DirectX::XMFLOAT3 m_Position;
+        DirectX::XMFLOAT2 m_TexCoord;
+    };
+
     struct WindowInfo
     {
         HINSTANCE m_HInstance = NULL;
@@ -85,8 +108,18 @@ private:
     // Gets the graphics adapter with the most dedicated VRAM
     Microsoft::WRL::ComPtr<IDXGIAdapter4> QueryGraphicsAdapters();
 
-    // Function to hide the code used for creation of the PSOs since currently it's very bulky
+    // Function to hide the code used for creation of the PSOs since currently it's very bulky. The PSOs are requested from the compiler and compile in the background.
     void LoadPSOs();
+    // Wait for the PSOs requested at startup, save the pipeline library and report how long the PSOs took
+    void FinishLoadingPSOs();
+
+    // Set the pipeline state, render targets and bindings shared by all the draws of the frame.
+    // Returns false if the pipeline state hasn't compiled yet and has no fallback, in which case the draws should be skipped.
+    bool SetupDrawState(GraphicsCommandList& a_CommandList);
+    // Record a range of the draws of the triangle grid. The total number of draws decides the layout of the grid.
+    void RecordDraws(GraphicsCommandList& a_CommandList, uint32_t a_FirstDraw, uint32_t a_NumDraws, uint32_t a_TotalDraws, float a_Rotation);
+    // Record the draws with 1, 2, 4 and so on up to one job per core, and print the average recording time and speedup of every job count
+    void RunRecordingBenchmark(uint32_t a_NumDraws);
 
     void Render();
 
@@ -97,15 +130,30 @@ private:
     // d3d12 objects
     Microsoft::WRL::ComPtr<IDXGIFactory1> m_DXGIFactory;
 
-    VertexBuffer m_Buffer;
-    IndexBuffer m_IndexBuffer;
+    // Holds the geometry of all the meshes, so meshes with the same vertex format share their buffers
+    std::unique_ptr<GeometryPool> m_GeometryPool;
+    GeometryPool::MeshHandle m_TriangleMesh;
+    std::vector<Vertex> m_TriangleVertices;
     Texture m_Texture;
 
-    std::unique_ptr<PipelineState> m_MainPSO;
+    // Compiles the PSOs on its own worker threads, draws look up their PSO through its handle
+    std::unique_ptr<PipelineStateCompiler> m_PipelineCompiler;
+    PipelineStateCompiler::PipelineHandle m_MainPSO;
+    // False on resource binding tier 1, where the draws bind their texture with SetTexture instead of indexing the bindless table
+    bool m_UseBindlessTextures;
+
+    // Records the passes of the frame's render graph on the worker threads and submits them
+    std::unique_ptr<RenderGraphExecutor> m_GraphExecutor;
+    uint32_t m_NumDraws;
+    // Number of passes the draws are split over, every pass is recorded as a separate job
+    uint32_t m_NumDrawJobs;
 
     RECT m_ScissorRect;
     D3D12_VIEWPORT m_Viewport;
 
+    // Limits the number of frames in flight with the fence values of the direct queue
+    std::unique_ptr<FramePacer> m_FramePacer;
+
     HWND m_HWND;
 };
 
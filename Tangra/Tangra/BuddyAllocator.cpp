@@ -0,0 +1,122 @@
+#include "BuddyAllocator.h"
+
+#include <algorithm>
+
+const uint64_t BuddyAllocator::s_InvalidOffset;
+
+BuddyAllocator::BuddyAllocator(uint64_t a_Size, uint64_t a_MinBlockSize)
+    : m_Size(a_Size)
+    , m_MinBlockSize(a_MinBlockSize)
+{
+    // The whole range starts out as a single free block of the highest order
+    m_FreeBlocks.resize(GetOrder(a_Size) + 1);
+    m_FreeBlocks.back().insert(0);
+}
+
+uint64_t BuddyAllocator::Allocate(uint64_t a_Size, uint64_t a_Alignment)
+{
+    // Blocks are aligned to their size, so a block at least as large as the alignment is aligned as well
+    uint64_t size = std::max(a_Size, a_Alignment);
+    if (size > m_Size)
+    {
+        return s_InvalidOffset;
+    }
+
+    size_t order = GetOrder(size);
+    size_t freeOrder = order;
+    while (freeOrder < m_FreeBlocks.size() && m_FreeBlocks[freeOrder].empty())
+    {
+        freeOrder++;
+    }
+    if (freeOrder == m_FreeBlocks.size())
+    {
+        return s_InvalidOffset;
+    }
+
+    uint64_t offset = *m_FreeBlocks[freeOrder].begin();
+    m_FreeBlocks[freeOrder].erase(m_FreeBlocks[freeOrder].begin());
+
+    // Split the block until it has the right size, keeping the lower half and freeing the upper half every time
+    while (freeOrder > order)
+    {
+        freeOrder--;
+        m_FreeBlocks[freeOrder].insert(offset + GetBlockSize(freeOrder));
+    }
+
+    m_AllocatedBlocks[offset] = order;
+    m_AllocatedSize += GetBlockSize(order);
+    return offset;
+}
+
+void BuddyAllocator::Free(uint64_t a_Offset)
+{
+    auto allocatedBlock = m_AllocatedBlocks.find(a_Offset);
+    if (allocatedBlock == m_AllocatedBlocks.end())
+    {
+        return;
+    }
+
+    size_t order = allocatedBlock->second;
+    m_AllocatedBlocks.erase(allocatedBlock);
+    m_AllocatedSize -= GetBlockSize(order);
+
+    // Merge with the buddy for as long as it is free too
+    uint64_t offset = a_Offset;
+    while (order + 1 < m_FreeBlocks.size())
+    {
+        uint64_t buddy = offset ^ GetBlockSize(order);
+        auto freeBuddy = m_FreeBlocks[order].find(buddy);
+        if (freeBuddy == m_FreeBlocks[order].end())
+        {
+            break;
+        }
+
+        m_FreeBlocks[order].erase(freeBuddy);
+        offset = std::min(offset, buddy);
+        order++;
+    }
+
+    m_FreeBlocks[order].insert(offset);
+}
+
+uint64_t BuddyAllocator::GetSize() const
+{
+    return m_Size;
+}
+
+uint64_t BuddyAllocator::GetAllocatedSize() const
+{
+    return m_AllocatedSize;
+}
+
+uint64_t BuddyAllocator::GetLargestFreeBlockSize() const
+{
+    for (size_t order = m_FreeBlocks.size(); order > 0; order--)
+    {
+        if (!m_FreeBlocks[order - 1].empty())
+        {
+            return GetBlockSize(order - 1);
+        }
+    }
+    return 0;
+}
+
+size_t BuddyAllocator::GetNumAllocations() const
+{
+    return m_AllocatedBlocks.size();
+}
+
+size_t BuddyAllocator::GetOrder(uint64_t a_Size) const
+{
+    size_t order = 0;
+    while (GetBlockSize(order) < a_Size)
+    {
+        order++;
+    }
+    return order;
+}
+
+uint64_t BuddyAllocator::GetBlockSize(size_t a_Order) const
+{
+    return m_MinBlockSize << a_Order;
+}
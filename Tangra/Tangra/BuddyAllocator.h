@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Hands out power of two blocks of a range of memory. Freed blocks merge with their buddy again, so the range doesn't fragment over time.
+// Only does the bookkeeping, so it can be used for any memory and checked without a GPU. Not thread-safe.
+class BuddyAllocator
+{
+public:
+    static const uint64_t s_InvalidOffset = UINT64_MAX;
+
+    // Both sizes need to be powers of two
+    BuddyAllocator(uint64_t a_Size, uint64_t a_MinBlockSize);
+
+    // Returns the offset of a block which fits the size, aligned to the alignment, or s_InvalidOffset if no block is free.
+    // The alignment needs to be a power of two.
+    uint64_t Allocate(uint64_t a_Size, uint64_t a_Alignment = 1);
+    // Free the block at the offset, which needs to have been returned by Allocate
+    void Free(uint64_t a_Offset);
+
+    uint64_t GetSize() const;
+    // Size of all the allocated blocks, including the space lost to rounding up to a power of two
+    uint64_t GetAllocatedSize() const;
+    uint64_t GetLargestFreeBlockSize() const;
+    size_t GetNumAllocations() const;
+private:
+
+    // Returns the order of the smallest block which fits the size
+    size_t GetOrder(uint64_t a_Size) const;
+    uint64_t GetBlockSize(size_t a_Order) const;
+
+    uint64_t m_Size;
+    uint64_t m_MinBlockSize;
+
+    // Free blocks of every order, ordered by offset so the lowest ones are used first
+    std::vector<std::set<uint64_t>> m_FreeBlocks;
+    // Order of every allocated block by offset
+    std::unordered_map<uint64_t, size_t> m_AllocatedBlocks;
+
+    uint64_t m_AllocatedSize = 0;
+};
@@ -0,0 +1,52 @@
+#include "CommandAllocatorPool.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include <string>
+
+using namespace Microsoft::WRL;
+
+CommandAllocatorPool::CommandAllocatorPool(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type)
+    : m_Services(a_ServiceLocator)
+    , m_Type(a_Type)
+{
+}
+
+ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::RequestAllocator(uint64_t a_CompletedFenceValue)
+{
+    ++m_Statistics.m_NumRequests;
+
+    ComPtr<ID3D12CommandAllocator> allocator;
+
+    // Allocators are returned in submission order, so only the oldest one needs to be checked
+    if (!m_InFlightAllocators.empty() && m_InFlightAllocators.front().first <= a_CompletedFenceValue)
+    {
+        allocator = m_InFlightAllocators.front().second;
+        m_InFlightAllocators.pop();
+
+        // The GPU is done with the commands, so the memory can be reused for the next recording
+        ThrowIfFailed(allocator->Reset());
+        ++m_Statistics.m_NumReuseHits;
+    }
+    else
+    {
+        ThrowIfFailed(m_Services.m_Device->GetDeviceObject()->CreateCommandAllocator(m_Type, IID_PPV_ARGS(&allocator)));
+        ++m_Statistics.m_NumAllocators;
+        allocator->SetName((std::wstring(L"Command Allocator ") + std::to_wstring(m_Statistics.m_NumAllocators)).c_str());
+    }
+
+    m_Statistics.m_NumInFlight = m_InFlightAllocators.size();
+    return allocator;
+}
+
+void CommandAllocatorPool::ReturnAllocator(ComPtr<ID3D12CommandAllocator> a_Allocator, uint64_t a_FenceValue)
+{
+    m_InFlightAllocators.emplace(a_FenceValue, a_Allocator);
+    m_Statistics.m_NumInFlight = m_InFlightAllocators.size();
+}
+
+const CommandAllocatorPool::Statistics& CommandAllocatorPool::GetStatistics() const
+{
+    return m_Statistics;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <queue>
+#include <utility>
+
+struct ServiceLocator;
+
+// Pool of command allocators owned by a command queue.
+// Allocators are handed back with the fence value of the submission that used them and are only reset and reused once that value is reached.
+class CommandAllocatorPool
+{
+public:
+
+    struct Statistics
+    {
+        // Number of allocators created by the pool
+        size_t m_NumAllocators = 0;
+        // Number of allocators currently waiting for the GPU to finish with them
+        size_t m_NumInFlight = 0;
+        // Total number of allocator requests
+        uint64_t m_NumRequests = 0;
+        // Number of requests which were served with a recycled allocator
+        uint64_t m_NumReuseHits = 0;
+    };
+
+    CommandAllocatorPool(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type);
+
+    // Returns an allocator that is ready to record into. Reuses the oldest returned allocator if its fence value has been reached.
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> RequestAllocator(uint64_t a_CompletedFenceValue);
+    // Hand an allocator back to the pool. It will not be reused until the fence has reached the specified value.
+    void ReturnAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> a_Allocator, uint64_t a_FenceValue);
+
+    const Statistics& GetStatistics() const;
+private:
+    ServiceLocator& m_Services;
+
+    D3D12_COMMAND_LIST_TYPE m_Type;
+
+    // Allocators which have been returned, ordered by the fence value they are waiting for
+    std::queue<std::pair<uint64_t, Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>> m_InFlightAllocators;
+
+    Statistics m_Statistics;
+};
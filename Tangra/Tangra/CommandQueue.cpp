@@ -1,9 +1,12 @@
 #include "CommandQueue.h"
 #include "Helpers.h"
 #include "Application.h"
+#include "DeferredReleaseQueue.h"
 #include "Device.h"
 #include "GraphicsCommandList.h"
+#include "ResidencyManager.h"
 #include "ServiceLocator.h"
+#include "UploadManager.h"
 
 
 #include <iostream>
@@ -13,6 +16,9 @@ using namespace Microsoft::WRL;
 CommandQueue::CommandQueue(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type, D3D12_COMMAND_QUEUE_FLAGS a_Flags)
     : m_Services(a_ServiceLocator)
     , m_Type(a_Type)
+    , m_AllocatorPool(a_ServiceLocator, a_Type)
+    , m_DynamicPagePool(a_ServiceLocator)
+    , m_DescriptorPagePool(a_ServiceLocator)
 {
     D3D12_COMMAND_QUEUE_DESC commandQueueDesc;
     commandQueueDesc.Type = a_Type;
@@ -25,12 +31,16 @@ CommandQueue::CommandQueue(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_
     ThrowIfFailed(device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&m_D3D12CommandQueue)));
 
     m_FenceValue = 0;
+    m_CompletedFenceValue = 0;
     ThrowIfFailed(device->CreateFence(m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_D3D12Fence)));
 }
 
 CommandQueue::~CommandQueue()
 {
-
+    for (HANDLE waitEvent : m_WaitEvents)
+    {
+        CloseHandle(waitEvent);
+    }
 }
 
 ComPtr<ID3D12CommandQueue> CommandQueue::GetCommandQueueObject()
@@ -38,73 +48,446 @@ ComPtr<ID3D12CommandQueue> CommandQueue::GetCommandQueueObject()
     return m_D3D12CommandQueue;
 }
 
+ComPtr<ID3D12Fence1> CommandQueue::GetFenceObject()
+{
+    return m_D3D12Fence;
+}
+
 GraphicsCommandList* CommandQueue::GetCommandList()
 {
-    // Check if any of the used command lists have been finished based on the fence's completed value
-    while (!m_UsedCommandLists.empty())
-    {
-        UINT64 completedValue = m_D3D12Fence->GetCompletedValue();
-        // If the command list has been executed completely, reset it and move it to the list of available lists
-        if (m_UsedCommandLists.front()->GetFenceValue() <= completedValue)
-        {
-            GraphicsCommandList* cmdList = m_UsedCommandLists.front();
-            m_UsedCommandLists.pop();
+    std::lock_guard<std::mutex> lock(m_Mutex);
 
-            cmdList->Reset();
-            m_AvailableCommandLists.push(cmdList);
-        }
-        else break;
-    }
+    uint64_t completedValue = UpdateCompletedFenceValue();
+    ReleaseCompletedIntermediateBuffers(completedValue);
+    m_DynamicPagePool.RecycleCompletedPages(completedValue);
+    m_DescriptorPagePool.RecycleCompletedPages(completedValue);
+
+    ComPtr<ID3D12CommandAllocator> allocator = m_AllocatorPool.RequestAllocator(completedValue);
 
-    // If there are no available command lists, create a new one
+    // If there are no available command lists, create a new one. It is created in the recording state already.
     if (m_AvailableCommandLists.empty())
     {
-        m_CommandLists.emplace_back(std::make_unique<GraphicsCommandList>(m_Services, m_Type));
+        m_CommandLists.emplace_back(std::make_unique<GraphicsCommandList>(m_Services, m_Type, allocator, m_DynamicPagePool, m_DescriptorPagePool));
         m_CommandLists.back()->SetName(std::wstring(L"CommandList ") + std::to_wstring(m_CommandLists.size()));
 
-        m_AvailableCommandLists.push(m_CommandLists.back().get());
+        return m_CommandLists.back().get();
     }
 
-    // Get the command list at the front of the queue and return it.
+    // Get the command list at the front of the queue, reset it with the new allocator and return it.
     GraphicsCommandList* cmdList = m_AvailableCommandLists.front();
     m_AvailableCommandLists.pop();
+    cmdList->Reset(allocator);
     return cmdList;
 }
 
-void CommandQueue::ExecuteCommandList(GraphicsCommandList& a_CommandList)
+uint64_t CommandQueue::ExecuteCommandList(GraphicsCommandList& a_CommandList)
 {
-    // Close the command list and execute it
-    a_CommandList.Close();
+    return ExecuteCommandLists({ &a_CommandList });
+}
 
-    ID3D12CommandList* cmdLists[] = { a_CommandList.GetCommandListPtr().Get() };
+uint64_t CommandQueue::ExecuteCommandLists(const std::vector<GraphicsCommandList*>& a_CommandLists, const std::vector<SyncPoint>& a_Dependencies)
+{
+    // Lists which use uploaded data need to wait for the copy queue. This may submit the uploads, so it is done before taking the lock.
+    std::vector<SyncPoint> dependencies = a_Dependencies;
+    if (m_Services.m_UploadManager)
+    {
+        for (GraphicsCommandList* commandList : a_CommandLists)
+        {
+            UploadManager::UploadToken uploadToken = commandList->GetUploadDependency();
+            if (uploadToken.IsValid())
+            {
+                dependencies.push_back(m_Services.m_UploadManager->GetSyncPoint(uploadToken));
+            }
+        }
+    }
 
-    m_D3D12CommandQueue->ExecuteCommandLists(1, cmdLists);
+    // The first transition of every resource in a list could not be recorded without knowing the state the resource would be in.
+    // Those barriers are recorded at the end of the previous list in the batch, or in an extra list in front of the first one.
+    // That list is taken before the global states are locked, so getting it doesn't hold up the submissions of the other queues.
+    GraphicsCommandList* fixupList = nullptr;
+    if (!a_CommandLists.empty() && a_CommandLists[0]->GetResourceStateTracker().HasPendingTransitions())
+    {
+        fixupList = GetCommandList();
+    }
 
-    // Increment the fence value and use it to signal the command queue
-    ++m_FenceValue;
-    m_D3D12CommandQueue->Signal(m_D3D12Fence.Get(), m_FenceValue);
+    // The global resource states are locked until the lists are submitted, so they are updated in the same order the GPU executes the lists in.
+    // Batches which don't use any tracked resources, like the upload batches of the copy queue, don't touch the global states and skip the lock.
+    bool hasTrackedResources = false;
+    for (GraphicsCommandList* commandList : a_CommandLists)
+    {
+        hasTrackedResources = hasTrackedResources || commandList->GetResourceStateTracker().HasTrackedResources();
+    }
+    std::unique_lock<std::mutex> stateLock;
+    if (hasTrackedResources)
+    {
+        stateLock = ResourceStateTracker::LockGlobalStates();
+    }
+
+    std::vector<GraphicsCommandList*> submitLists;
+    submitLists.reserve(a_CommandLists.size() + 1);
+    std::vector<std::shared_ptr<TrackedResourceState>> usedResources;
+    for (GraphicsCommandList* commandList : a_CommandLists)
+    {
+        ResourceStateTracker& stateTracker = commandList->GetResourceStateTracker();
+        stateTracker.GetUsedResources(usedResources);
+        std::vector<D3D12_RESOURCE_BARRIER> barriers = stateTracker.ResolvePendingTransitions();
+        if (!barriers.empty())
+        {
+            if (submitLists.empty())
+            {
+                submitLists.push_back(fixupList);
+            }
+            submitLists.back()->ResourceBarriers(barriers);
+        }
+        stateTracker.CommitFinalStates();
+
+        submitLists.push_back(commandList);
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // The resources of the first list may already be in the states it expects them in
+    if (fixupList && submitLists[0] != fixupList)
+    {
+        DiscardCommandListsLocked({ fixupList });
+    }
 
-    // Set the fence value that the command list is to be associated with and mark it as in-use
-    a_CommandList.SetFenceValue(m_FenceValue);
-    m_UsedCommandLists.push(&a_CommandList);
+    // The waits are inserted under the same lock, so no other submission can end up between them and the lists
+    for (const SyncPoint& dependency : dependencies)
+    {
+        if (dependency.IsValid())
+        {
+            WaitForQueueLocked(*dependency.m_Queue, dependency.m_FenceValue);
+        }
+    }
+
+    std::vector<uint64_t> residencyObjects;
+    for (const std::shared_ptr<TrackedResourceState>& resource : usedResources)
+    {
+        if (resource->m_ResidencyObject != 0)
+        {
+            residencyObjects.push_back(resource->m_ResidencyObject);
+        }
+    }
+
+    if (submitLists.empty())
+    {
+        return m_FenceValue;
+    }
+
+    // Memory which was evicted is made resident again without blocking, the queue waits until it is.
+    // The objects can't be evicted until they are marked as submitted, so that also needs to happen when the submission fails.
+    ResidencyManager* residencyManager = m_Services.m_ResidencyManager.get();
+    try
+    {
+        if (residencyManager && !residencyObjects.empty())
+        {
+            ResidencyManager::WaitPoint waitPoint = residencyManager->MakeResident(residencyObjects, m_Type);
+            if (waitPoint.IsValid())
+            {
+                ThrowIfFailed(m_D3D12CommandQueue->Wait(waitPoint.m_Fence.Get(), waitPoint.m_FenceValue));
+            }
+        }
+
+        // Close all the command lists and gather the D3D12 objects so they can be submitted in one go
+        std::vector<ID3D12CommandList*> cmdLists;
+        cmdLists.reserve(submitLists.size());
+        for (GraphicsCommandList* commandList : submitLists)
+        {
+            commandList->Close();
+            cmdLists.push_back(commandList->GetCommandListPtr().Get());
+        }
+
+        m_D3D12CommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), &cmdLists[0]);
+
+        // Signal the command queue once for the whole batch
+        SignalLocked();
+    }
+    catch (...)
+    {
+        // Whatever reached the GPU is done by the last fence value of the queue, which the objects' earlier uses on it are covered by as well
+        if (residencyManager && !residencyObjects.empty())
+        {
+            residencyManager->MarkSubmitted(residencyObjects, m_Type, m_FenceValue);
+        }
+        throw;
+    }
+
+    // The memory the lists use can't be evicted until the GPU reaches the fence value
+    if (residencyManager && !residencyObjects.empty())
+    {
+        residencyManager->MarkSubmitted(residencyObjects, m_Type, m_FenceValue);
+    }
+
+    // Once the last wrapper of a resource is gone, the resource is released after the last submission which used it.
+    // The global state lock is held whenever there are used resources, so this can't race with another submission of the same resource.
+    size_t queueIndex = GetQueueIndex(m_Type);
+    for (const std::shared_ptr<TrackedResourceState>& resource : usedResources)
+    {
+        resource->m_LastUsedFenceValues[queueIndex] = m_FenceValue;
+        resource->m_ReleaseQueue = m_Services.m_DeferredReleaseQueue.get();
+    }
+
+    // All the lists in the batch finish together, so they share the fence value.
+    // The allocators, dynamic pages and intermediate buffers stay in flight until then, but the lists themselves can be recorded again right away.
+    for (GraphicsCommandList* commandList : submitLists)
+    {
+        commandList->SetFenceValue(m_FenceValue);
+        m_AllocatorPool.ReturnAllocator(commandList->ReleaseCommandAllocator(), m_FenceValue);
+        m_DynamicPagePool.ReturnPages(commandList->ReleaseDynamicPages(), m_FenceValue);
+        m_DescriptorPagePool.ReturnPages(commandList->ReleaseDescriptorPages(), m_FenceValue);
+
+        auto intermediateBuffers = commandList->ReleaseIntermediateBuffers();
+        if (!intermediateBuffers.empty())
+        {
+            m_InFlightIntermediateBuffers.emplace(m_FenceValue, std::move(intermediateBuffers));
+        }
+
+        m_AvailableCommandLists.push(commandList);
+    }
+
+    return m_FenceValue;
+}
+
+void CommandQueue::DiscardCommandLists(const std::vector<GraphicsCommandList*>& a_CommandLists)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    DiscardCommandListsLocked(a_CommandLists);
+}
+
+void CommandQueue::DiscardCommandListsLocked(const std::vector<GraphicsCommandList*>& a_CommandLists)
+{
+    // The GPU never sees the lists, but their allocators and pages can be shared with work that was submitted earlier,
+    // so they are recycled like those of a submission made right now
+    for (GraphicsCommandList* commandList : a_CommandLists)
+    {
+        // A list can only be reset once it is closed. Closing fails if the recorded commands are invalid, but the list is closed either way.
+        commandList->GetCommandListPtr()->Close();
+
+        m_AllocatorPool.ReturnAllocator(commandList->ReleaseCommandAllocator(), m_FenceValue);
+        m_DynamicPagePool.ReturnPages(commandList->ReleaseDynamicPages(), m_FenceValue);
+        m_DescriptorPagePool.ReturnPages(commandList->ReleaseDescriptorPages(), m_FenceValue);
+
+        auto intermediateBuffers = commandList->ReleaseIntermediateBuffers();
+        if (!intermediateBuffers.empty())
+        {
+            m_InFlightIntermediateBuffers.emplace(m_FenceValue, std::move(intermediateBuffers));
+        }
+
+        m_AvailableCommandLists.push(commandList);
+    }
+}
+
+void CommandQueue::WaitForQueue(CommandQueue& a_OtherQueue, uint64_t a_FenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    WaitForQueueLocked(a_OtherQueue, a_FenceValue);
+}
+
+void CommandQueue::WaitForSyncPoint(const SyncPoint& a_SyncPoint)
+{
+    if (a_SyncPoint.IsValid())
+    {
+        WaitForQueue(*a_SyncPoint.m_Queue, a_SyncPoint.m_FenceValue);
+    }
+}
+
+void CommandQueue::WaitForSyncPoints(const std::vector<SyncPoint>& a_SyncPoints)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (const SyncPoint& syncPoint : a_SyncPoints)
+    {
+        if (syncPoint.IsValid())
+        {
+            WaitForQueueLocked(*syncPoint.m_Queue, syncPoint.m_FenceValue);
+        }
+    }
+}
+
+CommandQueue::SyncPoint CommandQueue::GetSyncPoint(uint64_t a_FenceValue)
+{
+    SyncPoint syncPoint;
+    syncPoint.m_Queue = this;
+    syncPoint.m_FenceValue = a_FenceValue;
+    return syncPoint;
+}
+
+CommandQueue::SyncPoint CommandQueue::GetLastSyncPoint()
+{
+    return GetSyncPoint(GetLastSignaledFenceValue());
 }
 
 void CommandQueue::Flush()
 {
-    // increment the fence value and signal the command queue with it
+    WaitForFenceValue(Signal());
+}
+
+uint64_t CommandQueue::Signal()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return SignalLocked();
+}
+
+bool CommandQueue::IsFenceComplete(uint64_t a_FenceValue)
+{
+    // Only query the fence if the cached value is not enough to tell
+    if (a_FenceValue <= m_CompletedFenceValue)
+    {
+        return true;
+    }
+    return a_FenceValue <= UpdateCompletedFenceValue();
+}
+
+bool CommandQueue::WaitForFenceValue(uint64_t a_FenceValue, DWORD a_Timeout)
+{
+    if (IsFenceComplete(a_FenceValue))
+    {
+        return true;
+    }
+
+    HANDLE waitEvent = AcquireWaitEvent();
+    ThrowIfFailed(m_D3D12Fence->SetEventOnCompletion(a_FenceValue, waitEvent));
+
+    // A pooled event can still be signaled by a previous wait which timed out, so the fence is checked again after every wake-up
+    ULONGLONG startTime = GetTickCount64();
+    bool completed = false;
+    while (!completed)
+    {
+        DWORD remainingTime = INFINITE;
+        if (a_Timeout != INFINITE)
+        {
+            ULONGLONG elapsedTime = GetTickCount64() - startTime;
+            if (elapsedTime >= a_Timeout)
+            {
+                break;
+            }
+            remainingTime = a_Timeout - static_cast<DWORD>(elapsedTime);
+        }
+
+        DWORD result = WaitForSingleObject(waitEvent, remainingTime);
+        completed = IsFenceComplete(a_FenceValue);
+        if (result != WAIT_OBJECT_0)
+        {
+            break;
+        }
+    }
+
+    ReleaseWaitEvent(waitEvent);
+    return completed;
+}
+
+uint64_t CommandQueue::GetCompletedFenceValue()
+{
+    return UpdateCompletedFenceValue();
+}
+
+uint64_t CommandQueue::GetLastSignaledFenceValue() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FenceValue;
+}
+
+const CommandAllocatorPool::Statistics& CommandQueue::GetAllocatorPoolStatistics() const
+{
+    return m_AllocatorPool.GetStatistics();
+}
+
+LinearAllocatorPagePool::Statistics CommandQueue::GetDynamicPagePoolStatistics()
+{
+    return m_DynamicPagePool.GetStatistics();
+}
+
+DynamicDescriptorPagePool::Statistics CommandQueue::GetDescriptorPagePoolStatistics()
+{
+    return m_DescriptorPagePool.GetStatistics();
+}
+
+size_t CommandQueue::GetQueueIndex(D3D12_COMMAND_LIST_TYPE a_Type)
+{
+    switch (a_Type)
+    {
+    case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+        return 1;
+    case D3D12_COMMAND_LIST_TYPE_COPY:
+        return 2;
+    case D3D12_COMMAND_LIST_TYPE_DIRECT:
+    default:
+        return 0;
+    }
+}
+
+uint64_t CommandQueue::SignalLocked()
+{
+    // Increment the fence value and signal the command queue with it
     // this adds a command at the end of the queue which will signal the fence once it's executed
     ++m_FenceValue;
     ThrowIfFailed(m_D3D12CommandQueue->Signal(m_D3D12Fence.Get(), m_FenceValue));
+    return m_FenceValue;
+}
 
-    // if the fence hasn't been signaled with the fence value, create an event and assign it to the fence. Then wait till the event happens.
-    if (m_D3D12Fence->GetCompletedValue() < m_FenceValue)
+void CommandQueue::WaitForQueueLocked(CommandQueue& a_OtherQueue, uint64_t a_FenceValue)
+{
+    // Work on the same queue is already executed in order
+    if (&a_OtherQueue == this)
     {
-        HANDLE eventHandle = CreateEventExW(nullptr, false, false, EVENT_ALL_ACCESS);
-        m_D3D12Fence->SetEventOnCompletion(m_FenceValue, eventHandle);
+        return;
+    }
 
-        WaitForSingleObject(eventHandle, static_cast<DWORD>(INFINITY));
+    // No need to wait if an earlier wait already covers the value or the other queue has already reached it
+    uint64_t& waitedValue = m_WaitedFenceValues[&a_OtherQueue];
+    if (a_FenceValue <= waitedValue || a_OtherQueue.IsFenceComplete(a_FenceValue))
+    {
+        return;
+    }
 
-        CloseHandle(eventHandle);
+    ThrowIfFailed(m_D3D12CommandQueue->Wait(a_OtherQueue.m_D3D12Fence.Get(), a_FenceValue));
+    waitedValue = a_FenceValue;
+}
+
+uint64_t CommandQueue::UpdateCompletedFenceValue()
+{
+    uint64_t completedValue = m_D3D12Fence->GetCompletedValue();
+
+    // Other threads might be updating the value as well, so make sure it never goes backwards
+    uint64_t cachedValue = m_CompletedFenceValue;
+    while (cachedValue < completedValue && !m_CompletedFenceValue.compare_exchange_weak(cachedValue, completedValue))
+    {
+    }
+    return completedValue;
+}
+
+HANDLE CommandQueue::AcquireWaitEvent()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_WaitEventMutex);
+        if (!m_WaitEvents.empty())
+        {
+            HANDLE waitEvent = m_WaitEvents.back();
+            m_WaitEvents.pop_back();
+            return waitEvent;
+        }
+    }
+
+    // Auto-reset event, so it doesn't need to be reset manually before reusing it
+    HANDLE waitEvent = CreateEventExW(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+    if (waitEvent == nullptr)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
     }
+    return waitEvent;
+}
 
+void CommandQueue::ReleaseWaitEvent(HANDLE a_Event)
+{
+    std::lock_guard<std::mutex> lock(m_WaitEventMutex);
+    m_WaitEvents.push_back(a_Event);
+}
+
+void CommandQueue::ReleaseCompletedIntermediateBuffers(uint64_t a_CompletedFenceValue)
+{
+    // Releasing the buffers frees their memory, evicting is left to the residency manager which knows the budget
+    while (!m_InFlightIntermediateBuffers.empty() && m_InFlightIntermediateBuffers.front().first <= a_CompletedFenceValue)
+    {
+        m_InFlightIntermediateBuffers.pop();
+    }
 }
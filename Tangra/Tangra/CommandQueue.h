@@ -6,29 +6,108 @@
 #include <memory>
 #include <vector>
 #include <queue>
+#include <mutex>
+#include <atomic>
+
+#include "CommandAllocatorPool.h"
+#include "LinearAllocatorPagePool.h"
+#include "DynamicDescriptorPagePool.h"
+
+#include <unordered_map>
 
 class GraphicsCommandList;
 
 struct ServiceLocator;
 // Wrapper around ID3D12CommandQueue responsible for GPU synchronization and handling command lists.
+// Getting command lists and executing them is thread-safe, so lists can be recorded on multiple threads at once.
 class CommandQueue
 {
 public:
+
+    // A point on a queue's fence timeline. Work that depends on another queue's results waits on one of these.
+    struct SyncPoint
+    {
+        CommandQueue* m_Queue = nullptr;
+        uint64_t m_FenceValue = 0;
+
+        bool IsValid() const { return m_Queue != nullptr; }
+    };
+
     CommandQueue(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type, D3D12_COMMAND_QUEUE_FLAGS a_Flags = D3D12_COMMAND_QUEUE_FLAG_NONE);
     ~CommandQueue();
 
     // Gets the command queue COM object
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetCommandQueueObject();
+    // Gets the fence the queue signals after every submission
+    Microsoft::WRL::ComPtr<ID3D12Fence1> GetFenceObject();
 
-    // Returns a pointer to an unused command list. Also checks if any previously used command lists have finished execution.
+    // Returns a pointer to a command list that is ready for recording, using a recycled command allocator if one is available.
+    // Also frees the intermediate buffers of submissions which have finished execution.
     GraphicsCommandList* GetCommandList();
 
     // Execute the command list and signal using the fence to know when its execution is finished. Also closes the command list before executing it.
-    void ExecuteCommandList(GraphicsCommandList& a_CommandList);
+    uint64_t ExecuteCommandList(GraphicsCommandList& a_CommandList);
+    // Close and execute all the command lists in order with a single submission and a single fence signal.
+    // Every list is associated with the same fence value, which is returned.
+    // The GPU waits for all of the dependencies to be reached before it starts executing the lists.
+    uint64_t ExecuteCommandLists(const std::vector<GraphicsCommandList*>& a_CommandLists, const std::vector<SyncPoint>& a_Dependencies = {});
+    // Hand command lists back without executing them, for lists whose recording failed. Everything recorded into them is dropped.
+    void DiscardCommandLists(const std::vector<GraphicsCommandList*>& a_CommandLists);
+
+    // Make the GPU wait for another queue's fence to reach the value before executing anything submitted to this queue afterwards.
+    // This does not block the calling thread.
+    void WaitForQueue(CommandQueue& a_OtherQueue, uint64_t a_FenceValue);
+    // Make the GPU wait for the sync point before executing anything submitted to this queue afterwards
+    void WaitForSyncPoint(const SyncPoint& a_SyncPoint);
+    // Make the GPU wait for all the sync points before executing anything submitted to this queue afterwards
+    void WaitForSyncPoints(const std::vector<SyncPoint>& a_SyncPoints);
+
+    // Returns a sync point for the specified fence value of this queue
+    SyncPoint GetSyncPoint(uint64_t a_FenceValue);
+    // Returns a sync point for the last work submitted to this queue
+    SyncPoint GetLastSyncPoint();
 
     // Flush all command lists that are currently being executed.
     void Flush();
+
+    // Signal the fence with the next fence value at the current end of the queue and return the value
+    uint64_t Signal();
+    // Check if the GPU has reached the specified fence value without blocking
+    bool IsFenceComplete(uint64_t a_FenceValue);
+    // Blocks the calling thread until the fence has reached the specified value or the timeout in milliseconds has passed.
+    // Returns true if the fence value has been reached.
+    bool WaitForFenceValue(uint64_t a_FenceValue, DWORD a_Timeout = INFINITE);
+
+    // Returns the last value the queue has signaled its fence with
+    uint64_t GetLastSignaledFenceValue() const;
+    // Returns the latest fence value the GPU is known to have reached
+    uint64_t GetCompletedFenceValue();
+    // Returns the size and reuse statistics of the queue's command allocator pool
+    const CommandAllocatorPool::Statistics& GetAllocatorPoolStatistics() const;
+    // Returns the size and reuse statistics of the pool of pages the command lists allocate dynamic data from
+    LinearAllocatorPagePool::Statistics GetDynamicPagePoolStatistics();
+    // Returns the size and reuse statistics of the pool of shader visible descriptor pages the dynamic descriptor tables are copied into
+    DynamicDescriptorPagePool::Statistics GetDescriptorPagePoolStatistics();
+
+    // Returns the index of the queue type, for data which is stored per queue: 0 for direct, 1 for compute and 2 for copy
+    static size_t GetQueueIndex(D3D12_COMMAND_LIST_TYPE a_Type);
 private:
+    // Signal the fence with the next fence value. The caller needs to hold m_Mutex.
+    uint64_t SignalLocked();
+    // Recycle lists which won't be submitted. The caller needs to hold m_Mutex.
+    void DiscardCommandListsLocked(const std::vector<GraphicsCommandList*>& a_CommandLists);
+    // Insert a GPU-side wait for another queue's fence. The caller needs to hold m_Mutex.
+    void WaitForQueueLocked(CommandQueue& a_OtherQueue, uint64_t a_FenceValue);
+    // Query the fence for its completed value and cache it
+    uint64_t UpdateCompletedFenceValue();
+
+    // Get an event from the pool of wait events, or create one if there are none
+    HANDLE AcquireWaitEvent();
+    void ReleaseWaitEvent(HANDLE a_Event);
+
+    // Release the intermediate buffers of all the submissions the GPU has finished
+    void ReleaseCompletedIntermediateBuffers(uint64_t a_CompletedFenceValue);
+
     ServiceLocator& m_Services;
     
     D3D12_COMMAND_LIST_TYPE m_Type;
@@ -38,14 +117,33 @@ private:
     // To keep it simple, the command queue is responsible entirely for the fence
     uint64_t m_FenceValue;
     Microsoft::WRL::ComPtr<ID3D12Fence1> m_D3D12Fence;
+    // Cached completed value of the fence, to avoid querying the fence when the value is known to be reached
+    std::atomic<uint64_t> m_CompletedFenceValue;
+
+    // Highest fence value of every other queue this queue has already waited for, used to skip redundant waits
+    std::unordered_map<CommandQueue*, uint64_t> m_WaitedFenceValues;
+
+    // Events used to wait for the fence on the CPU. They are reused instead of being created for every wait.
+    std::mutex m_WaitEventMutex;
+    std::vector<HANDLE> m_WaitEvents;
 
     // List of all the command lists created by the command queue
     std::vector<std::unique_ptr<GraphicsCommandList>> m_CommandLists;
 
-    // List of command lists which have finished execution and are available
+    // Guards the command list pools and the fence value
+    mutable std::mutex m_Mutex;
+
+    // Command lists don't own their allocators, so they can be re-recorded as soon as they have been submitted
+    CommandAllocatorPool m_AllocatorPool;
+    // Upload pages used by the linear allocators of the command lists, recycled by fence value just like the allocators
+    LinearAllocatorPagePool m_DynamicPagePool;
+    // Shader visible descriptor pages used by the dynamic descriptor tables, handed out again in the order their fences complete
+    DynamicDescriptorPagePool m_DescriptorPagePool;
+
+    // List of command lists which have been submitted and can be reset with a new allocator
     std::queue<GraphicsCommandList*> m_AvailableCommandLists;
-    // List of command lists which are currently being executed by the GPU
-    std::queue<GraphicsCommandList*> m_UsedCommandLists;
+    // Intermediate buffers of submitted command lists, kept alive until the fence reaches the associated value
+    std::queue<std::pair<uint64_t, std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>>> m_InFlightIntermediateBuffers;
 
 };
 
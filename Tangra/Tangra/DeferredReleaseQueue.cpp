@@ -0,0 +1,84 @@
+#include "DeferredReleaseQueue.h"
+#include "CommandQueue.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+using namespace Microsoft::WRL;
+
+const size_t DeferredReleaseQueue::s_NumQueueTypes;
+
+DeferredReleaseQueue::DeferredReleaseQueue(ServiceLocator& a_ServiceLocator)
+    : m_Services(a_ServiceLocator)
+{
+}
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+}
+
+void DeferredReleaseQueue::Release(ComPtr<ID3D12Resource> a_Resource, const uint64_t (&a_LastUsedFenceValues)[s_NumQueueTypes])
+{
+    PendingRelease release;
+    release.m_Resource = a_Resource;
+    for (size_t i = 0; i < s_NumQueueTypes; i++)
+    {
+        release.m_FenceValues[i] = a_LastUsedFenceValues[i];
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_PendingReleases.push_back(release);
+    ++m_Statistics.m_NumDeferred;
+}
+
+void DeferredReleaseQueue::ReleaseCompleted()
+{
+    const D3D12_COMMAND_LIST_TYPE queueTypes[] = { D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_TYPE_COMPUTE, D3D12_COMMAND_LIST_TYPE_COPY };
+
+    // Read every fence once instead of once per resource
+    uint64_t completedFenceValues[s_NumQueueTypes];
+    for (D3D12_COMMAND_LIST_TYPE queueType : queueTypes)
+    {
+        completedFenceValues[CommandQueue::GetQueueIndex(queueType)] = m_Services.m_Device->GetCommandQueue(queueType)->GetCompletedFenceValue();
+    }
+
+    // Releasing a resource can free memory in the allocator, which takes other locks, so it happens after the lock is released
+    std::vector<PendingRelease> completedReleases;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        size_t numPending = 0;
+        for (size_t index = 0; index < m_PendingReleases.size(); index++)
+        {
+            PendingRelease& release = m_PendingReleases[index];
+            bool isComplete = true;
+            for (size_t i = 0; i < s_NumQueueTypes && isComplete; i++)
+            {
+                isComplete = release.m_FenceValues[i] <= completedFenceValues[i];
+            }
+
+            if (isComplete)
+            {
+                completedReleases.push_back(std::move(release));
+            }
+            else
+            {
+                if (numPending != index)
+                {
+                    m_PendingReleases[numPending] = std::move(release);
+                }
+                ++numPending;
+            }
+        }
+        m_PendingReleases.resize(numPending);
+        m_Statistics.m_NumReleased += completedReleases.size();
+    }
+}
+
+DeferredReleaseQueue::Statistics DeferredReleaseQueue::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Statistics statistics = m_Statistics;
+    statistics.m_NumPending = m_PendingReleases.size();
+    return statistics;
+}
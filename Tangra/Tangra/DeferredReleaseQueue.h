@@ -0,0 +1,52 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct ServiceLocator;
+
+// Keeps resources alive until the GPU is done with them, so a resource can be dropped without flushing the queues.
+// Every resource waits for the fence value of the last submission which used it on every queue. Thread-safe.
+class DeferredReleaseQueue
+{
+public:
+
+    // Number of queue types the fence values are stored for, indexed by CommandQueue::GetQueueIndex
+    static const size_t s_NumQueueTypes = 3;
+
+    struct Statistics
+    {
+        // Number of resources waiting for the GPU
+        size_t m_NumPending = 0;
+        uint64_t m_NumDeferred = 0;
+        uint64_t m_NumReleased = 0;
+    };
+
+    DeferredReleaseQueue(ServiceLocator& a_ServiceLocator);
+    // The queues need to be flushed before the release queue is destroyed, the remaining resources are released right away
+    ~DeferredReleaseQueue();
+
+    // Release the resource once every queue has reached the fence value the resource was last used at on that queue
+    void Release(Microsoft::WRL::ComPtr<ID3D12Resource> a_Resource, const uint64_t (&a_LastUsedFenceValues)[s_NumQueueTypes]);
+    // Release the resources the GPU has finished with. Called once per frame.
+    void ReleaseCompleted();
+
+    Statistics GetStatistics();
+private:
+
+    struct PendingRelease
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_Resource;
+        uint64_t m_FenceValues[s_NumQueueTypes];
+    };
+
+    ServiceLocator& m_Services;
+
+    std::mutex m_Mutex;
+    std::vector<PendingRelease> m_PendingReleases;
+
+    Statistics m_Statistics;
+};
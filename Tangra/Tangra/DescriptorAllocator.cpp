@@ -0,0 +1,249 @@
+#include "DescriptorAllocator.h"
+#include "CommandQueue.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    const D3D12_COMMAND_LIST_TYPE g_QueueTypes[] = { D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_TYPE_COMPUTE, D3D12_COMMAND_LIST_TYPE_COPY };
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocation::GetCPUHandle(uint32_t a_Index) const
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = m_CPUHandle;
+    handle.ptr += static_cast<SIZE_T>(a_Index) * m_DescriptorSize;
+    return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocation::GetGPUHandle(uint32_t a_Index) const
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE handle = m_GPUHandle;
+    handle.ptr += static_cast<UINT64>(a_Index) * m_DescriptorSize;
+    return handle;
+}
+
+DescriptorAllocator::Page::Page(uint32_t a_Size)
+    : m_Allocator(a_Size)
+{
+}
+
+DescriptorAllocator::DescriptorAllocator(ServiceLocator& a_ServiceLocator, D3D12_DESCRIPTOR_HEAP_TYPE a_Type, uint32_t a_PageSize, bool a_ShaderVisible)
+    : m_Services(a_ServiceLocator)
+    , m_Type(a_Type)
+    , m_PageSize(a_PageSize)
+    , m_ShaderVisible(a_ShaderVisible)
+{
+    m_DescriptorSize = m_Services.m_Device->GetDeviceObject()->GetDescriptorHandleIncrementSize(a_Type);
+
+    // The single heap of a shader visible allocator is created up front, so it can be bound before anything is allocated
+    if (m_ShaderVisible)
+    {
+        CreatePage(m_PageSize);
+    }
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+DescriptorAllocation DescriptorAllocator::Allocate(uint32_t a_NumDescriptors)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (m_ShaderVisible)
+    {
+        ReleaseCompletedFrees();
+    }
+
+    size_t pageIndex = 0;
+    uint64_t offset = OffsetAllocator::s_InvalidOffset;
+    for (; pageIndex < m_Pages.size(); pageIndex++)
+    {
+        offset = m_Pages[pageIndex]->m_Allocator.Allocate(a_NumDescriptors);
+        if (offset != OffsetAllocator::s_InvalidOffset)
+        {
+            break;
+        }
+    }
+
+    if (offset == OffsetAllocator::s_InvalidOffset)
+    {
+        if (m_ShaderVisible)
+        {
+            throw std::runtime_error("The shader visible descriptor heap has no room for " + std::to_string(a_NumDescriptors) + " descriptors");
+        }
+
+        CreatePage(a_NumDescriptors);
+        pageIndex = m_Pages.size() - 1;
+        offset = m_Pages[pageIndex]->m_Allocator.Allocate(a_NumDescriptors);
+    }
+
+    const Page& page = *m_Pages[pageIndex];
+    DescriptorAllocation allocation;
+    allocation.m_NumDescriptors = a_NumDescriptors;
+    allocation.m_HeapIndex = static_cast<uint32_t>(offset);
+    allocation.m_Page = static_cast<uint32_t>(pageIndex);
+    allocation.m_DescriptorSize = m_DescriptorSize;
+    allocation.m_CPUHandle.ptr = page.m_CPUStart.ptr + static_cast<SIZE_T>(offset) * m_DescriptorSize;
+    if (m_ShaderVisible)
+    {
+        allocation.m_GPUHandle.ptr = page.m_GPUStart.ptr + offset * m_DescriptorSize;
+    }
+
+    m_NumAllocatedDescriptors += a_NumDescriptors;
+    return allocation;
+}
+
+void DescriptorAllocator::Free(const DescriptorAllocation& a_Allocation)
+{
+    if (!a_Allocation.IsValid())
+    {
+        return;
+    }
+
+    // CPU descriptors are copied when commands are recorded, but shader visible ones are read by the GPU when the commands execute
+    if (m_ShaderVisible)
+    {
+        throw std::runtime_error("Shader visible descriptors need the fence values of the submissions which used them to be freed");
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_Pages[a_Allocation.m_Page]->m_Allocator.Free(a_Allocation.m_HeapIndex);
+    m_NumAllocatedDescriptors -= a_Allocation.m_NumDescriptors;
+}
+
+void DescriptorAllocator::Free(const DescriptorAllocation& a_Allocation, const uint64_t (&a_LastUsedFenceValues)[3])
+{
+    if (!a_Allocation.IsValid())
+    {
+        return;
+    }
+
+    if (!m_ShaderVisible)
+    {
+        Free(a_Allocation);
+        return;
+    }
+
+    PendingFree pendingFree;
+    pendingFree.m_Allocation = a_Allocation;
+    std::copy(std::begin(a_LastUsedFenceValues), std::end(a_LastUsedFenceValues), pendingFree.m_FenceValues);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_PendingFrees.push_back(pendingFree);
+}
+
+std::shared_ptr<DescriptorAllocation> DescriptorAllocator::AllocateShared(uint32_t a_NumDescriptors)
+{
+    if (m_ShaderVisible)
+    {
+        throw std::runtime_error("Shared descriptors can only be allocated from CPU only allocators");
+    }
+
+    return std::shared_ptr<DescriptorAllocation>(new DescriptorAllocation(Allocate(a_NumDescriptors)), [this](DescriptorAllocation* a_Allocation)
+    {
+        Free(*a_Allocation);
+        delete a_Allocation;
+    });
+}
+
+ComPtr<ID3D12DescriptorHeap> DescriptorAllocator::GetShaderVisibleHeap() const
+{
+    return m_ShaderVisible ? m_Pages[0]->m_Heap : nullptr;
+}
+
+D3D12_DESCRIPTOR_HEAP_TYPE DescriptorAllocator::GetType() const
+{
+    return m_Type;
+}
+
+DescriptorAllocator::Statistics DescriptorAllocator::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Statistics statistics;
+    statistics.m_NumPages = m_Pages.size();
+    for (auto& page : m_Pages)
+    {
+        statistics.m_NumDescriptors += page->m_Allocator.GetSize();
+    }
+    statistics.m_NumAllocatedDescriptors = m_NumAllocatedDescriptors;
+    for (const PendingFree& pendingFree : m_PendingFrees)
+    {
+        statistics.m_NumPendingDescriptors += pendingFree.m_Allocation.m_NumDescriptors;
+    }
+    return statistics;
+}
+
+DescriptorAllocator::Page& DescriptorAllocator::CreatePage(uint32_t a_NumDescriptors)
+{
+    // Ranges larger than a page get a page of their own
+    uint32_t pageSize = std::max(m_PageSize, a_NumDescriptors);
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type = m_Type;
+    heapDesc.NumDescriptors = pageSize;
+    heapDesc.Flags = m_ShaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heapDesc.NodeMask = 0;
+
+    auto page = std::make_unique<Page>(pageSize);
+    ThrowIfFailed(m_Services.m_Device->GetDeviceObject()->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&page->m_Heap)));
+    page->m_CPUStart = page->m_Heap->GetCPUDescriptorHandleForHeapStart();
+    if (m_ShaderVisible)
+    {
+        page->m_GPUStart = page->m_Heap->GetGPUDescriptorHandleForHeapStart();
+    }
+
+    m_Pages.push_back(std::move(page));
+    return *m_Pages.back();
+}
+
+void DescriptorAllocator::ReleaseCompletedFrees()
+{
+    if (m_PendingFrees.empty())
+    {
+        return;
+    }
+
+    uint64_t completedFenceValues[3] = {};
+    for (D3D12_COMMAND_LIST_TYPE queueType : g_QueueTypes)
+    {
+        completedFenceValues[CommandQueue::GetQueueIndex(queueType)] = m_Services.m_Device->GetCommandQueue(queueType)->GetCompletedFenceValue();
+    }
+
+    size_t numPending = 0;
+    for (size_t index = 0; index < m_PendingFrees.size(); index++)
+    {
+        PendingFree& pendingFree = m_PendingFrees[index];
+
+        bool isComplete = true;
+        for (size_t i = 0; i < 3 && isComplete; i++)
+        {
+            isComplete = pendingFree.m_FenceValues[i] <= completedFenceValues[i];
+        }
+
+        if (isComplete)
+        {
+            m_Pages[pendingFree.m_Allocation.m_Page]->m_Allocator.Free(pendingFree.m_Allocation.m_HeapIndex);
+            m_NumAllocatedDescriptors -= pendingFree.m_Allocation.m_NumDescriptors;
+        }
+        else
+        {
+            if (numPending != index)
+            {
+                m_PendingFrees[numPending] = std::move(pendingFree);
+            }
+            ++numPending;
+        }
+    }
+    m_PendingFrees.resize(numPending);
+}
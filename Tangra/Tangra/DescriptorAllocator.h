@@ -0,0 +1,103 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "OffsetAllocator.h"
+
+struct ServiceLocator;
+
+// A contiguous range of descriptors handed out by a DescriptorAllocator
+struct DescriptorAllocation
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE m_CPUHandle = {};
+    // Only set for shader visible allocators
+    D3D12_GPU_DESCRIPTOR_HANDLE m_GPUHandle = {};
+    uint32_t m_NumDescriptors = 0;
+    // Index of the first descriptor in the heap of its page
+    uint32_t m_HeapIndex = 0;
+    uint32_t m_Page = 0;
+    uint32_t m_DescriptorSize = 0;
+
+    bool IsValid() const { return m_NumDescriptors != 0; }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(uint32_t a_Index = 0) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(uint32_t a_Index = 0) const;
+};
+
+// Hands out ranges of descriptors of one heap type from a list of heaps, and takes them back when they are freed.
+// CPU only allocators grow by adding heaps of a fixed page size. A shader visible allocator has a single heap, since only one can be bound at a time,
+// and the descriptors it frees are only reused once the GPU is done with the submissions which used them. Thread-safe.
+class DescriptorAllocator
+{
+public:
+
+    struct Statistics
+    {
+        size_t m_NumPages = 0;
+        uint64_t m_NumDescriptors = 0;
+        uint64_t m_NumAllocatedDescriptors = 0;
+        // Descriptors which were freed but could still be read by the GPU
+        uint64_t m_NumPendingDescriptors = 0;
+    };
+
+    DescriptorAllocator(ServiceLocator& a_ServiceLocator, D3D12_DESCRIPTOR_HEAP_TYPE a_Type, uint32_t a_PageSize = 256, bool a_ShaderVisible = false);
+    ~DescriptorAllocator();
+
+    // Allocate a contiguous range of descriptors, so it can be used as a descriptor table.
+    // Throws if a shader visible allocator has no range left which is large enough.
+    DescriptorAllocation Allocate(uint32_t a_NumDescriptors = 1);
+    // Give the range of a CPU only allocator back to the allocator
+    void Free(const DescriptorAllocation& a_Allocation);
+    // Give the range of a shader visible allocator back once every queue has reached the fence value of the last submission which used it,
+    // indexed by CommandQueue::GetQueueIndex. Command lists which are recorded but not submitted yet need to hold on to the range themselves.
+    void Free(const DescriptorAllocation& a_Allocation, const uint64_t (&a_LastUsedFenceValues)[3]);
+    // Allocate a range of a CPU only allocator which is freed once the last copy of the pointer is gone, for descriptors shared by copies of a resource wrapper.
+    // The allocator needs to outlive the pointer.
+    std::shared_ptr<DescriptorAllocation> AllocateShared(uint32_t a_NumDescriptors = 1);
+
+    // Returns the heap of a shader visible allocator, which needs to be bound to use its descriptors
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetShaderVisibleHeap() const;
+    D3D12_DESCRIPTOR_HEAP_TYPE GetType() const;
+    Statistics GetStatistics();
+private:
+
+    struct Page
+    {
+        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_Heap;
+        D3D12_CPU_DESCRIPTOR_HANDLE m_CPUStart = {};
+        D3D12_GPU_DESCRIPTOR_HANDLE m_GPUStart = {};
+        OffsetAllocator m_Allocator;
+
+        Page(uint32_t a_Size);
+    };
+
+    struct PendingFree
+    {
+        DescriptorAllocation m_Allocation;
+        // Fence value of the last submission which used the range on every queue
+        uint64_t m_FenceValues[3];
+    };
+
+    // Create a page with room for at least the number of descriptors. The caller needs to hold m_Mutex.
+    Page& CreatePage(uint32_t a_NumDescriptors);
+    // Give the ranges of the pending frees the GPU is done with back to their pages. The caller needs to hold m_Mutex.
+    void ReleaseCompletedFrees();
+
+    ServiceLocator& m_Services;
+
+    D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
+    uint32_t m_PageSize;
+    uint32_t m_DescriptorSize;
+    bool m_ShaderVisible;
+
+    std::mutex m_Mutex;
+    std::vector<std::unique_ptr<Page>> m_Pages;
+    std::vector<PendingFree> m_PendingFrees;
+
+    uint64_t m_NumAllocatedDescriptors = 0;
+};
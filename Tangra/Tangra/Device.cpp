@@ -7,8 +7,8 @@
 using namespace Microsoft::WRL;
 
 Device::Device(Microsoft::WRL::ComPtr<IDXGIAdapter4> a_GraphicsAdapter, ServiceLocator& a_ServiceLocator)
-    : m_NumSRVHeapEntries(0)
-    , m_Services(a_ServiceLocator)
+    : m_Services(a_ServiceLocator)
+    , m_Adapter(a_GraphicsAdapter)
 {
 #ifdef _DEBUG
     // if the application is ran in debug, enable the debug layer
@@ -42,16 +42,29 @@ void Device::Initialize()
     m_RTVDescriptorSize = m_D3D12Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     m_DSVDescriptorSize = m_D3D12Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
-    // Create the SRV descriptor heap. Capacity is currently hardcoded for convenience.
-    m_SRVHeapCapacity = 128;
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ThrowIfFailed(m_D3D12Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    m_ResourceBindingTier = options.ResourceBindingTier;
 
-    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    heapDesc.NodeMask = 0;
-    heapDesc.NumDescriptors = m_SRVHeapCapacity;
-    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    // The check fails on runtimes which don't know about version 1.1, those only support 1.0
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE rootSignatureFeature = {};
+    rootSignatureFeature.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    if (FAILED(m_D3D12Device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &rootSignatureFeature, sizeof(rootSignatureFeature))))
+    {
+        rootSignatureFeature.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    }
+    m_RootSignatureVersion = rootSignatureFeature.HighestVersion;
 
-    ThrowIfFailed(m_D3D12Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_SRVHeap)));
+    // CPU only heaps grow in pages as needed. The shader visible heap can't grow, since the command lists would need to bind a new one.
+    for (UINT type = 0; type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; type++)
+    {
+        m_DescriptorAllocators[type] = std::make_unique<DescriptorAllocator>(m_Services, static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(type));
+    }
+    // It holds the bindless textures as well as the pages the queues copy dynamic descriptor tables into
+    m_ShaderVisibleDescriptorAllocator = std::make_unique<DescriptorAllocator>(m_Services, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 16384, true);
+
+    m_RootSignatureCache = std::make_unique<RootSignatureCache>(m_Services);
+    m_PipelineStateCache = std::make_unique<PipelineStateCache>(m_Services, L"PipelineCache.bin");
 
     // Create all the command queues
     m_DirectCommandQueue = std::make_unique<CommandQueue>(m_Services, D3D12_COMMAND_LIST_TYPE_DIRECT);
@@ -60,36 +73,39 @@ void Device::Initialize()
 
 }
 
-CD3DX12_GPU_DESCRIPTOR_HANDLE Device::AddSRV(ComPtr<ID3D12Resource> a_SRVResource)
+Microsoft::WRL::ComPtr<ID3D12Device2> Device::GetDeviceObject()
 {
-    // Check if the heap has space in it
-    if (m_NumSRVHeapEntries == m_SRVHeapCapacity)
-    {
-        std::cout << "ERROR: SRV Descriptor heap full, cannot allocate texture" << std::endl;
-        abort();
-    }
+    return m_D3D12Device;
+}
 
-    // Create a Shader Resource View for the resource
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_SRVHeap->GetCPUDescriptorHandleForHeapStart());
-    rHandle.Offset(m_NumSRVHeapEntries, m_CBVDescriptorSize);
-    m_D3D12Device->CreateShaderResourceView(a_SRVResource.Get(), nullptr, rHandle);
+Microsoft::WRL::ComPtr<IDXGIAdapter4> Device::GetAdapter()
+{
+    return m_Adapter;
+}
+
+Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Device::GetSRVHeap()
+{
+    return m_ShaderVisibleDescriptorAllocator->GetShaderVisibleHeap();
+}
 
-    // Get the GPU handle for the resource
-    auto gpuHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_SRVHeap->GetGPUDescriptorHandleForHeapStart()).Offset(m_NumSRVHeapEntries, m_CBVDescriptorSize);
+DescriptorAllocator& Device::GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE a_Type)
+{
+    return *m_DescriptorAllocators[a_Type];
+}
 
-    // Increment the SRV entries counter and return the GPU descriptor handle.
-    ++m_NumSRVHeapEntries;
-    return gpuHandle;
+DescriptorAllocator& Device::GetShaderVisibleDescriptorAllocator()
+{
+    return *m_ShaderVisibleDescriptorAllocator;
 }
 
-Microsoft::WRL::ComPtr<ID3D12Device2> Device::GetDeviceObject()
+RootSignatureCache& Device::GetRootSignatureCache()
 {
-    return m_D3D12Device;
+    return *m_RootSignatureCache;
 }
 
-Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Device::GetSRVHeap()
+PipelineStateCache& Device::GetPipelineStateCache()
 {
-    return m_SRVHeap;
+    return *m_PipelineStateCache;
 }
 
 CommandQueue* Device::GetCommandQueue(D3D12_COMMAND_LIST_TYPE a_Type)
@@ -130,3 +146,13 @@ UINT Device::GetDescriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE a_Type) const
         return 0;
     }
 }
+
+D3D12_RESOURCE_BINDING_TIER Device::GetResourceBindingTier() const
+{
+    return m_ResourceBindingTier;
+}
+
+D3D_ROOT_SIGNATURE_VERSION Device::GetRootSignatureVersion() const
+{
+    return m_RootSignatureVersion;
+}
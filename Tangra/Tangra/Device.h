@@ -3,6 +3,12 @@
 #include "dxgi1_6.h"
 #include "d3dx12.h"
 
+#include <memory>
+
+#include "DescriptorAllocator.h"
+#include "PipelineStateCache.h"
+#include "RootSignatureCache.h"
+
 class CommandQueue;
 
 struct ServiceLocator;
@@ -16,32 +22,49 @@ public:
     // Initialization is deferred to ensure command queues can use the service locator without resulting in nullptr references
     void Initialize();
 
-    // Currently, the device owns the descriptor heap which holds SRVs. Subject to change.
-    CD3DX12_GPU_DESCRIPTOR_HANDLE AddSRV(Microsoft::WRL::ComPtr<ID3D12Resource> a_SRVResource);
-
     Microsoft::WRL::ComPtr<ID3D12Device2> GetDeviceObject();
+    // Returns the adapter the device was created on
+    Microsoft::WRL::ComPtr<IDXGIAdapter4> GetAdapter();
 
+    // Returns the shader visible CBV/SRV/UAV heap, which needs to be bound for descriptor tables
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetSRVHeap();
+    // Returns the allocator for CPU only descriptors of the type, like render target views or descriptors which are copied to a shader visible heap
+    DescriptorAllocator& GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE a_Type);
+    // Returns the allocator of the shader visible CBV/SRV/UAV heap
+    DescriptorAllocator& GetShaderVisibleDescriptorAllocator();
+    // Returns the cache which shares root signatures between pipeline states with the same layout
+    RootSignatureCache& GetRootSignatureCache();
+    // Returns the cache which shares pipeline states and keeps the compiled pipelines on disk between runs
+    PipelineStateCache& GetPipelineStateCache();
 
     // Returns pointer to the command queue of the requested type
     CommandQueue* GetCommandQueue(D3D12_COMMAND_LIST_TYPE a_Type = D3D12_COMMAND_LIST_TYPE_DIRECT);
 
     // Returns the size of the descriptor of the requested type
     UINT GetDescriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE a_Type) const;
+    // Returns the resource binding tier, unbounded descriptor tables need at least tier 2
+    D3D12_RESOURCE_BINDING_TIER GetResourceBindingTier() const;
+    // Returns the highest root signature version the device supports, 1.1 or 1.0 on older runtimes and drivers
+    D3D_ROOT_SIGNATURE_VERSION GetRootSignatureVersion() const;
 private:
     ServiceLocator& m_Services;
 
+    Microsoft::WRL::ComPtr<IDXGIAdapter4> m_Adapter;
     Microsoft::WRL::ComPtr<ID3D12Device2> m_D3D12Device;
 
-    // Device owns the SRV heap currently. Subject to change.
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_SRVHeap;
+    // Declared before the command queues, so they are destroyed after them. The command lists of the queues can hold the last reference
+    // to a resource, which frees its descriptors when it goes away.
+    std::unique_ptr<DescriptorAllocator> m_DescriptorAllocators[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+    std::unique_ptr<DescriptorAllocator> m_ShaderVisibleDescriptorAllocator;
 
     std::unique_ptr<CommandQueue> m_DirectCommandQueue;
     std::unique_ptr<CommandQueue> m_CopyCommandQueue;
     std::unique_ptr<CommandQueue> m_ComputeCommandQueue;
+    std::unique_ptr<RootSignatureCache> m_RootSignatureCache;
+    std::unique_ptr<PipelineStateCache> m_PipelineStateCache;
 
-    UINT m_SRVHeapCapacity;
-    UINT m_NumSRVHeapEntries;
+    D3D12_RESOURCE_BINDING_TIER m_ResourceBindingTier;
+    D3D_ROOT_SIGNATURE_VERSION m_RootSignatureVersion;
 
     UINT m_RTVDescriptorSize;
     UINT m_DSVDescriptorSize;
@@ -0,0 +1,156 @@
+#include "DynamicDescriptorHeap.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+DynamicDescriptorHeap::DynamicDescriptorHeap(ServiceLocator& a_ServiceLocator, DynamicDescriptorPagePool& a_PagePool)
+    : m_Services(a_ServiceLocator)
+    , m_PagePool(a_PagePool)
+{
+}
+
+void DynamicDescriptorHeap::SetRootSignatureLayout(const std::vector<UINT>& a_DescriptorTableSizes)
+{
+    // A root signature has at most 64 parameters, so a bit per parameter is enough to track the stale tables
+    m_StagedTables.clear();
+    m_StagedTables.resize(a_DescriptorTableSizes.size());
+    for (size_t i = 0; i < a_DescriptorTableSizes.size(); i++)
+    {
+        if (a_DescriptorTableSizes[i] > m_PagePool.GetPageSize())
+        {
+            throw std::runtime_error("Descriptor table of root parameter " + std::to_string(i) + " doesn't fit in a dynamic descriptor page");
+        }
+        m_StagedTables[i].resize(a_DescriptorTableSizes[i], D3D12_CPU_DESCRIPTOR_HANDLE{ 0 });
+    }
+    m_StaleTables = 0;
+}
+
+void DynamicDescriptorHeap::StageDescriptors(UINT a_RootIndex, UINT a_Offset, UINT a_NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE a_SourceDescriptors)
+{
+    if (a_RootIndex >= m_StagedTables.size() || a_Offset + a_NumDescriptors > m_StagedTables[a_RootIndex].size())
+    {
+        throw std::runtime_error("Staged descriptors don't fit in the table of root parameter " + std::to_string(a_RootIndex));
+    }
+
+    const UINT descriptorSize = m_Services.m_Device->GetDescriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& table = m_StagedTables[a_RootIndex];
+    for (UINT i = 0; i < a_NumDescriptors; i++)
+    {
+        table[a_Offset + i].ptr = a_SourceDescriptors.ptr + static_cast<SIZE_T>(i) * descriptorSize;
+    }
+    m_StaleTables |= 1ull << a_RootIndex;
+}
+
+bool DynamicDescriptorHeap::HasStaleTables() const
+{
+    return m_StaleTables != 0;
+}
+
+bool DynamicDescriptorHeap::IsTableStale(UINT a_RootIndex) const
+{
+    return a_RootIndex < 64 && (m_StaleTables & (1ull << a_RootIndex)) != 0;
+}
+
+void DynamicDescriptorHeap::CommitStagedDescriptors(ID3D12GraphicsCommandList* a_CommandList)
+{
+    if (m_StaleTables == 0)
+    {
+        return;
+    }
+
+    UINT numDescriptors = 0;
+    for (size_t i = 0; i < m_StagedTables.size(); i++)
+    {
+        if ((m_StaleTables & (1ull << i)) != 0)
+        {
+            numDescriptors += static_cast<UINT>(m_StagedTables[i].size());
+        }
+    }
+
+    // The tables of a draw need to be in one page, the rest of the current page is skipped if they don't fit.
+    // Pages are all in the same heap, so the tables committed to earlier pages stay valid.
+    if (m_CurrentPage == nullptr || m_CurrentOffset + numDescriptors > m_PagePool.GetPageSize())
+    {
+        if (m_CurrentPage != nullptr)
+        {
+            m_UsedPages.push_back(m_CurrentPage);
+        }
+        m_CurrentPage = m_PagePool.RequestPage();
+        m_CurrentOffset = 0;
+
+        if (numDescriptors > m_PagePool.GetPageSize())
+        {
+            throw std::runtime_error("The descriptor tables of a draw don't fit in a dynamic descriptor page");
+        }
+    }
+
+    // Every staged descriptor is copied as its own range, so all the tables are copied with a single call.
+    // Slots which were never staged are left alone, shaders may not read them.
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> destinations;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> sources;
+    std::vector<std::pair<UINT, D3D12_GPU_DESCRIPTOR_HANDLE>> tables;
+    destinations.reserve(numDescriptors);
+    sources.reserve(numDescriptors);
+
+    const DescriptorAllocation& pageDescriptors = m_CurrentPage->m_Descriptors;
+    for (size_t i = 0; i < m_StagedTables.size(); i++)
+    {
+        if ((m_StaleTables & (1ull << i)) == 0)
+        {
+            continue;
+        }
+
+        const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& table = m_StagedTables[i];
+        for (UINT slot = 0; slot < table.size(); slot++)
+        {
+            if (table[slot].ptr != 0)
+            {
+                destinations.push_back(pageDescriptors.GetCPUHandle(m_CurrentOffset + slot));
+                sources.push_back(table[slot]);
+            }
+        }
+
+        tables.emplace_back(static_cast<UINT>(i), pageDescriptors.GetGPUHandle(m_CurrentOffset));
+        m_CurrentOffset += static_cast<UINT>(table.size());
+    }
+
+    if (!destinations.empty())
+    {
+        // Every range holds a single descriptor, which a null range size array stands for
+        m_Services.m_Device->GetDeviceObject()->CopyDescriptors(static_cast<UINT>(destinations.size()), destinations.data(), nullptr,
+            static_cast<UINT>(sources.size()), sources.data(), nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    for (const auto& table : tables)
+    {
+        a_CommandList->SetGraphicsRootDescriptorTable(table.first, table.second);
+    }
+    m_StaleTables = 0;
+}
+
+std::vector<DynamicDescriptorPagePool::Page*> DynamicDescriptorHeap::ReleasePages()
+{
+    if (m_CurrentPage != nullptr)
+    {
+        m_UsedPages.push_back(m_CurrentPage);
+        m_CurrentPage = nullptr;
+    }
+    m_CurrentOffset = 0;
+
+    std::vector<DynamicDescriptorPagePool::Page*> pages;
+    pages.swap(m_UsedPages);
+    return pages;
+}
+
+void DynamicDescriptorHeap::Reset()
+{
+    for (auto& table : m_StagedTables)
+    {
+        std::fill(table.begin(), table.end(), D3D12_CPU_DESCRIPTOR_HANDLE{ 0 });
+    }
+    m_StaleTables = 0;
+}
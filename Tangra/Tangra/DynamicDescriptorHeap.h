@@ -0,0 +1,49 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+#include "DynamicDescriptorPagePool.h"
+
+struct ServiceLocator;
+
+// Builds the descriptor tables of a command list from CPU descriptors which can live anywhere.
+// Descriptors are staged into the slots of the root signature's tables, and when a draw is recorded the tables which changed are copied
+// into a page of the shader visible heap with a single CopyDescriptors call and bound. Every command list has its own, just like the linear allocator.
+class DynamicDescriptorHeap
+{
+public:
+
+    DynamicDescriptorHeap(ServiceLocator& a_ServiceLocator, DynamicDescriptorPagePool& a_PagePool);
+
+    // Take over the table layout of a new root signature, the number of descriptors of every table by root parameter index.
+    // Root parameters which aren't tables or are unbounded have 0 descriptors. Drops everything which was staged.
+    void SetRootSignatureLayout(const std::vector<UINT>& a_DescriptorTableSizes);
+    // Stage descriptors from a CPU only heap into the slots of the table at the root parameter index, starting at the offset
+    void StageDescriptors(UINT a_RootIndex, UINT a_Offset, UINT a_NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE a_SourceDescriptors);
+
+    // Returns true if tables changed since they were last committed. The shader visible heap needs to be bound before committing them.
+    bool HasStaleTables() const;
+    // Returns true if the table at the root parameter index is bound again when the tables are committed
+    bool IsTableStale(UINT a_RootIndex) const;
+    // Copy the tables which changed into the shader visible heap and bind them as graphics root tables
+    void CommitStagedDescriptors(ID3D12GraphicsCommandList* a_CommandList);
+
+    // Hands over the pages after submission so the pool can recycle them once the GPU is done with them
+    std::vector<DynamicDescriptorPagePool::Page*> ReleasePages();
+    // Forget the staged descriptors, for when the list is reset
+    void Reset();
+private:
+    ServiceLocator& m_Services;
+    DynamicDescriptorPagePool& m_PagePool;
+
+    // Staged descriptors of every table, indexed by root parameter
+    std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>> m_StagedTables;
+    // Root parameters of the tables which changed since they were last committed
+    uint64_t m_StaleTables = 0;
+
+    DynamicDescriptorPagePool::Page* m_CurrentPage = nullptr;
+    UINT m_CurrentOffset = 0;
+    std::vector<DynamicDescriptorPagePool::Page*> m_UsedPages;
+};
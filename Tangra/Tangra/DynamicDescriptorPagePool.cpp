@@ -0,0 +1,71 @@
+#include "DynamicDescriptorPagePool.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+DynamicDescriptorPagePool::DynamicDescriptorPagePool(ServiceLocator& a_ServiceLocator, uint32_t a_PageSize)
+    : m_Services(a_ServiceLocator)
+    , m_PageSize(a_PageSize)
+{
+}
+
+DynamicDescriptorPagePool::~DynamicDescriptorPagePool()
+{
+}
+
+DynamicDescriptorPagePool::Page* DynamicDescriptorPagePool::RequestPage()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ++m_Statistics.m_NumRequests;
+
+    if (!m_AvailablePages.empty())
+    {
+        Page* page = m_AvailablePages.back();
+        m_AvailablePages.pop_back();
+        ++m_Statistics.m_NumReuseHits;
+        return page;
+    }
+
+    auto page = std::make_unique<Page>();
+    page->m_Descriptors = m_Services.m_Device->GetShaderVisibleDescriptorAllocator().Allocate(m_PageSize);
+
+    m_Pages.push_back(std::move(page));
+    m_Statistics.m_NumPages = m_Pages.size();
+
+    return m_Pages.back().get();
+}
+
+void DynamicDescriptorPagePool::ReturnPages(const std::vector<Page*>& a_Pages, uint64_t a_FenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    for (Page* page : a_Pages)
+    {
+        m_InFlightPages.emplace(a_FenceValue, page);
+    }
+    m_Statistics.m_NumInFlight = m_InFlightPages.size();
+}
+
+void DynamicDescriptorPagePool::RecycleCompletedPages(uint64_t a_CompletedFenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Pages are returned in submission order, so stop at the first one the GPU may still be reading from
+    while (!m_InFlightPages.empty() && m_InFlightPages.front().first <= a_CompletedFenceValue)
+    {
+        m_AvailablePages.push_back(m_InFlightPages.front().second);
+        m_InFlightPages.pop();
+    }
+    m_Statistics.m_NumInFlight = m_InFlightPages.size();
+}
+
+uint32_t DynamicDescriptorPagePool::GetPageSize() const
+{
+    return m_PageSize;
+}
+
+DynamicDescriptorPagePool::Statistics DynamicDescriptorPagePool::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
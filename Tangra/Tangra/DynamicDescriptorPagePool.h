@@ -0,0 +1,63 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+
+struct ServiceLocator;
+
+// Pool of descriptor ranges in the shader visible heap which the dynamic descriptor heaps of the command lists copy their tables into.
+// Owned by a command queue. Pages are handed back with the fence value of the submission that used them and reused in the same order,
+// so together they work like a ring in the shader visible heap.
+class DynamicDescriptorPagePool
+{
+public:
+
+    struct Page
+    {
+        DescriptorAllocation m_Descriptors;
+    };
+
+    struct Statistics
+    {
+        // Number of pages taken from the shader visible heap
+        size_t m_NumPages = 0;
+        // Number of pages currently waiting for the GPU to finish with them
+        size_t m_NumInFlight = 0;
+        uint64_t m_NumRequests = 0;
+        uint64_t m_NumReuseHits = 0;
+    };
+
+    DynamicDescriptorPagePool(ServiceLocator& a_ServiceLocator, uint32_t a_PageSize = 256);
+    // The pages aren't freed, the shader visible heap is destroyed together with the queues
+    ~DynamicDescriptorPagePool();
+
+    // Returns a page that is free to copy descriptors into, taking a new range from the shader visible heap if no recycled page is available. Thread-safe.
+    Page* RequestPage();
+    // Hand pages back to the pool. They will not be reused until the fence has reached the specified value. Thread-safe.
+    void ReturnPages(const std::vector<Page*>& a_Pages, uint64_t a_FenceValue);
+    // Make the pages of all the submissions the GPU has finished available again
+    void RecycleCompletedPages(uint64_t a_CompletedFenceValue);
+
+    uint32_t GetPageSize() const;
+    Statistics GetStatistics();
+private:
+    ServiceLocator& m_Services;
+
+    uint32_t m_PageSize;
+
+    std::mutex m_Mutex;
+
+    std::vector<std::unique_ptr<Page>> m_Pages;
+    std::vector<Page*> m_AvailablePages;
+    // Pages which have been returned, ordered by the fence value they are waiting for
+    std::queue<std::pair<uint64_t, Page*>> m_InFlightPages;
+
+    Statistics m_Statistics;
+};
@@ -11,17 +11,22 @@ namespace fs = std::experimental::filesystem;
 int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ PWSTR lpCmdLine, _In_ int nCmdShow)
 {
     hPrevInstance;
-    lpCmdLine;
     nCmdShow;
 
     Application::InitInfo appInitInfo;
     appInitInfo.m_NumBuffers = 3;
+    appInitInfo.m_FramesInFlight = 2;
     appInitInfo.m_CreateDebugConsole = true;
     appInitInfo.m_HInstance = hInstance;
     appInitInfo.m_Height = 800;
     appInitInfo.m_Width = 800;
     appInitInfo.m_WindowTitle = L"Tongra cause retarded";
+    // Run with -benchmark to measure how recording scales with the number of cores
+    appInitInfo.m_RunRecordingBenchmark = wcsstr(lpCmdLine, L"-benchmark") != nullptr;
     Application::Create(appInitInfo);
 
     Application::Run();
+
+    // Tear the application down before the global services are destroyed
+    Application::Destroy();
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+FramePacer::FramePacer(size_t a_FramesInFlight)
+    : m_FenceValues(std::max<size_t>(1, a_FramesInFlight), 0)
+    , m_CurrentFrame(0)
+{
+}
+
+uint64_t FramePacer::BeginFrame()
+{
+    return m_FenceValues[m_CurrentFrame];
+}
+
+void FramePacer::EndFrame(uint64_t a_FenceValue)
+{
+    m_FenceValues[m_CurrentFrame] = a_FenceValue;
+    m_CurrentFrame = (m_CurrentFrame + 1) % m_FenceValues.size();
+}
+
+size_t FramePacer::GetFramesInFlight() const
+{
+    return m_FenceValues.size();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Limits the number of frames the CPU can record ahead of the GPU. Every frame in flight has a context with the fence value of its last submission,
+// and a frame only waits for the frame which used its context before, so frame N + k waits for frame N when k frames can be in flight.
+// Only does the bookkeeping, the caller waits for the fence, so it can be checked without a GPU. Not thread-safe.
+class FramePacer
+{
+public:
+
+    // At least one frame is always in flight
+    FramePacer(size_t a_FramesInFlight);
+
+    // Start the next frame. Returns the fence value the CPU needs to wait for before it records the frame, 0 if it doesn't need to wait.
+    uint64_t BeginFrame();
+    // Finish the frame with the fence value of its last submission and move on to the next context
+    void EndFrame(uint64_t a_FenceValue);
+
+    size_t GetFramesInFlight() const;
+private:
+
+    // Fence value of the last submission of the frame which last used every context
+    std::vector<uint64_t> m_FenceValues;
+    size_t m_CurrentFrame;
+};
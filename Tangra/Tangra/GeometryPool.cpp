@@ -0,0 +1,231 @@
+#include "GeometryPool.h"
+#include "GpuMemoryAllocator.h"
+#include "GraphicsCommandList.h"
+#include "ServiceLocator.h"
+
+#include "d3dx12.h"
+
+#include <algorithm>
+
+using namespace Microsoft::WRL;
+
+const GeometryPool::MeshHandle GeometryPool::s_InvalidMesh;
+
+GeometryPool::VertexPool::VertexPool(uint64_t a_NumVertices)
+    : m_Allocator(a_NumVertices)
+{
+}
+
+GeometryPool::GeometryPool(ServiceLocator& a_ServiceLocator, UINT a_InitialVerticesPerStride, UINT a_InitialIndices, float a_CompactionThreshold)
+    : m_Services(a_ServiceLocator)
+    , m_InitialVerticesPerStride(a_InitialVerticesPerStride)
+    , m_CompactionThreshold(a_CompactionThreshold)
+    , m_IndexAllocator(a_InitialIndices)
+{
+    ComPtr<ID3D12Resource> indexBuffer = CreateBuffer(static_cast<uint64_t>(a_InitialIndices) * sizeof(uint32_t));
+    D3D12_INDEX_BUFFER_VIEW indexBufferView = { indexBuffer->GetGPUVirtualAddress(), a_InitialIndices * static_cast<UINT>(sizeof(uint32_t)), DXGI_FORMAT_R32_UINT };
+    m_IndexBuffer = IndexBuffer(indexBuffer, indexBufferView, a_InitialIndices);
+    m_IndexBuffer.SetName(L"Geometry Pool Index Buffer");
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+GeometryPool::MeshHandle GeometryPool::AddMesh(GraphicsCommandList& a_CommandList, const void* a_Vertices, UINT a_VertexStride, UINT a_NumVertices,
+    const std::vector<uint32_t>& a_Indices)
+{
+    if (a_NumVertices == 0 || a_Indices.empty())
+    {
+        return s_InvalidMesh;
+    }
+
+    // Every vertex format gets its own buffer, so the vertices of a mesh line up with the stride
+    std::unique_ptr<VertexPool>& vertexPool = m_VertexPools[a_VertexStride];
+    if (!vertexPool)
+    {
+        vertexPool = std::make_unique<VertexPool>(std::max(m_InitialVerticesPerStride, a_NumVertices));
+        ComPtr<ID3D12Resource> vertexBuffer = CreateBuffer(vertexPool->m_Allocator.GetSize() * a_VertexStride);
+        D3D12_VERTEX_BUFFER_VIEW vertexBufferView = { vertexBuffer->GetGPUVirtualAddress(), static_cast<UINT>(vertexPool->m_Allocator.GetSize() * a_VertexStride), a_VertexStride };
+        vertexPool->m_Buffer = VertexBuffer(vertexBuffer, vertexBufferView);
+        vertexPool->m_Buffer.SetName(L"Geometry Pool Vertex Buffer (stride " + std::to_wstring(a_VertexStride) + L")");
+    }
+
+    VertexBuffer& vertexBuffer = vertexPool->m_Buffer;
+    std::unordered_map<uint64_t, uint64_t> movedVertices;
+    uint64_t baseVertex = AllocateRange(a_CommandList, vertexPool->m_Allocator, vertexBuffer, a_VertexStride, a_NumVertices,
+        [&vertexBuffer, a_VertexStride](ComPtr<ID3D12Resource> a_Buffer, uint64_t a_NumElements)
+    {
+        D3D12_VERTEX_BUFFER_VIEW vertexBufferView = { a_Buffer->GetGPUVirtualAddress(), static_cast<UINT>(a_NumElements * a_VertexStride), a_VertexStride };
+        vertexBuffer = VertexBuffer(a_Buffer, vertexBufferView);
+        vertexBuffer.SetName(L"Geometry Pool Vertex Buffer (stride " + std::to_wstring(a_VertexStride) + L")");
+    }, movedVertices);
+
+    IndexBuffer& indexBuffer = m_IndexBuffer;
+    std::unordered_map<uint64_t, uint64_t> movedIndices;
+    uint64_t firstIndex = AllocateRange(a_CommandList, m_IndexAllocator, m_IndexBuffer, sizeof(uint32_t), static_cast<UINT>(a_Indices.size()),
+        [&indexBuffer](ComPtr<ID3D12Resource> a_Buffer, uint64_t a_NumElements)
+    {
+        D3D12_INDEX_BUFFER_VIEW indexBufferView = { a_Buffer->GetGPUVirtualAddress(), static_cast<UINT>(a_NumElements * sizeof(uint32_t)), DXGI_FORMAT_R32_UINT };
+        indexBuffer = IndexBuffer(a_Buffer, indexBufferView, static_cast<UINT>(a_NumElements));
+        indexBuffer.SetName(L"Geometry Pool Index Buffer");
+    }, movedIndices);
+
+    // Point the meshes which were moved by a compaction to their new ranges
+    for (Mesh& mesh : m_Meshes)
+    {
+        if (mesh.m_NumVertices == 0)
+        {
+            continue;
+        }
+
+        auto movedVertex = movedVertices.find(mesh.m_BaseVertex);
+        if (mesh.m_VertexStride == a_VertexStride && movedVertex != movedVertices.end())
+        {
+            mesh.m_BaseVertex = static_cast<UINT>(movedVertex->second);
+        }
+        auto movedIndex = movedIndices.find(mesh.m_FirstIndex);
+        if (movedIndex != movedIndices.end())
+        {
+            mesh.m_FirstIndex = static_cast<UINT>(movedIndex->second);
+        }
+    }
+
+    UploadData(a_CommandList, vertexBuffer, baseVertex * a_VertexStride, a_Vertices, static_cast<uint64_t>(a_NumVertices) * a_VertexStride);
+    UploadData(a_CommandList, m_IndexBuffer, firstIndex * sizeof(uint32_t), a_Indices.data(), a_Indices.size() * sizeof(uint32_t));
+
+    Mesh mesh;
+    mesh.m_VertexStride = a_VertexStride;
+    mesh.m_BaseVertex = static_cast<UINT>(baseVertex);
+    mesh.m_NumVertices = a_NumVertices;
+    mesh.m_FirstIndex = static_cast<UINT>(firstIndex);
+    mesh.m_NumIndices = static_cast<UINT>(a_Indices.size());
+
+    if (!m_FreeMeshHandles.empty())
+    {
+        MeshHandle handle = m_FreeMeshHandles.back();
+        m_FreeMeshHandles.pop_back();
+        m_Meshes[handle] = mesh;
+        return handle;
+    }
+    m_Meshes.push_back(mesh);
+    return static_cast<MeshHandle>(m_Meshes.size() - 1);
+}
+
+void GeometryPool::RemoveMesh(MeshHandle a_Mesh)
+{
+    Mesh& mesh = m_Meshes[a_Mesh];
+    if (mesh.m_NumVertices == 0)
+    {
+        return;
+    }
+
+    m_VertexPools[mesh.m_VertexStride]->m_Allocator.Free(mesh.m_BaseVertex);
+    m_IndexAllocator.Free(mesh.m_FirstIndex);
+
+    mesh = Mesh();
+    m_FreeMeshHandles.push_back(a_Mesh);
+}
+
+const GeometryPool::Mesh& GeometryPool::GetMesh(MeshHandle a_Mesh) const
+{
+    return m_Meshes[a_Mesh];
+}
+
+void GeometryPool::SetBuffers(GraphicsCommandList& a_CommandList, MeshHandle a_Mesh)
+{
+    a_CommandList.SetVertexBuffer(m_VertexPools[m_Meshes[a_Mesh].m_VertexStride]->m_Buffer);
+    a_CommandList.SetIndexBuffer(m_IndexBuffer);
+}
+
+void GeometryPool::DrawMesh(GraphicsCommandList& a_CommandList, MeshHandle a_Mesh, UINT a_InstanceCount)
+{
+    SetBuffers(a_CommandList, a_Mesh);
+
+    const Mesh& mesh = m_Meshes[a_Mesh];
+    a_CommandList.DrawIndexed(mesh.m_NumIndices, a_InstanceCount, mesh.m_FirstIndex, mesh.m_BaseVertex);
+}
+
+GeometryPool::Statistics GeometryPool::GetStatistics() const
+{
+    Statistics statistics = m_Statistics;
+    statistics.m_NumMeshes = m_Meshes.size() - m_FreeMeshHandles.size();
+    statistics.m_NumVertexBuffers = m_VertexPools.size();
+    for (const auto& vertexPool : m_VertexPools)
+    {
+        statistics.m_VertexBufferBytes += vertexPool.second->m_Allocator.GetSize() * vertexPool.first;
+        statistics.m_UsedVertexBytes += vertexPool.second->m_Allocator.GetAllocatedSize() * vertexPool.first;
+    }
+    statistics.m_IndexBufferBytes = m_IndexAllocator.GetSize() * sizeof(uint32_t);
+    statistics.m_UsedIndexBytes = m_IndexAllocator.GetAllocatedSize() * sizeof(uint32_t);
+    return statistics;
+}
+
+uint64_t GeometryPool::AllocateRange(GraphicsCommandList& a_CommandList, OffsetAllocator& a_Allocator, RenderResource& a_Buffer, UINT a_ElementSize, UINT a_NumElements,
+    const std::function<void(ComPtr<ID3D12Resource>, uint64_t)>& a_ReplaceBuffer, std::unordered_map<uint64_t, uint64_t>& a_MovedOffsets)
+{
+    if (a_Allocator.GetFragmentation() <= m_CompactionThreshold)
+    {
+        uint64_t offset = a_Allocator.Allocate(a_NumElements);
+        if (offset != OffsetAllocator::s_InvalidOffset)
+        {
+            return offset;
+        }
+    }
+
+    // Compact, and grow if the free space wouldn't fit the range even without gaps
+    uint64_t newSize = a_Allocator.GetSize();
+    if (a_Allocator.GetSize() - a_Allocator.GetAllocatedSize() < a_NumElements)
+    {
+        newSize = std::max(a_Allocator.GetSize() * 2, a_Allocator.GetAllocatedSize() + a_NumElements);
+        ++m_Statistics.m_NumGrowths;
+    }
+    else
+    {
+        ++m_Statistics.m_NumCompactions;
+    }
+
+    std::vector<OffsetAllocator::Move> moves = a_Allocator.Compact();
+    a_Allocator.Grow(newSize);
+
+    // The moved ranges can overlap their old location, so everything is copied into a new buffer instead of within the old one.
+    // Ranges in front of the first move stay where they are and are copied in one go.
+    RenderResource oldBuffer = a_Buffer;
+    a_ReplaceBuffer(CreateBuffer(newSize * a_ElementSize), newSize);
+
+    a_CommandList.TransitionResource(oldBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    a_CommandList.TransitionResource(a_Buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+
+    ID3D12Resource* source = oldBuffer.GetD3D12Resource().Get();
+    ID3D12Resource* destination = a_Buffer.GetD3D12Resource().Get();
+    uint64_t numKeptElements = moves.empty() ? a_Allocator.GetAllocatedSize() : moves.front().m_NewOffset;
+    if (numKeptElements > 0)
+    {
+        a_CommandList.CopyBufferRegion(destination, 0, source, 0, numKeptElements * a_ElementSize);
+    }
+    for (const OffsetAllocator::Move& move : moves)
+    {
+        a_CommandList.CopyBufferRegion(destination, move.m_NewOffset * a_ElementSize, source, move.m_OldOffset * a_ElementSize, move.m_Size * a_ElementSize);
+        a_MovedOffsets[move.m_OldOffset] = move.m_NewOffset;
+    }
+
+    // Lists submitted before this one can still be drawing from the old buffer
+    a_CommandList.TrackIntermediateBuffer(oldBuffer.GetD3D12Resource());
+
+    return a_Allocator.Allocate(a_NumElements);
+}
+
+ComPtr<ID3D12Resource> GeometryPool::CreateBuffer(uint64_t a_NumBytes)
+{
+    return m_Services.m_MemoryAllocator->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(a_NumBytes), D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+}
+
+void GeometryPool::UploadData(GraphicsCommandList& a_CommandList, const RenderResource& a_Buffer, uint64_t a_Offset, const void* a_Data, uint64_t a_NumBytes)
+{
+    // The buffer is in use by the direct queue, so it is written on the list instead of the copy queue
+    LinearAllocator::Allocation allocation = a_CommandList.AllocateDynamic(a_NumBytes, 16);
+    memcpy(allocation.m_CPUAddress, a_Data, a_NumBytes);
+
+    a_CommandList.TransitionResource(a_Buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+    a_CommandList.CopyBufferRegion(a_Buffer.GetD3D12Resource().Get(), a_Offset, allocation.m_Resource, allocation.m_Offset, a_NumBytes);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "IndexBuffer.h"
+#include "OffsetAllocator.h"
+#include "VertexBuffer.h"
+
+class GraphicsCommandList;
+
+struct ServiceLocator;
+
+// Stores the geometry of many meshes in a few large buffers: a vertex buffer per vertex stride and one 32-bit index buffer.
+// Meshes are ranges of those buffers, so meshes with the same vertex format are drawn without binding other buffers in between.
+// The buffers grow when they are full and are compacted when freed meshes leave too many gaps. Both happen on the command list
+// a mesh is added with, so meshes should be added and removed outside of parallel recording. Not thread-safe.
+class GeometryPool
+{
+public:
+    using MeshHandle = uint32_t;
+
+    static const MeshHandle s_InvalidMesh = UINT32_MAX;
+
+    struct Mesh
+    {
+        UINT m_VertexStride = 0;
+        UINT m_BaseVertex = 0;
+        UINT m_NumVertices = 0;
+        UINT m_FirstIndex = 0;
+        UINT m_NumIndices = 0;
+    };
+
+    struct Statistics
+    {
+        size_t m_NumMeshes = 0;
+        size_t m_NumVertexBuffers = 0;
+        uint64_t m_VertexBufferBytes = 0;
+        uint64_t m_UsedVertexBytes = 0;
+        uint64_t m_IndexBufferBytes = 0;
+        uint64_t m_UsedIndexBytes = 0;
+        uint64_t m_NumGrowths = 0;
+        uint64_t m_NumCompactions = 0;
+    };
+
+    // The buffers are compacted when their fragmentation passes the threshold, see OffsetAllocator::GetFragmentation
+    GeometryPool(ServiceLocator& a_ServiceLocator, UINT a_InitialVerticesPerStride = 64 * 1024, UINT a_InitialIndices = 256 * 1024,
+        float a_CompactionThreshold = 0.5f);
+    ~GeometryPool();
+
+    // Copy the mesh into the pool. The indices are relative to the first vertex of the mesh.
+    template<typename T>
+    MeshHandle AddMesh(GraphicsCommandList& a_CommandList, const std::vector<T>& a_Vertices, const std::vector<uint32_t>& a_Indices);
+    MeshHandle AddMesh(GraphicsCommandList& a_CommandList, const void* a_Vertices, UINT a_VertexStride, UINT a_NumVertices,
+        const std::vector<uint32_t>& a_Indices);
+    // Free the ranges of the mesh. Lists which have already been recorded can still draw it, the ranges are only overwritten by later lists.
+    void RemoveMesh(MeshHandle a_Mesh);
+
+    // Returns where the mesh currently is in the buffers, which changes when the pool grows or is compacted
+    const Mesh& GetMesh(MeshHandle a_Mesh) const;
+
+    // Bind the vertex and index buffer the mesh is in. Binding the buffers which are already bound is filtered out by the list.
+    void SetBuffers(GraphicsCommandList& a_CommandList, MeshHandle a_Mesh);
+    // Bind the buffers of the mesh and draw it
+    void DrawMesh(GraphicsCommandList& a_CommandList, MeshHandle a_Mesh, UINT a_InstanceCount = 1);
+
+    Statistics GetStatistics() const;
+private:
+
+    struct VertexPool
+    {
+        VertexBuffer m_Buffer;
+        OffsetAllocator m_Allocator;
+
+        VertexPool(uint64_t a_NumVertices);
+    };
+
+    // Returns a range of the allocator, compacting the buffer first if it is too fragmented and growing it if the range doesn't fit.
+    // Both move the contents into a new buffer, which the callback puts in place of the old one. Ranges which moved are added to a_MovedOffsets.
+    uint64_t AllocateRange(GraphicsCommandList& a_CommandList, OffsetAllocator& a_Allocator, RenderResource& a_Buffer, UINT a_ElementSize, UINT a_NumElements,
+        const std::function<void(Microsoft::WRL::ComPtr<ID3D12Resource>, uint64_t)>& a_ReplaceBuffer, std::unordered_map<uint64_t, uint64_t>& a_MovedOffsets);
+    // Create the buffer which backs a vertex or index buffer
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(uint64_t a_NumBytes);
+    // Copy data into the buffer through the dynamic allocator of the list
+    void UploadData(GraphicsCommandList& a_CommandList, const RenderResource& a_Buffer, uint64_t a_Offset, const void* a_Data, uint64_t a_NumBytes);
+
+    ServiceLocator& m_Services;
+
+    UINT m_InitialVerticesPerStride;
+    float m_CompactionThreshold;
+
+    std::unordered_map<UINT, std::unique_ptr<VertexPool>> m_VertexPools;
+
+    IndexBuffer m_IndexBuffer;
+    OffsetAllocator m_IndexAllocator;
+
+    std::vector<Mesh> m_Meshes;
+    std::vector<MeshHandle> m_FreeMeshHandles;
+
+    Statistics m_Statistics;
+};
+
+template<typename T>
+GeometryPool::MeshHandle GeometryPool::AddMesh(GraphicsCommandList& a_CommandList, const std::vector<T>& a_Vertices, const std::vector<uint32_t>& a_Indices)
+{
+    return AddMesh(a_CommandList, a_Vertices.data(), sizeof(T), static_cast<UINT>(a_Vertices.size()), a_Indices);
+}
@@ -0,0 +1,286 @@
+#include "GpuMemoryAllocator.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ResidencyManager.h"
+#include "ServiceLocator.h"
+
+#include "d3dx12.h"
+
+#include <atomic>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    // Identifies the releaser in the private data of the resources
+    const GUID g_AllocationReleaserGUID = { 0x6f1c7a52, 0x3d8e, 0x4b9a, { 0x9e, 0x21, 0x47, 0xc5, 0x0b, 0x8d, 0x13, 0xa6 } };
+
+    // Textures which are not render targets can use 4 KB alignment if they are small enough
+    const uint64_t g_MinBlockSize = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+}
+
+// Attached to a resource as private data, so it is released together with the resource. Frees the memory of a placed resource,
+// or stops tracking the residency of a committed resource.
+class GpuMemoryAllocator::AllocationReleaser final : public IUnknown
+{
+public:
+    AllocationReleaser(std::shared_ptr<Pool> a_Pool, Heap* a_Heap, uint64_t a_Offset)
+        : m_Pool(a_Pool)
+        , m_Heap(a_Heap)
+        , m_Offset(a_Offset)
+    {
+    }
+
+    AllocationReleaser(ResidencyManager* a_ResidencyManager, uint64_t a_ResidencyObject)
+        : m_Heap(nullptr)
+        , m_Offset(0)
+        , m_ResidencyManager(a_ResidencyManager)
+        , m_ResidencyObject(a_ResidencyObject)
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID a_RIID, void** a_Object) override
+    {
+        if (a_RIID == __uuidof(IUnknown))
+        {
+            *a_Object = static_cast<IUnknown*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *a_Object = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++m_RefCount;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refCount = --m_RefCount;
+        if (refCount == 0)
+        {
+            if (m_Pool)
+            {
+                m_Pool->Free(m_Heap, m_Offset);
+            }
+            if (m_ResidencyManager)
+            {
+                m_ResidencyManager->Untrack(m_ResidencyObject);
+            }
+            delete this;
+        }
+        return refCount;
+    }
+private:
+    std::atomic<ULONG> m_RefCount{ 1 };
+
+    std::shared_ptr<Pool> m_Pool;
+    Heap* m_Heap;
+    uint64_t m_Offset;
+
+    ResidencyManager* m_ResidencyManager = nullptr;
+    uint64_t m_ResidencyObject = 0;
+};
+
+GpuMemoryAllocator::Heap::Heap(uint64_t a_Size)
+    : m_Allocator(a_Size, g_MinBlockSize)
+{
+}
+
+GpuMemoryAllocator::Heap::~Heap()
+{
+    if (m_ResidencyManager)
+    {
+        m_ResidencyManager->Untrack(m_ResidencyObject);
+    }
+}
+
+void GpuMemoryAllocator::Pool::Free(Heap* a_Heap, uint64_t a_Offset)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    a_Heap->m_Allocator.Free(a_Offset);
+    if (a_Heap->m_Allocator.GetNumAllocations() == 0 && m_Heaps.size() > 1)
+    {
+        for (auto it = m_Heaps.begin(); it != m_Heaps.end(); ++it)
+        {
+            if (it->get() == a_Heap)
+            {
+                m_Heaps.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+GpuMemoryAllocator::GpuMemoryAllocator(ServiceLocator& a_ServiceLocator, uint64_t a_HeapSize)
+    : m_Services(a_ServiceLocator)
+    , m_HeapSize(a_HeapSize)
+{
+    for (auto& heapTypePools : m_Pools)
+    {
+        for (auto& pool : heapTypePools)
+        {
+            pool = std::make_shared<Pool>();
+        }
+    }
+}
+
+GpuMemoryAllocator::~GpuMemoryAllocator()
+{
+}
+
+ComPtr<ID3D12Resource> GpuMemoryAllocator::CreateResource(const D3D12_RESOURCE_DESC& a_Desc, D3D12_HEAP_TYPE a_HeapType,
+    D3D12_RESOURCE_STATES a_InitialState, const D3D12_CLEAR_VALUE* a_ClearValue)
+{
+    auto device = m_Services.m_Device->GetDeviceObject();
+    ResourceCategory category = GetCategory(a_Desc);
+
+    // Ask for the small alignment first, the device falls back to the default alignment if the texture is too large for it
+    D3D12_RESOURCE_DESC desc = a_Desc;
+    if (category == ResourceCategory::Texture && desc.Alignment == 0)
+    {
+        desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+    }
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->GetResourceAllocationInfo(0, 1, &desc);
+    if (allocationInfo.Alignment != desc.Alignment && desc.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+    {
+        desc.Alignment = 0;
+        allocationInfo = device->GetResourceAllocationInfo(0, 1, &desc);
+    }
+
+    // Upload and readback heaps live in system memory, only video memory counts against the budget
+    ResidencyManager* residencyManager = a_HeapType == D3D12_HEAP_TYPE_DEFAULT ? m_Services.m_ResidencyManager.get() : nullptr;
+
+    ComPtr<ID3D12Resource> resource;
+    if (allocationInfo.SizeInBytes > m_HeapSize)
+    {
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(a_HeapType);
+        ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &a_Desc, a_InitialState, a_ClearValue, IID_PPV_ARGS(&resource)));
+
+        if (residencyManager)
+        {
+            ResidencyManager::ObjectId object = residencyManager->Track(resource.Get(), allocationInfo.SizeInBytes);
+            ResidencyManager::SetResidencyObject(resource.Get(), object);
+
+            AllocationReleaser* releaser = new AllocationReleaser(residencyManager, object);
+            HRESULT result = resource->SetPrivateDataInterface(g_AllocationReleaserGUID, releaser);
+            releaser->Release();
+            ThrowIfFailed(result);
+        }
+
+        std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+        ++m_NumCommittedResources;
+        return resource;
+    }
+
+    std::shared_ptr<Pool>& pool = m_Pools[GetHeapTypeIndex(a_HeapType)][static_cast<size_t>(category)];
+    Heap* heap = nullptr;
+    uint64_t offset = BuddyAllocator::s_InvalidOffset;
+    {
+        std::lock_guard<std::mutex> lock(pool->m_Mutex);
+
+        for (auto& poolHeap : pool->m_Heaps)
+        {
+            offset = poolHeap->m_Allocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+            if (offset != BuddyAllocator::s_InvalidOffset)
+            {
+                heap = poolHeap.get();
+                break;
+            }
+        }
+
+        if (heap == nullptr)
+        {
+            static const D3D12_HEAP_FLAGS s_CategoryFlags[] = { D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+                D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES };
+
+            // MSAA textures need 4 MB alignment, which covers everything else as well
+            auto newHeap = std::make_unique<Heap>(m_HeapSize);
+            CD3DX12_HEAP_DESC heapDesc(m_HeapSize, a_HeapType, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT, s_CategoryFlags[static_cast<size_t>(category)]);
+            ThrowIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&newHeap->m_Heap)));
+            newHeap->m_Heap->SetName(L"GPU Memory Allocator Heap");
+            if (residencyManager)
+            {
+                newHeap->m_ResidencyManager = residencyManager;
+                newHeap->m_ResidencyObject = residencyManager->Track(newHeap->m_Heap.Get(), m_HeapSize);
+            }
+
+            offset = newHeap->m_Allocator.Allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+            heap = newHeap.get();
+            pool->m_Heaps.push_back(std::move(newHeap));
+        }
+
+        HRESULT result = device->CreatePlacedResource(heap->m_Heap.Get(), offset, &desc, a_InitialState, a_ClearValue, IID_PPV_ARGS(&resource));
+        if (FAILED(result))
+        {
+            heap->m_Allocator.Free(offset);
+            ThrowIfFailed(result);
+        }
+    }
+
+    // The resource holds the only reference to the releaser from here on. Releasing it takes the pool lock, so this happens outside of it.
+    AllocationReleaser* releaser = new AllocationReleaser(pool, heap, offset);
+    HRESULT result = resource->SetPrivateDataInterface(g_AllocationReleaserGUID, releaser);
+    releaser->Release();
+    ThrowIfFailed(result);
+
+    if (heap->m_ResidencyManager)
+    {
+        ResidencyManager::SetResidencyObject(resource.Get(), heap->m_ResidencyObject);
+    }
+
+    return resource;
+}
+
+GpuMemoryAllocator::Statistics GpuMemoryAllocator::GetStatistics()
+{
+    Statistics statistics;
+    for (auto& heapTypePools : m_Pools)
+    {
+        for (auto& pool : heapTypePools)
+        {
+            std::lock_guard<std::mutex> lock(pool->m_Mutex);
+            for (auto& heap : pool->m_Heaps)
+            {
+                statistics.m_NumHeaps++;
+                statistics.m_HeapBytes += heap->m_Allocator.GetSize();
+                statistics.m_AllocatedBytes += heap->m_Allocator.GetAllocatedSize();
+                statistics.m_NumPlacedResources += heap->m_Allocator.GetNumAllocations();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+    statistics.m_NumCommittedResources = m_NumCommittedResources;
+    return statistics;
+}
+
+GpuMemoryAllocator::ResourceCategory GpuMemoryAllocator::GetCategory(const D3D12_RESOURCE_DESC& a_Desc)
+{
+    if (a_Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        return ResourceCategory::Buffer;
+    }
+    if ((a_Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0)
+    {
+        return ResourceCategory::RenderTargetTexture;
+    }
+    return ResourceCategory::Texture;
+}
+
+size_t GpuMemoryAllocator::GetHeapTypeIndex(D3D12_HEAP_TYPE a_HeapType)
+{
+    switch (a_HeapType)
+    {
+    case D3D12_HEAP_TYPE_UPLOAD:
+        return 1;
+    case D3D12_HEAP_TYPE_READBACK:
+        return 2;
+    case D3D12_HEAP_TYPE_DEFAULT:
+    default:
+        return 0;
+    }
+}
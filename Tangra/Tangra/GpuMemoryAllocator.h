@@ -0,0 +1,91 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BuddyAllocator.h"
+
+class ResidencyManager;
+
+struct ServiceLocator;
+
+// Creates resources as placed resources in large heaps instead of giving each of them its own implicit heap.
+// Every heap type has a pool per resource category, because heaps can only hold one category on resource heap tier 1.
+// The memory of a resource is freed when the resource is destroyed, so the resources can be handled like committed ones.
+// Resources larger than a heap still get a committed resource. Heaps and committed resources of the default heap type are tracked by the residency manager.
+// Thread-safe.
+class GpuMemoryAllocator
+{
+public:
+
+    struct Statistics
+    {
+        size_t m_NumHeaps = 0;
+        uint64_t m_HeapBytes = 0;
+        // Size of the blocks handed out to placed resources
+        uint64_t m_AllocatedBytes = 0;
+        size_t m_NumPlacedResources = 0;
+        uint64_t m_NumCommittedResources = 0;
+    };
+
+    // The heap size needs to be a power of two
+    GpuMemoryAllocator(ServiceLocator& a_ServiceLocator, uint64_t a_HeapSize = 64 * 1024 * 1024);
+    ~GpuMemoryAllocator();
+
+    // Create a resource in a heap of the specified type, a drop-in replacement for CreateCommittedResource
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(const D3D12_RESOURCE_DESC& a_Desc, D3D12_HEAP_TYPE a_HeapType,
+        D3D12_RESOURCE_STATES a_InitialState, const D3D12_CLEAR_VALUE* a_ClearValue = nullptr);
+
+    Statistics GetStatistics();
+private:
+
+    // Resources are split up the way resource heap tier 1 requires
+    enum class ResourceCategory
+    {
+        Buffer,
+        Texture,
+        RenderTargetTexture,
+        Count
+    };
+
+    struct Heap
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> m_Heap;
+        BuddyAllocator m_Allocator;
+
+        // Set if the heap is tracked, the heap is untracked before it is released
+        ResidencyManager* m_ResidencyManager = nullptr;
+        uint64_t m_ResidencyObject = 0;
+
+        Heap(uint64_t a_Size);
+        ~Heap();
+    };
+
+    // Heaps of a single type and category. Shared with the resources, so the memory can still be freed if a resource outlives the allocator.
+    struct Pool
+    {
+        std::mutex m_Mutex;
+        std::vector<std::unique_ptr<Heap>> m_Heaps;
+
+        // Give the block back to its heap and release the heap if it became empty, keeping at least one
+        void Free(Heap* a_Heap, uint64_t a_Offset);
+    };
+
+    class AllocationReleaser;
+
+    ServiceLocator& m_Services;
+
+    uint64_t m_HeapSize;
+
+    std::shared_ptr<Pool> m_Pools[3][static_cast<size_t>(ResourceCategory::Count)];
+
+    std::mutex m_StatisticsMutex;
+    uint64_t m_NumCommittedResources = 0;
+
+    static ResourceCategory GetCategory(const D3D12_RESOURCE_DESC& a_Desc);
+    static size_t GetHeapTypeIndex(D3D12_HEAP_TYPE a_HeapType);
+};
@@ -4,22 +4,47 @@
 #include "Application.h"
 #include "Device.h"
 #include "PipelineState.h"
+#include "Texture.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 #include "ServiceLocator.h"
 #include <DirectXTex.h>
 
+#include <stdexcept>
+
 using namespace DirectX;
 using namespace Microsoft::WRL;
 
-GraphicsCommandList::GraphicsCommandList(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type)
+// d3dx12.h already provides the comparison for viewports
+namespace
+{
+    bool operator==(const D3D12_VERTEX_BUFFER_VIEW& a_Left, const D3D12_VERTEX_BUFFER_VIEW& a_Right)
+    {
+        return a_Left.BufferLocation == a_Right.BufferLocation && a_Left.SizeInBytes == a_Right.SizeInBytes && a_Left.StrideInBytes == a_Right.StrideInBytes;
+    }
+
+    bool operator==(const D3D12_INDEX_BUFFER_VIEW& a_Left, const D3D12_INDEX_BUFFER_VIEW& a_Right)
+    {
+        return a_Left.BufferLocation == a_Right.BufferLocation && a_Left.SizeInBytes == a_Right.SizeInBytes && a_Left.Format == a_Right.Format;
+    }
+
+    bool operator==(const RECT& a_Left, const RECT& a_Right)
+    {
+        return a_Left.left == a_Right.left && a_Left.top == a_Right.top && a_Left.right == a_Right.right && a_Left.bottom == a_Right.bottom;
+    }
+}
+
+GraphicsCommandList::GraphicsCommandList(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type, ComPtr<ID3D12CommandAllocator> a_CommandAllocator,
+    LinearAllocatorPagePool& a_DynamicPagePool, DynamicDescriptorPagePool& a_DescriptorPagePool)
     : m_Type(a_Type)
     , m_FenceValue(std::numeric_limits<UINT64>::max())
     , m_Services(a_ServiceLocator)
+    , m_D3D12CommandAllocator(a_CommandAllocator)
+    , m_DynamicAllocator(a_ServiceLocator, a_DynamicPagePool)
+    , m_DynamicDescriptorHeap(a_ServiceLocator, a_DescriptorPagePool)
 {
-    // Create the command allocator and command list
+    // Create the command list, the allocator is owned by the command queue's allocator pool
     auto device = m_Services.m_Device->GetDeviceObject();
-    ThrowIfFailed(device->CreateCommandAllocator(a_Type, IID_PPV_ARGS(&m_D3D12CommandAllocator)));
     ThrowIfFailed(device->CreateCommandList(0, a_Type, m_D3D12CommandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_D3D12CommandList)));
 
 }
@@ -35,25 +60,8 @@ Texture GraphicsCommandList::CreateTextureFromFilePath(std::wstring& a_FilePath)
 
     auto bufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(metaData.format, static_cast<UINT16>(metaData.width), static_cast<UINT16>(metaData.height), static_cast<UINT16>(metaData.arraySize));
 
-    auto device = m_Services.m_Device->GetDeviceObject();
-
-    // Create the default and upload buffers
-    ComPtr<ID3D12Resource> defaultBuffer, uploadBuffer;
-    {
-        CD3DX12_HEAP_PROPERTIES heapProperties;
-
-        heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&defaultBuffer));
-
-        UINT64 intermediateSize = GetRequiredIntermediateSize(defaultBuffer.Get(), 0, 1);
-
-        heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        auto intermediateDesc = CD3DX12_RESOURCE_DESC::Buffer(intermediateSize);
-        device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &intermediateDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer));
-    }
-
-    // Add the upload buffer to the list of current intermediate buffers
-    m_IntermediateBuffers.push_back(uploadBuffer);
+    // Create the default buffer in the common state, the copy queue writes to it and it decays back to common afterwards
+    ComPtr<ID3D12Resource> defaultBuffer = m_Services.m_MemoryAllocator->CreateResource(bufferDesc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
 
     // Describe the subresources update that is necessary
     std::vector<D3D12_SUBRESOURCE_DATA> subresources;
@@ -68,48 +76,209 @@ Texture GraphicsCommandList::CreateTextureFromFilePath(std::wstring& a_FilePath)
         subresources.push_back(subres);
     }
     // NOTE: this is only taking a single of the subresource descs, might need to change it for mipmapping
-    UpdateSubresources(m_D3D12CommandList.Get(), defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subresources[0]);
+    subresources.resize(1);
+
+    // The upload manager copies the data out of the scratch image, so it can be released when this function returns
+    AddUploadDependency(m_Services.m_UploadManager->UploadTexture(defaultBuffer, subresources));
 
-    // Transition the reousce into a readable state
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
-    ResourceBarrier(barrier);
+    // Create the SRV in the shader visible heap, its slot is freed again once the last copy of the texture is gone and the GPU is done with it
+    DescriptorAllocator& srvAllocator = m_Services.m_Device->GetShaderVisibleDescriptorAllocator();
+    DescriptorAllocation srv = srvAllocator.Allocate();
+    m_Services.m_Device->GetDeviceObject()->CreateShaderResourceView(defaultBuffer.Get(), nullptr, srv.GetCPUHandle());
 
-    // Add the default buffer to the SRV descriptor heap and get the descriptor handle
-    CD3DX12_GPU_DESCRIPTOR_HANDLE descriptorHandle = m_Services.m_Device->AddSRV(defaultBuffer);
+    // Descriptors can only be copied out of CPU only heaps, so the texture gets a second SRV for the dynamic descriptor tables
+    std::shared_ptr<DescriptorAllocation> cpuSrv = m_Services.m_Device->GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV).AllocateShared();
+    m_Services.m_Device->GetDeviceObject()->CreateShaderResourceView(defaultBuffer.Get(), nullptr, cpuSrv->GetCPUHandle());
 
-    // Create the texture from the default buffer and the descriptorHandle
-    return Texture(defaultBuffer, descriptorHandle);
+    return Texture(defaultBuffer, srv, srvAllocator, cpuSrv);
 }
 
-void GraphicsCommandList::Reset()
+void GraphicsCommandList::Reset(ComPtr<ID3D12CommandAllocator> a_CommandAllocator)
 {
-    // Free the intermediate resources since they are no longer needed
-    for (const ComPtr<ID3D12Resource> intermediateBuffer : m_IntermediateBuffers)
-    {
-        ID3D12Resource* const ptr = intermediateBuffer.Get();
-        // Is this how you evict resources? IDK.
-        ThrowIfFailed(m_Services.m_Device->GetDeviceObject()->Evict(1, reinterpret_cast<ID3D12Pageable* const*>(&ptr)));
-    }
-
-    m_IntermediateBuffers.clear();
-    // Reset the command allocator and command list
-    ThrowIfFailed(m_D3D12CommandAllocator->Reset());
+    m_UploadDependency = UploadManager::UploadToken();
+    m_D3D12CommandAllocator = a_CommandAllocator;
     ThrowIfFailed(m_D3D12CommandList->Reset(m_D3D12CommandAllocator.Get(), nullptr));
+
+    // Resetting the list clears all of its state
+    InvalidateStateCache();
+    m_ResourceStateTracker.Reset();
+    m_DynamicDescriptorHeap.Reset();
 }
 
 void GraphicsCommandList::Close()
 {
+    m_ResourceStateTracker.EndAllTransitions();
+    FlushResourceBarriers();
     ThrowIfFailed(m_D3D12CommandList->Close());
 }
 
+ComPtr<ID3D12CommandAllocator> GraphicsCommandList::ReleaseCommandAllocator()
+{
+    ComPtr<ID3D12CommandAllocator> allocator = m_D3D12CommandAllocator;
+    m_D3D12CommandAllocator.Reset();
+    return allocator;
+}
+
+std::vector<ComPtr<ID3D12Resource>> GraphicsCommandList::ReleaseIntermediateBuffers()
+{
+    std::vector<ComPtr<ID3D12Resource>> intermediateBuffers;
+    intermediateBuffers.swap(m_IntermediateBuffers);
+
+    // Oversized dynamic allocations have their own buffers, which need to live just as long
+    for (auto& largeBuffer : m_DynamicAllocator.ReleaseLargeBuffers())
+    {
+        intermediateBuffers.push_back(largeBuffer);
+    }
+    return intermediateBuffers;
+}
+
+std::vector<LinearAllocatorPagePool::Page*> GraphicsCommandList::ReleaseDynamicPages()
+{
+    return m_DynamicAllocator.ReleasePages();
+}
+
+std::vector<DynamicDescriptorPagePool::Page*> GraphicsCommandList::ReleaseDescriptorPages()
+{
+    return m_DynamicDescriptorHeap.ReleasePages();
+}
+
+void GraphicsCommandList::TrackIntermediateBuffer(ComPtr<ID3D12Resource> a_Buffer)
+{
+    m_IntermediateBuffers.push_back(a_Buffer);
+}
+
+LinearAllocator::Allocation GraphicsCommandList::AllocateDynamic(uint64_t a_Size, uint64_t a_Alignment)
+{
+    return m_DynamicAllocator.Allocate(a_Size, a_Alignment);
+}
+
+void GraphicsCommandList::AddUploadDependency(UploadManager::UploadToken a_Token)
+{
+    // Uploads complete in order, so depending on the latest one covers all the earlier ones
+    if (a_Token.m_Id > m_UploadDependency.m_Id)
+    {
+        m_UploadDependency = a_Token;
+    }
+}
+
+UploadManager::UploadToken GraphicsCommandList::GetUploadDependency() const
+{
+    return m_UploadDependency;
+}
+
+void GraphicsCommandList::CopyBufferRegion(ID3D12Resource* a_Destination, UINT64 a_DestinationOffset, ID3D12Resource* a_Source, UINT64 a_SourceOffset, UINT64 a_NumBytes)
+{
+    FlushResourceBarriers();
+    m_D3D12CommandList->CopyBufferRegion(a_Destination, a_DestinationOffset, a_Source, a_SourceOffset, a_NumBytes);
+}
+
+void GraphicsCommandList::CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& a_Destination, const D3D12_TEXTURE_COPY_LOCATION& a_Source)
+{
+    FlushResourceBarriers();
+    m_D3D12CommandList->CopyTextureRegion(&a_Destination, 0, 0, 0, &a_Source, nullptr);
+}
+
+void GraphicsCommandList::TransitionResource(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter)
+{
+    m_ResourceStateTracker.TransitionResource(a_Resource, a_StateAfter);
+}
+
+void GraphicsCommandList::BeginTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter)
+{
+    m_ResourceStateTracker.BeginTransition(a_Resource, a_StateAfter);
+}
+
+void GraphicsCommandList::EndTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter)
+{
+    m_ResourceStateTracker.EndTransition(a_Resource, a_StateAfter);
+}
+
+void GraphicsCommandList::RecordWithSplitBarriers(const SplitBarrierPlanner& a_Planner, const std::vector<const RenderResource*>& a_Resources,
+    const std::vector<std::function<void(GraphicsCommandList&)>>& a_Steps)
+{
+    std::vector<SplitBarrierPlanner::Transition> transitions = a_Planner.Plan(a_Steps.size());
+
+    // Sort the halves by the step they need to be recorded in front of
+    std::vector<std::vector<const SplitBarrierPlanner::Transition*>> beginsPerStep(a_Steps.size() + 1);
+    std::vector<std::vector<const SplitBarrierPlanner::Transition*>> endsPerStep(a_Steps.size() + 1);
+    for (const SplitBarrierPlanner::Transition& transition : transitions)
+    {
+        if (transition.IsSplit())
+        {
+            beginsPerStep[transition.m_BeginStep].push_back(&transition);
+        }
+        endsPerStep[transition.m_EndStep].push_back(&transition);
+    }
+
+    for (size_t step = 0; step <= a_Steps.size(); step++)
+    {
+        // Transitions ending here were begun in an earlier step, or are regular transitions if there was no work to hide them behind
+        for (const SplitBarrierPlanner::Transition* transition : endsPerStep[step])
+        {
+            EndTransition(*a_Resources[transition->m_Resource], transition->m_StateAfter);
+        }
+        for (const SplitBarrierPlanner::Transition* transition : beginsPerStep[step])
+        {
+            BeginTransition(*a_Resources[transition->m_Resource], transition->m_StateAfter);
+        }
+
+        if (step < a_Steps.size())
+        {
+            a_Steps[step](*this);
+        }
+    }
+}
+
+void GraphicsCommandList::UAVBarrier(const RenderResource& a_Resource)
+{
+    m_ResourceStateTracker.UAVBarrier(a_Resource);
+}
+
+void GraphicsCommandList::AliasingBarrier(const RenderResource* a_ResourceBefore, const RenderResource& a_ResourceAfter)
+{
+    ID3D12Resource* resourceBefore = a_ResourceBefore != nullptr ? a_ResourceBefore->GetD3D12Resource().Get() : nullptr;
+    m_ResourceStateTracker.ResourceBarrier(CD3DX12_RESOURCE_BARRIER::Aliasing(resourceBefore, a_ResourceAfter.GetD3D12Resource().Get()));
+}
+
 void GraphicsCommandList::ResourceBarrier(D3D12_RESOURCE_BARRIER& a_Barrier)
 {
-    m_D3D12CommandList->ResourceBarrier(1, &a_Barrier);
+    m_ResourceStateTracker.ResourceBarrier(a_Barrier);
 }
 
 void GraphicsCommandList::ResourceBarriers(std::vector<D3D12_RESOURCE_BARRIER>& a_Barriers)
 {
-    m_D3D12CommandList->ResourceBarrier(static_cast<UINT>(a_Barriers.size()), &a_Barriers[0]);
+    for (const D3D12_RESOURCE_BARRIER& barrier : a_Barriers)
+    {
+        m_ResourceStateTracker.ResourceBarrier(barrier);
+    }
+}
+
+void GraphicsCommandList::FlushResourceBarriers()
+{
+    m_ResourceStateTracker.FlushResourceBarriers(m_D3D12CommandList.Get());
+}
+
+ResourceStateTracker& GraphicsCommandList::GetResourceStateTracker()
+{
+    return m_ResourceStateTracker;
+}
+
+void GraphicsCommandList::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE a_RTVHandle, const float a_ClearColor[4])
+{
+    FlushResourceBarriers();
+    m_D3D12CommandList->ClearRenderTargetView(a_RTVHandle, a_ClearColor, 0, nullptr);
+}
+
+void GraphicsCommandList::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE a_DSVHandle, D3D12_CLEAR_FLAGS a_ClearFlags, float a_Depth, UINT8 a_Stencil)
+{
+    FlushResourceBarriers();
+    m_D3D12CommandList->ClearDepthStencilView(a_DSVHandle, a_ClearFlags, a_Depth, a_Stencil, 0, nullptr);
+}
+
+void GraphicsCommandList::DiscardResource(const RenderResource& a_Resource)
+{
+    FlushResourceBarriers();
+    m_D3D12CommandList->DiscardResource(a_Resource.GetD3D12Resource().Get(), nullptr);
 }
 
 void GraphicsCommandList::SetRenderTargets(std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> a_RTVHandles, bool a_SingleRTVHandle,
@@ -120,13 +289,19 @@ void GraphicsCommandList::SetRenderTargets(std::vector<D3D12_CPU_DESCRIPTOR_HAND
 
 void GraphicsCommandList::SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY a_PrimitiveTopology)
 {
-    m_D3D12CommandList->IASetPrimitiveTopology(a_PrimitiveTopology);
+    if (ShouldIssueStateCall(m_ShadowState.m_PrimitiveTopology == a_PrimitiveTopology))
+    {
+        m_D3D12CommandList->IASetPrimitiveTopology(a_PrimitiveTopology);
+        m_ShadowState.m_PrimitiveTopology = a_PrimitiveTopology;
+    }
 }
 
 void GraphicsCommandList::SetVertexBuffer(VertexBuffer& a_Buffer,UINT a_Slot)
 {
+    TransitionResource(a_Buffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+
     auto bufferView = a_Buffer.GetVertexBufferView();
-    m_D3D12CommandList->IASetVertexBuffers(a_Slot, 1, &bufferView);
+    SetVertexBufferViews(&bufferView, 1, a_Slot);
 }
 
 void GraphicsCommandList::SetVertexBuffers(std::vector<VertexBuffer> a_Buffers, UINT a_StartSlot)
@@ -135,56 +310,195 @@ void GraphicsCommandList::SetVertexBuffers(std::vector<VertexBuffer> a_Buffers,
     std::vector<D3D12_VERTEX_BUFFER_VIEW> bufferViews;
     for (VertexBuffer& buffer : a_Buffers)
     {
+        TransitionResource(buffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
         bufferViews.push_back(buffer.GetVertexBufferView());
     }
-    m_D3D12CommandList->IASetVertexBuffers(a_StartSlot, static_cast<UINT>(bufferViews.size()), &bufferViews[0]);
+    SetVertexBufferViews(bufferViews.data(), static_cast<UINT>(bufferViews.size()), a_StartSlot);
+}
+
+void GraphicsCommandList::SetVertexBufferViews(const D3D12_VERTEX_BUFFER_VIEW* a_Views, UINT a_NumViews, UINT a_StartSlot)
+{
+    // The shadow state has one entry per input slot, so slots past the last one would be written out of bounds
+    if (a_StartSlot > D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT || a_NumViews > D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT - a_StartSlot)
+    {
+        throw std::runtime_error("Vertex buffer slots " + std::to_string(a_StartSlot) + " to " + std::to_string(static_cast<uint64_t>(a_StartSlot) + a_NumViews) +
+            " are out of range, there are only " + std::to_string(D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT) + " slots");
+    }
+    if (a_NumViews == 0)
+    {
+        return;
+    }
+
+    bool isRedundant = true;
+    for (UINT i = 0; i < a_NumViews && isRedundant; i++)
+    {
+        UINT slot = a_StartSlot + i;
+        isRedundant = m_ShadowState.m_VertexBufferSet[slot] && m_ShadowState.m_VertexBuffers[slot] == a_Views[i];
+    }
+
+    if (ShouldIssueStateCall(isRedundant))
+    {
+        m_D3D12CommandList->IASetVertexBuffers(a_StartSlot, a_NumViews, a_Views);
+        for (UINT i = 0; i < a_NumViews; i++)
+        {
+            m_ShadowState.m_VertexBuffers[a_StartSlot + i] = a_Views[i];
+            m_ShadowState.m_VertexBufferSet[a_StartSlot + i] = true;
+        }
+    }
 }
 
 void GraphicsCommandList::SetIndexBuffer(IndexBuffer& a_IndexBuffer)
 {
+    TransitionResource(a_IndexBuffer, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+
     auto bufferView = a_IndexBuffer.GetIndexBufferView();
-    m_D3D12CommandList->IASetIndexBuffer(&bufferView);
+    if (ShouldIssueStateCall(m_ShadowState.m_IndexBufferSet && m_ShadowState.m_IndexBuffer == bufferView))
+    {
+        m_D3D12CommandList->IASetIndexBuffer(&bufferView);
+        m_ShadowState.m_IndexBuffer = bufferView;
+        m_ShadowState.m_IndexBufferSet = true;
+    }
 }
 
 void GraphicsCommandList::SetDescriptorHeap(ID3D12DescriptorHeap* a_DescriptorHeap)
 {
-    m_D3D12CommandList->SetDescriptorHeaps(1, &a_DescriptorHeap);
+    SetDescriptorHeaps({ a_DescriptorHeap });
 }
 
 void GraphicsCommandList::SetDescriptorHeaps(std::vector<ID3D12DescriptorHeap*> a_DescriptorHeaps)
 {
-    m_D3D12CommandList->SetDescriptorHeaps(static_cast<UINT>(a_DescriptorHeaps.size()), &a_DescriptorHeaps[0]);
+    if (a_DescriptorHeaps.empty())
+    {
+        return;
+    }
+
+    const UINT numHeaps = static_cast<UINT>(a_DescriptorHeaps.size());
+
+    bool isRedundant = m_ShadowState.m_DescriptorHeapsSet && m_ShadowState.m_NumDescriptorHeaps == numHeaps;
+    for (UINT i = 0; i < numHeaps && isRedundant; i++)
+    {
+        isRedundant = m_ShadowState.m_DescriptorHeaps[i] == a_DescriptorHeaps[i];
+    }
+
+    if (ShouldIssueStateCall(isRedundant))
+    {
+        m_D3D12CommandList->SetDescriptorHeaps(numHeaps, &a_DescriptorHeaps[0]);
+
+        // Heaps which don't fit in the shadow state can't be compared later, so the next call is always forwarded
+        m_ShadowState.m_DescriptorHeapsSet = numHeaps <= _countof(m_ShadowState.m_DescriptorHeaps);
+        m_ShadowState.m_NumDescriptorHeaps = numHeaps;
+        for (UINT i = 0; i < numHeaps && m_ShadowState.m_DescriptorHeapsSet; i++)
+        {
+            m_ShadowState.m_DescriptorHeaps[i] = a_DescriptorHeaps[i];
+        }
+    }
 }
 
 void GraphicsCommandList::SetPipelineState(PipelineState& a_NewState)
 {
-    m_D3D12CommandList->SetPipelineState(a_NewState.GetPSO().Get());
-    m_D3D12CommandList->SetGraphicsRootSignature(a_NewState.GetRootSignature().Get());
+    ID3D12PipelineState* pipelineState = a_NewState.GetPSO().Get();
+    if (ShouldIssueStateCall(m_ShadowState.m_PipelineState == pipelineState))
+    {
+        m_D3D12CommandList->SetPipelineState(pipelineState);
+        m_ShadowState.m_PipelineState = pipelineState;
+    }
+
+    // Setting the root signature clears all the root arguments, so skipping it when it is the same also keeps the bindings intact
+    ID3D12RootSignature* rootSignature = a_NewState.GetRootSignature().Get();
+    if (ShouldIssueStateCall(m_ShadowState.m_RootSignature == rootSignature))
+    {
+        m_D3D12CommandList->SetGraphicsRootSignature(rootSignature);
+        m_ShadowState.m_RootSignature = rootSignature;
+        m_DynamicDescriptorHeap.SetRootSignatureLayout(a_NewState.GetDescriptorTableSizes());
+    }
 }
 
 void GraphicsCommandList::SetViewport(D3D12_VIEWPORT& a_Viewport)
 {
-    m_D3D12CommandList->RSSetViewports(1, &a_Viewport);
+    if (ShouldIssueStateCall(m_ShadowState.m_ViewportSet && m_ShadowState.m_Viewport == a_Viewport))
+    {
+        m_D3D12CommandList->RSSetViewports(1, &a_Viewport);
+        m_ShadowState.m_Viewport = a_Viewport;
+        m_ShadowState.m_ViewportSet = true;
+    }
 }
 
 void GraphicsCommandList::SetScissorRect(RECT a_Rect)
 {
-    m_D3D12CommandList->RSSetScissorRects(1, &a_Rect);
+    if (ShouldIssueStateCall(m_ShadowState.m_ScissorRectSet && m_ShadowState.m_ScissorRect == a_Rect))
+    {
+        m_D3D12CommandList->RSSetScissorRects(1, &a_Rect);
+        m_ShadowState.m_ScissorRect = a_Rect;
+        m_ShadowState.m_ScissorRectSet = true;
+    }
+}
+
+bool GraphicsCommandList::ShouldIssueStateCall(bool a_IsRedundant)
+{
+    if (a_IsRedundant)
+    {
+        ++m_StateStatistics.m_NumFilteredCalls;
+        return false;
+    }
+
+    ++m_StateStatistics.m_NumIssuedCalls;
+    return true;
 }
 
 void GraphicsCommandList::SetTexture(UINT a_RootSignatureIndex, Texture& a_Texture)
 {
+    // The root signature doesn't tell which stages read the texture, so make it readable by all of them
+    TransitionResource(a_Texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    // The SRV lives in the shader visible heap
+    SetDescriptorHeap(m_Services.m_Device->GetSRVHeap().Get());
     m_D3D12CommandList->SetGraphicsRootDescriptorTable(a_RootSignatureIndex, a_Texture.GetGPUDescriptorHandle());
+    InvalidateBindlessTextureTable(a_RootSignatureIndex);
+}
+
+void GraphicsCommandList::SetBindlessTextureTable(UINT a_RootSignatureIndex)
+{
+    ComPtr<ID3D12DescriptorHeap> heap = m_Services.m_Device->GetSRVHeap();
+    SetDescriptorHeap(heap.Get());
+
+    bool isRedundant = m_ShadowState.m_BindlessTableRootSignature != nullptr && m_ShadowState.m_BindlessTableRootSignature == m_ShadowState.m_RootSignature &&
+        m_ShadowState.m_BindlessTableRootIndex == a_RootSignatureIndex;
+    if (ShouldIssueStateCall(isRedundant))
+    {
+        m_D3D12CommandList->SetGraphicsRootDescriptorTable(a_RootSignatureIndex, heap->GetGPUDescriptorHandleForHeapStart());
+        m_ShadowState.m_BindlessTableRootSignature = m_ShadowState.m_RootSignature;
+        m_ShadowState.m_BindlessTableRootIndex = a_RootSignatureIndex;
+    }
+}
+
+UINT GraphicsCommandList::UseBindlessTexture(Texture& a_Texture)
+{
+    // Same as SetTexture, the table doesn't tell which stages read the texture
+    TransitionResource(a_Texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    return a_Texture.GetBindlessIndex();
+}
+
+void GraphicsCommandList::StageDescriptors(UINT a_RootSignatureIndex, UINT a_Offset, UINT a_NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE a_SourceDescriptors)
+{
+    m_DynamicDescriptorHeap.StageDescriptors(a_RootSignatureIndex, a_Offset, a_NumDescriptors, a_SourceDescriptors);
+}
+
+void GraphicsCommandList::StageTexture(UINT a_RootSignatureIndex, UINT a_Offset, Texture& a_Texture)
+{
+    TransitionResource(a_Texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    m_DynamicDescriptorHeap.StageDescriptors(a_RootSignatureIndex, a_Offset, 1, a_Texture.GetCPUDescriptorHandle());
 }
 
 void GraphicsCommandList::Draw(UINT a_VertexCount, UINT a_InstanceCount, UINT a_StartVertexLoc, UINT a_StartInstanceLoc)
 {
+    PrepareDraw();
     m_D3D12CommandList->DrawInstanced(a_VertexCount, a_InstanceCount, a_StartVertexLoc, a_StartInstanceLoc);
 }
 
 void GraphicsCommandList::DrawIndexed(UINT a_IndexCount, UINT a_InstanceCount, UINT a_StarIndexLoc, UINT a_BaseVertexLoc,
     UINT a_StartInstanceLoc)
 {
+    PrepareDraw();
     m_D3D12CommandList->DrawIndexedInstanced(a_IndexCount, a_InstanceCount, a_StarIndexLoc, a_BaseVertexLoc, a_StartInstanceLoc);
 }
 
@@ -195,7 +509,6 @@ void GraphicsCommandList::SetFenceValue(UINT64 a_NewFenceValue)
 
 void GraphicsCommandList::SetName(std::wstring a_Name)
 {
-    m_D3D12CommandAllocator->SetName((a_Name + L" Allocator").c_str());
     m_D3D12CommandList->SetName(a_Name.c_str());
 }
 
@@ -208,3 +521,37 @@ Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> GraphicsCommandList::GetComman
 {
     return m_D3D12CommandList;
 }
+
+void GraphicsCommandList::PrepareDraw()
+{
+    FlushResourceBarriers();
+
+    // The tables are copied into the shader visible heap, which needs to be bound for them
+    if (m_DynamicDescriptorHeap.HasStaleTables())
+    {
+        SetDescriptorHeap(m_Services.m_Device->GetSRVHeap().Get());
+        if (m_ShadowState.m_BindlessTableRootSignature != nullptr && m_DynamicDescriptorHeap.IsTableStale(m_ShadowState.m_BindlessTableRootIndex))
+        {
+            InvalidateBindlessTextureTable(m_ShadowState.m_BindlessTableRootIndex);
+        }
+        m_DynamicDescriptorHeap.CommitStagedDescriptors(m_D3D12CommandList.Get());
+    }
+}
+
+void GraphicsCommandList::InvalidateBindlessTextureTable(UINT a_RootSignatureIndex)
+{
+    if (m_ShadowState.m_BindlessTableRootIndex == a_RootSignatureIndex)
+    {
+        m_ShadowState.m_BindlessTableRootSignature = nullptr;
+    }
+}
+
+void GraphicsCommandList::InvalidateStateCache()
+{
+    m_ShadowState = ShadowState();
+}
+
+const GraphicsCommandList::StateStatistics& GraphicsCommandList::GetStateStatistics() const
+{
+    return m_StateStatistics;
+}
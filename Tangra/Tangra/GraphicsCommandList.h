@@ -7,7 +7,15 @@
 #include "IndexBuffer.h"
 #include "ServiceLocator.h"
 #include "Device.h"
-
+#include "Helpers.h"
+#include "GpuMemoryAllocator.h"
+#include "UploadManager.h"
+#include "LinearAllocator.h"
+#include "DynamicDescriptorHeap.h"
+#include "ResourceStateTracker.h"
+#include "SplitBarrierPlanner.h"
+
+#include <functional>
 #include <vector>
 #include <string>
 
@@ -21,30 +29,90 @@ struct ServiceLocator;
 class GraphicsCommandList
 {
 public:
-    // Create D3D12 command list and command allocator
-    GraphicsCommandList(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type);
+
+    // Number of state setting calls made on the list, and how many of those were skipped because they would not have changed anything
+    struct StateStatistics
+    {
+        uint64_t m_NumIssuedCalls = 0;
+        uint64_t m_NumFilteredCalls = 0;
+    };
+
+    // Create D3D12 command list which starts recording into the provided command allocator.
+    // Dynamic data and dynamic descriptor tables are allocated from pages of the provided pools.
+    GraphicsCommandList(ServiceLocator& a_ServiceLocator, D3D12_COMMAND_LIST_TYPE a_Type, Microsoft::WRL::ComPtr<ID3D12CommandAllocator> a_CommandAllocator,
+        LinearAllocatorPagePool& a_DynamicPagePool, DynamicDescriptorPagePool& a_DescriptorPagePool);
     ~GraphicsCommandList(){};
 
-    // Reset the command allocator and command list and free any intermediate resources
-    void Reset();
-    // Close the command list
+    // Reset the command list to record into the provided command allocator. The allocator needs to have been reset already.
+    void Reset(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> a_CommandAllocator);
+    // Record the queued barriers and close the command list
     void Close();
 
-    // Create vertex buffer from list of vertices
+    // Hands over the command allocator after submission so it can be recycled once the GPU is done with it
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> ReleaseCommandAllocator();
+    // Hands over the intermediate buffers after submission so they can be kept alive until the GPU is done with them
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> ReleaseIntermediateBuffers();
+    // Hands over the pages of the dynamic allocator after submission so they can be recycled once the GPU is done with them
+    std::vector<LinearAllocatorPagePool::Page*> ReleaseDynamicPages();
+    // Hands over the pages the dynamic descriptor tables were copied into after submission
+    std::vector<DynamicDescriptorPagePool::Page*> ReleaseDescriptorPages();
+    // Keep a resource alive until the GPU has finished executing the list
+    void TrackIntermediateBuffer(Microsoft::WRL::ComPtr<ID3D12Resource> a_Buffer);
+
+    // Mark the list as using the data of an upload, the queue makes the GPU wait for it before executing the list
+    void AddUploadDependency(UploadManager::UploadToken a_Token);
+    // Returns the latest upload the list depends on
+    UploadManager::UploadToken GetUploadDependency() const;
+
+    // Allocate memory which is only valid until the GPU has finished executing the list
+    LinearAllocator::Allocation AllocateDynamic(uint64_t a_Size, uint64_t a_Alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Create vertex buffer from list of vertices. The data is uploaded through the copy queue.
     template<typename T>
     VertexBuffer CreateVertexBuffer(std::vector<T> a_Vertices, D3D12_RESOURCE_FLAGS a_Flags = D3D12_RESOURCE_FLAG_NONE);
 
-    // Create index buffer from list of indices
+    // Create index buffer from list of indices. The data is uploaded through the copy queue.
     template<typename T>
     IndexBuffer CreateIndexBuffer(std::vector<T> a_Indices, D3D12_RESOURCE_FLAGS a_Flags = D3D12_RESOURCE_FLAG_NONE);
 
-    // Create texture from file at specified path
+    // Create texture from file at specified path. The data is uploaded through the copy queue.
     Texture CreateTextureFromFilePath(std::wstring& a_FilePath);
 
-    // Insert a resource barrier in the command list
+    // Copy a region of one buffer into another
+    void CopyBufferRegion(ID3D12Resource* a_Destination, UINT64 a_DestinationOffset, ID3D12Resource* a_Source, UINT64 a_SourceOffset, UINT64 a_NumBytes);
+    // Copy a texture region from the source location to the destination location
+    void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& a_Destination, const D3D12_TEXTURE_COPY_LOCATION& a_Source);
+
+    // Transition the resource to the specified state. The state it is coming from is tracked, so only the new state is needed.
+    // The barrier is queued and recorded together with the other queued barriers before the next draw, copy or clear.
+    void TransitionResource(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter);
+    // Start transitioning the resource to the specified state, so the GPU can do the transition while it executes the commands recorded until EndTransition.
+    // The resource can't be used in between. Transitions which are not ended explicitly are ended when the list is closed.
+    void BeginTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter);
+    // Finish a transition started with BeginTransition, or do a regular transition if none was started
+    void EndTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter);
+    // Record the steps in order, with the transitions the planner placed between them. The planner refers to resources by their index in a_Resources.
+    void RecordWithSplitBarriers(const SplitBarrierPlanner& a_Planner, const std::vector<const RenderResource*>& a_Resources,
+        const std::vector<std::function<void(GraphicsCommandList&)>>& a_Steps);
+    // Queue a UAV barrier for the resource
+    void UAVBarrier(const RenderResource& a_Resource);
+    // Queue an aliasing barrier between two placed resources sharing memory. The resource before can be null if any resource could have used the memory.
+    void AliasingBarrier(const RenderResource* a_ResourceBefore, const RenderResource& a_ResourceAfter);
+    // Queue a resource barrier. Only use this for resources which are not tracked, use TransitionResource for RenderResources.
     void ResourceBarrier(D3D12_RESOURCE_BARRIER& a_Barrier);
-    // Insert a number of resource barriers in the command list
+    // Queue a number of resource barriers. Only use this for resources which are not tracked, use TransitionResource for RenderResources.
     void ResourceBarriers(std::vector<D3D12_RESOURCE_BARRIER>& a_Barriers);
+    // Record all the queued barriers with a single ResourceBarrier call. Happens automatically before draws, copies and clears.
+    void FlushResourceBarriers();
+    // Returns the state tracker of the list, used by the command queue to fix up the resource states on submission
+    ResourceStateTracker& GetResourceStateTracker();
+
+    // Clear a render target. The resource needs to be in the render target state.
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE a_RTVHandle, const float a_ClearColor[4]);
+    // Clear a depth stencil buffer. The resource needs to be in the depth write state.
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE a_DSVHandle, D3D12_CLEAR_FLAGS a_ClearFlags, float a_Depth = 1.0f, UINT8 a_Stencil = 0);
+    // Mark the contents of the resource as undefined. Render targets and depth buffers which just took over aliased memory need this, a clear or a copy first.
+    void DiscardResource(const RenderResource& a_Resource);
 
     // Set the current pipeline state object
     void SetPipelineState(PipelineState& a_NewState);
@@ -58,7 +126,7 @@ public:
     // Set the scissor rectangle
     void SetScissorRect(RECT a_Rect);
 
-    // Set vertex buffer at specified slot
+    // Set vertex buffer at specified slot. Buffers are transitioned to the vertex buffer state automatically, just like index buffers and textures.
     void SetVertexBuffer(VertexBuffer& a_Buffer, UINT a_Slot = 0);
     // Set vertex buffers starting from specified slot
     void SetVertexBuffers(std::vector<VertexBuffer> a_Buffers, UINT a_StartSlot = 0);
@@ -66,17 +134,35 @@ public:
     void SetIndexBuffer(IndexBuffer& a_IndexBuffer);
     // Set the descriptor heap to use
     void SetDescriptorHeap(ID3D12DescriptorHeap* a_DescriptorHeap);
-    // Set a number of descriptor heaps?
+    // Set a number of descriptor heaps, an empty list leaves the current heaps bound
     void SetDescriptorHeaps(std::vector<ID3D12DescriptorHeap*> a_DescriptorHeaps);
 
     // Set a struct as a ConstantBuffer root parameter. Make sure the 16-byte padding and variable order are correct.
     template<typename T>
     void SetRoot32BitConstant(UINT a_RootIndex, T& a_Data, UINT a_OffsetInData = 0);
 
+    // Copy the data into dynamic memory and bind it as a root ShaderResourceView
+    template<typename T>
+    void SetStructuredBuffer(UINT a_RootIndex, const std::vector<T>& a_Buffer);
+    // Copy a struct into dynamic memory and bind it as a root ConstantBufferView. Make sure the 16-byte padding and variable order are correct.
     template<typename T>
-    void SetStructuredBuffer(UINT a_RootIndex, std::vector<T>& a_Buffer);
-    // Bind specified texture to the pipeline at the specified root parameter index.
+    void SetDynamicConstantBuffer(UINT a_RootIndex, const T& a_Data);
+    // Copy the vertices into dynamic memory and bind them at the specified slot, for vertex data which changes every frame
+    template<typename T>
+    void SetDynamicVertexBuffer(const std::vector<T>& a_Vertices, UINT a_Slot = 0);
+    // Bind specified texture to the pipeline at the specified root parameter index, as a table of its single SRV in the shader visible heap.
+    // Used instead of the bindless table on devices which don't support unbounded tables.
     void SetTexture(UINT a_RootSignatureIndex, Texture& a_Texture);
+    // Bind the shader visible heap and point the descriptor table at the root parameter index to its start, so shaders can index every texture in it.
+    // Only needs to be done once per root signature, switching textures is then just a different index.
+    void SetBindlessTextureTable(UINT a_RootSignatureIndex);
+    // Transition the texture so shaders can read it through the bindless table, and return its index in the table
+    UINT UseBindlessTexture(Texture& a_Texture);
+    // Stage CPU only descriptors into the table at the root parameter index, starting at the offset in the table.
+    // The tables which changed are copied into the shader visible heap and bound when the next draw is recorded.
+    void StageDescriptors(UINT a_RootSignatureIndex, UINT a_Offset, UINT a_NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE a_SourceDescriptors);
+    // Transition the texture and stage its SRV into the table at the root parameter index
+    void StageTexture(UINT a_RootSignatureIndex, UINT a_Offset, Texture& a_Texture);
 
     // Draw to the screen without an index buffer
     void Draw(UINT a_VertexCount, UINT a_InstanceCount = 1, UINT a_StartVertexLoc = 0, UINT a_StartInstanceLoc = 0);
@@ -89,10 +175,53 @@ public:
     void SetName(std::wstring a_Name);
 
     UINT64 GetFenceValue() const;
-    // Get ComPtr to the ID3D12GraphicsCommandList object
+    // Get ComPtr to the ID3D12GraphicsCommandList object.
+    // State set directly on the object is not seen by the redundant state filtering, call InvalidateStateCache afterwards.
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> GetCommandListPtr();
 
+    // Forget the shadow state, so the next state setting calls are all forwarded to D3D12
+    void InvalidateStateCache();
+    // Returns the issued and filtered state calls since the list was created
+    const StateStatistics& GetStateStatistics() const;
+
 private:
+
+    // Copy of the state last set on the D3D12 command list, used to skip calls which would set the same state again
+    struct ShadowState
+    {
+        ID3D12PipelineState* m_PipelineState = nullptr;
+        ID3D12RootSignature* m_RootSignature = nullptr;
+        D3D_PRIMITIVE_TOPOLOGY m_PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+        D3D12_VERTEX_BUFFER_VIEW m_VertexBuffers[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+        bool m_VertexBufferSet[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+        D3D12_INDEX_BUFFER_VIEW m_IndexBuffer = {};
+        bool m_IndexBufferSet = false;
+
+        // A list can have at most one shader visible CBV/SRV/UAV heap and one sampler heap bound
+        ID3D12DescriptorHeap* m_DescriptorHeaps[2] = {};
+        UINT m_NumDescriptorHeaps = 0;
+        bool m_DescriptorHeapsSet = false;
+
+        // Root signature and root parameter the bindless table was set for, setting another root signature clears it
+        ID3D12RootSignature* m_BindlessTableRootSignature = nullptr;
+        UINT m_BindlessTableRootIndex = 0;
+
+        D3D12_VIEWPORT m_Viewport = {};
+        bool m_ViewportSet = false;
+        RECT m_ScissorRect = {};
+        bool m_ScissorRectSet = false;
+    };
+
+    // Count the call and return true if it needs to be forwarded to D3D12
+    bool ShouldIssueStateCall(bool a_IsRedundant);
+    // Set vertex buffer views, skipping the call if the slots already hold the same views. Throws if the slots are out of range.
+    void SetVertexBufferViews(const D3D12_VERTEX_BUFFER_VIEW* a_Views, UINT a_NumViews, UINT a_StartSlot);
+    // Record the queued barriers and commit the staged descriptor tables, right before a draw
+    void PrepareDraw();
+    // Forget the bindless table if something else was bound at its root parameter index, so the next SetBindlessTextureTable isn't filtered
+    void InvalidateBindlessTextureTable(UINT a_RootSignatureIndex);
+
     ServiceLocator& m_Services;
 
     // List of all intermediate buffers to track until the command list has finished execution
@@ -102,8 +231,21 @@ private:
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_D3D12CommandList;
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_D3D12CommandAllocator;
 
+    // Allocator for data which only lives as long as the submission, like constants and per-frame vertex data
+    LinearAllocator m_DynamicAllocator;
+    // Tables built from staged descriptors, copied into the shader visible heap at draw time
+    DynamicDescriptorHeap m_DynamicDescriptorHeap;
+
     UINT64 m_FenceValue;
 
+    // Latest upload used by the commands in the list
+    UploadManager::UploadToken m_UploadDependency;
+
+    ShadowState m_ShadowState;
+    StateStatistics m_StateStatistics;
+
+    ResourceStateTracker m_ResourceStateTracker;
+
     const D3D12_COMMAND_LIST_TYPE m_Type;
 };
 
@@ -112,35 +254,16 @@ template <typename T>
 VertexBuffer GraphicsCommandList::CreateVertexBuffer(std::vector<T> a_Vertices,
     D3D12_RESOURCE_FLAGS a_Flags)
 {
-    auto device = m_Services.m_Device.get();
     // describe the vertex buffer to be created
     CD3DX12_RESOURCE_DESC vertexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(a_Vertices.size() * sizeof(T), a_Flags);
 
 
-    // create a resource for both the default and upload buffer that is to be used
-    Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer, uploadBuffer;
-    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    device->GetDeviceObject()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE,
-        &vertexBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&defaultBuffer));
-    heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    device->GetDeviceObject()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE,
-        &vertexBufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer));
-
-    m_IntermediateBuffers.push_back(uploadBuffer);
-
-    // describe the subresource and update it
-    D3D12_SUBRESOURCE_DATA subresourceData;
-    subresourceData.pData = &a_Vertices[0];
-    subresourceData.RowPitch = a_Vertices.size() * sizeof(T);
-    // the subresource is used for a buffer, so the row pitch and the slice pitch are the same
-    subresourceData.SlicePitch = subresourceData.RowPitch;
-
-    UpdateSubresources(m_D3D12CommandList.Get(), defaultBuffer.Get(), uploadBuffer.Get(),
-        0, 0, 1, &subresourceData);
+    // create the default buffer in the common state, so the copy queue can write to it and the direct queue can promote it to a read state
+    Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer = m_Services.m_MemoryAllocator->CreateResource(vertexBufferDesc, D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_STATE_COMMON);
 
-    // transition the vertex buffer resource into a read state
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
-    ResourceBarrier(barrier);
+    // the upload manager copies the data, the list only needs to make sure the copy has finished before it executes
+    AddUploadDependency(m_Services.m_UploadManager->UploadBuffer(defaultBuffer, 0, &a_Vertices[0], a_Vertices.size() * sizeof(T)));
 
     // create the vertex buffer view
     D3D12_VERTEX_BUFFER_VIEW vbView = {};
@@ -174,33 +297,15 @@ IndexBuffer GraphicsCommandList::CreateIndexBuffer(std::vector<T> a_Indices, D3D
         break;
     }
 
-    auto device = m_Services.m_Device->GetDeviceObject();
-
     CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(T) * a_Indices.size(), a_Flags);
 
 
-    // Create upload and default resources
-    Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer, uploadBuffer;
-    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&defaultBuffer));
-    heapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-    device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer));
-
-    m_IntermediateBuffers.push_back(uploadBuffer);
-
-    // Describe the sub-resource and update it
-    D3D12_SUBRESOURCE_DATA subresourceData;
-    subresourceData.RowPitch = sizeof(T) * a_Indices.size();
-    // Subresource is a buffer, so SlidePitch and RowPitch are equal
-    subresourceData.SlicePitch = subresourceData.RowPitch;
-    subresourceData.pData = &a_Indices[0];
-
-    UpdateSubresources(m_D3D12CommandList.Get(), defaultBuffer.Get(), uploadBuffer.Get(),
-        0, 0, 1, &subresourceData);
+    // Create the default resource in the common state, so the copy queue can write to it and the direct queue can promote it to a read state
+    Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer = m_Services.m_MemoryAllocator->CreateResource(bufferDesc, D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_STATE_COMMON);
 
-    // Transition the buffer's resource to generic read state for future use
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
-    ResourceBarrier(barrier);
+    // Let the upload manager copy the indices and wait for it before the list executes
+    AddUploadDependency(m_Services.m_UploadManager->UploadBuffer(defaultBuffer, 0, &a_Indices[0], sizeof(T) * a_Indices.size()));
 
     // Fill out the Index Buffer View struct and create an IndexBuffer instance and return it
     unsigned int numIndices = static_cast<UINT>(a_Indices.size());
@@ -219,29 +324,34 @@ void GraphicsCommandList::SetRoot32BitConstant(UINT a_RootIndex, T& a_Data, UINT
 }
 
 template <typename T>
-void GraphicsCommandList::SetStructuredBuffer(UINT a_RootIndex, std::vector<T>& a_Buffer)
+void GraphicsCommandList::SetStructuredBuffer(UINT a_RootIndex, const std::vector<T>& a_Buffer)
 {
-    D3D12_GPU_VIRTUAL_ADDRESS gpuAdress;
+    // Root descriptors only need 4-byte alignment, 16 keeps the copies aligned
+    LinearAllocator::Allocation allocation = m_DynamicAllocator.Allocate(sizeof(T) * a_Buffer.size(), 16);
+    memcpy(allocation.m_CPUAddress, a_Buffer.data(), sizeof(T) * a_Buffer.size());
 
-    auto device = m_Services.m_Device->GetDeviceObject();
-
-    CD3DX12_RESOURCE_DESC resDesc = CD3DX12_RESOURCE_DESC::Buffer(a_Buffer.size() * sizeof(T));
-    CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
-    
-    device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer));
-
-    gpuAdress = uploadBuffer->GetGPUVirtualAddress();
+    m_D3D12CommandList->SetGraphicsRootShaderResourceView(a_RootIndex, allocation.m_GPUAddress);
+}
 
-    void* bufferData = nullptr;
+template <typename T>
+void GraphicsCommandList::SetDynamicConstantBuffer(UINT a_RootIndex, const T& a_Data)
+{
+    LinearAllocator::Allocation allocation = m_DynamicAllocator.Allocate(sizeof(T), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    memcpy(allocation.m_CPUAddress, &a_Data, sizeof(T));
 
-    uploadBuffer->Map(0, nullptr, &bufferData);
+    m_D3D12CommandList->SetGraphicsRootConstantBufferView(a_RootIndex, allocation.m_GPUAddress);
+}
 
-    memcpy(bufferData, &a_Buffer[0], sizeof(T) * a_Buffer.size());
+template <typename T>
+void GraphicsCommandList::SetDynamicVertexBuffer(const std::vector<T>& a_Vertices, UINT a_Slot)
+{
+    LinearAllocator::Allocation allocation = m_DynamicAllocator.Allocate(sizeof(T) * a_Vertices.size(), 16);
+    memcpy(allocation.m_CPUAddress, a_Vertices.data(), sizeof(T) * a_Vertices.size());
 
-    m_IntermediateBuffers.push_back(uploadBuffer);
+    D3D12_VERTEX_BUFFER_VIEW vbView = {};
+    vbView.BufferLocation = allocation.m_GPUAddress;
+    vbView.SizeInBytes = static_cast<UINT>(sizeof(T) * a_Vertices.size());
+    vbView.StrideInBytes = sizeof(T);
 
-    m_D3D12CommandList->SetGraphicsRootShaderResourceView(a_RootIndex, gpuAdress);
+    SetVertexBufferViews(&vbView, 1, a_Slot);
 }
-
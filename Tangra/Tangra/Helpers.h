@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <winerror.h>
 
@@ -9,3 +11,16 @@ inline void ThrowIfFailed(HRESULT hr)
         throw std::exception();
     }
 }
+
+// 64-bit FNV-1a hash of the bytes. Pass the previous hash as the seed to hash several pieces of data as one.
+inline uint64_t HashBytes(const void* a_Data, size_t a_Size, uint64_t a_Seed = 14695981039346656037ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(a_Data);
+    uint64_t hash = a_Seed;
+    for (size_t i = 0; i < a_Size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
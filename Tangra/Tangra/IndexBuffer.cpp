@@ -19,6 +19,7 @@ IndexBuffer& IndexBuffer::operator=(const IndexBuffer& a_Other)
 {
     m_NumIndices = a_Other.m_NumIndices;
     m_DefaultBuffer = a_Other.m_DefaultBuffer;
+    m_TrackedState = a_Other.m_TrackedState;
     m_IndexBufferView = a_Other.m_IndexBufferView;
 
     return *this;
@@ -0,0 +1,90 @@
+#include "LinearAllocator.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include "d3dx12.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    uint64_t AlignUp(uint64_t a_Value, uint64_t a_Alignment)
+    {
+        return (a_Value + a_Alignment - 1) & ~(a_Alignment - 1);
+    }
+}
+
+LinearAllocator::LinearAllocator(ServiceLocator& a_ServiceLocator, LinearAllocatorPagePool& a_PagePool)
+    : m_Services(a_ServiceLocator)
+    , m_PagePool(a_PagePool)
+    , m_CurrentPage(nullptr)
+    , m_CurrentOffset(0)
+{
+}
+
+LinearAllocator::Allocation LinearAllocator::Allocate(uint64_t a_Size, uint64_t a_Alignment)
+{
+    const uint64_t pageSize = m_PagePool.GetPageSize();
+
+    Allocation allocation;
+
+    // Allocations that would not fit in an empty page get their own buffer, which is released together with the list's other intermediate buffers
+    if (a_Size > pageSize)
+    {
+        ComPtr<ID3D12Resource> buffer;
+        auto device = m_Services.m_Device->GetDeviceObject();
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(a_Size);
+        ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer)));
+
+        D3D12_RANGE readRange = { 0, 0 };
+        ThrowIfFailed(buffer->Map(0, &readRange, &allocation.m_CPUAddress));
+        allocation.m_Resource = buffer.Get();
+        allocation.m_GPUAddress = buffer->GetGPUVirtualAddress();
+
+        m_LargeBuffers.push_back(buffer);
+        return allocation;
+    }
+
+    uint64_t offset = AlignUp(m_CurrentOffset, a_Alignment);
+    if (m_CurrentPage == nullptr || offset + a_Size > pageSize)
+    {
+        if (m_CurrentPage != nullptr)
+        {
+            m_UsedPages.push_back(m_CurrentPage);
+        }
+        m_CurrentPage = m_PagePool.RequestPage();
+        offset = 0;
+    }
+
+    m_CurrentOffset = offset + a_Size;
+
+    allocation.m_Resource = m_CurrentPage->m_Resource.Get();
+    allocation.m_Offset = offset;
+    allocation.m_CPUAddress = m_CurrentPage->m_CPUAddress + offset;
+    allocation.m_GPUAddress = m_CurrentPage->m_GPUAddress + offset;
+    return allocation;
+}
+
+std::vector<LinearAllocatorPagePool::Page*> LinearAllocator::ReleasePages()
+{
+    if (m_CurrentPage != nullptr)
+    {
+        m_UsedPages.push_back(m_CurrentPage);
+        m_CurrentPage = nullptr;
+    }
+    m_CurrentOffset = 0;
+
+    std::vector<LinearAllocatorPagePool::Page*> pages;
+    pages.swap(m_UsedPages);
+    return pages;
+}
+
+std::vector<ComPtr<ID3D12Resource>> LinearAllocator::ReleaseLargeBuffers()
+{
+    std::vector<ComPtr<ID3D12Resource>> largeBuffers;
+    largeBuffers.swap(m_LargeBuffers);
+    return largeBuffers;
+}
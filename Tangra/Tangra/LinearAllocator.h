@@ -0,0 +1,47 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+#include "LinearAllocatorPagePool.h"
+
+struct ServiceLocator;
+
+// Bump allocator for data that is only used by a single submission, like constants and dynamic vertex data.
+// Every command list has its own, so recording threads never contend for it. Allocations are carved out of persistently mapped
+// pages which are handed back to the queue's page pool on submission and reused once the GPU has finished the frame.
+class LinearAllocator
+{
+public:
+
+    struct Allocation
+    {
+        ID3D12Resource* m_Resource = nullptr;
+        uint64_t m_Offset = 0;
+        void* m_CPUAddress = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS m_GPUAddress = 0;
+    };
+
+    LinearAllocator(ServiceLocator& a_ServiceLocator, LinearAllocatorPagePool& a_PagePool);
+
+    // Sub-allocate CPU writable memory the GPU can read from. The alignment needs to be a power of two.
+    // Allocations larger than a page get a dedicated buffer.
+    Allocation Allocate(uint64_t a_Size, uint64_t a_Alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Hands over the pages after submission so the pool can recycle them once the GPU is done with them
+    std::vector<LinearAllocatorPagePool::Page*> ReleasePages();
+    // Hands over the dedicated buffers of oversized allocations so they can be kept alive until the GPU is done with them
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> ReleaseLargeBuffers();
+private:
+    ServiceLocator& m_Services;
+    LinearAllocatorPagePool& m_PagePool;
+
+    // Page which is currently being allocated from, and the pages that have been filled up before it
+    LinearAllocatorPagePool::Page* m_CurrentPage;
+    uint64_t m_CurrentOffset;
+    std::vector<LinearAllocatorPagePool::Page*> m_UsedPages;
+
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_LargeBuffers;
+};
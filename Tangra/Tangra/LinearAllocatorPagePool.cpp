@@ -0,0 +1,95 @@
+#include "LinearAllocatorPagePool.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include "d3dx12.h"
+
+#include <string>
+
+using namespace Microsoft::WRL;
+
+LinearAllocatorPagePool::LinearAllocatorPagePool(ServiceLocator& a_ServiceLocator, uint64_t a_PageSize)
+    : m_Services(a_ServiceLocator)
+    , m_PageSize(a_PageSize)
+{
+}
+
+LinearAllocatorPagePool::~LinearAllocatorPagePool()
+{
+    for (auto& page : m_Pages)
+    {
+        page->m_Resource->Unmap(0, nullptr);
+    }
+}
+
+LinearAllocatorPagePool::Page* LinearAllocatorPagePool::RequestPage()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ++m_Statistics.m_NumRequests;
+
+    if (!m_AvailablePages.empty())
+    {
+        Page* page = m_AvailablePages.back();
+        m_AvailablePages.pop_back();
+        ++m_Statistics.m_NumReuseHits;
+        return page;
+    }
+
+    auto page = std::make_unique<Page>();
+
+    auto device = m_Services.m_Device->GetDeviceObject();
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(m_PageSize);
+    ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&page->m_Resource)));
+    page->m_Resource->SetName((std::wstring(L"Linear Allocator Page ") + std::to_wstring(m_Pages.size() + 1)).c_str());
+
+    // The page stays mapped until the pool is destroyed, the CPU never reads from it
+    D3D12_RANGE readRange = { 0, 0 };
+    void* cpuAddress = nullptr;
+    ThrowIfFailed(page->m_Resource->Map(0, &readRange, &cpuAddress));
+    page->m_CPUAddress = static_cast<uint8_t*>(cpuAddress);
+    page->m_GPUAddress = page->m_Resource->GetGPUVirtualAddress();
+
+    m_Pages.push_back(std::move(page));
+    m_Statistics.m_NumPages = m_Pages.size();
+
+    return m_Pages.back().get();
+}
+
+void LinearAllocatorPagePool::ReturnPages(const std::vector<Page*>& a_Pages, uint64_t a_FenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    for (Page* page : a_Pages)
+    {
+        m_InFlightPages.emplace(a_FenceValue, page);
+    }
+    m_Statistics.m_NumInFlight = m_InFlightPages.size();
+}
+
+void LinearAllocatorPagePool::RecycleCompletedPages(uint64_t a_CompletedFenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Pages are returned in submission order, so stop at the first one the GPU may still be reading from
+    while (!m_InFlightPages.empty() && m_InFlightPages.front().first <= a_CompletedFenceValue)
+    {
+        m_AvailablePages.push_back(m_InFlightPages.front().second);
+        m_InFlightPages.pop();
+    }
+    m_Statistics.m_NumInFlight = m_InFlightPages.size();
+}
+
+uint64_t LinearAllocatorPagePool::GetPageSize() const
+{
+    return m_PageSize;
+}
+
+LinearAllocatorPagePool::Statistics LinearAllocatorPagePool::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
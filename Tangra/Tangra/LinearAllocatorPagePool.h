@@ -0,0 +1,66 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+struct ServiceLocator;
+
+// Pool of large upload heap pages which stay mapped for their whole lifetime. Owned by a command queue and shared by the linear allocators of its command lists.
+// Pages are handed back with the fence value of the submission that used them and are only reused once that value is reached.
+class LinearAllocatorPagePool
+{
+public:
+
+    struct Page
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_Resource;
+        uint8_t* m_CPUAddress = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS m_GPUAddress = 0;
+    };
+
+    struct Statistics
+    {
+        // Number of pages created by the pool
+        size_t m_NumPages = 0;
+        // Number of pages currently waiting for the GPU to finish with them
+        size_t m_NumInFlight = 0;
+        // Total number of page requests
+        uint64_t m_NumRequests = 0;
+        // Number of requests which were served with a recycled page
+        uint64_t m_NumReuseHits = 0;
+    };
+
+    LinearAllocatorPagePool(ServiceLocator& a_ServiceLocator, uint64_t a_PageSize = 2 * 1024 * 1024);
+    ~LinearAllocatorPagePool();
+
+    // Returns a page that is free to write into, creating one if no recycled page is available. Thread-safe.
+    Page* RequestPage();
+    // Hand pages back to the pool. They will not be reused until the fence has reached the specified value. Thread-safe.
+    void ReturnPages(const std::vector<Page*>& a_Pages, uint64_t a_FenceValue);
+    // Make the pages of all the submissions the GPU has finished available again
+    void RecycleCompletedPages(uint64_t a_CompletedFenceValue);
+
+    uint64_t GetPageSize() const;
+    Statistics GetStatistics();
+private:
+    ServiceLocator& m_Services;
+
+    uint64_t m_PageSize;
+
+    std::mutex m_Mutex;
+
+    // All the pages created by the pool
+    std::vector<std::unique_ptr<Page>> m_Pages;
+    // Pages which can be written to right away
+    std::vector<Page*> m_AvailablePages;
+    // Pages which have been returned, ordered by the fence value they are waiting for
+    std::queue<std::pair<uint64_t, Page*>> m_InFlightPages;
+
+    Statistics m_Statistics;
+};
@@ -0,0 +1,121 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // Only used for error messages, so characters outside of ASCII don't need to survive
+    std::string ToNarrow(const std::wstring& a_String)
+    {
+        std::string narrow;
+        narrow.reserve(a_String.size());
+        for (wchar_t character : a_String)
+        {
+            narrow.push_back(static_cast<char>(character));
+        }
+        return narrow;
+    }
+}
+
+MappedFile::MappedFile()
+    : m_File(INVALID_HANDLE_VALUE)
+    , m_Mapping(NULL)
+    , m_Data(nullptr)
+    , m_Size(0)
+{
+}
+
+MappedFile::MappedFile(const std::wstring& a_Path)
+    : MappedFile()
+{
+    m_File = CreateFileW(a_Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Could not open " + ToNarrow(a_Path));
+    }
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_File, &size))
+    {
+        Close();
+        throw std::runtime_error("Could not get the size of " + ToNarrow(a_Path));
+    }
+    m_Size = static_cast<size_t>(size.QuadPart);
+
+    // Empty files can't be mapped, they are valid without data
+    if (m_Size == 0)
+    {
+        return;
+    }
+
+    m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping != NULL)
+    {
+        m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (m_Data == nullptr)
+    {
+        Close();
+        throw std::runtime_error("Could not map " + ToNarrow(a_Path));
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& a_Other)
+    : MappedFile()
+{
+    *this = std::move(a_Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& a_Other)
+{
+    if (this != &a_Other)
+    {
+        Close();
+        std::swap(m_File, a_Other.m_File);
+        std::swap(m_Mapping, a_Other.m_Mapping);
+        std::swap(m_Data, a_Other.m_Data);
+        std::swap(m_Size, a_Other.m_Size);
+    }
+    return *this;
+}
+
+const uint8_t* MappedFile::GetData() const
+{
+    return m_Data;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return m_Size;
+}
+
+bool MappedFile::IsValid() const
+{
+    return m_File != INVALID_HANDLE_VALUE;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data != nullptr)
+    {
+        UnmapViewOfFile(m_Data);
+        m_Data = nullptr;
+    }
+    if (m_Mapping != NULL)
+    {
+        CloseHandle(m_Mapping);
+        m_Mapping = NULL;
+    }
+    if (m_File != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_File);
+        m_File = INVALID_HANDLE_VALUE;
+    }
+    m_Size = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. The OS pages the contents in on first access, so mapping is cheap and nothing is copied.
+class MappedFile
+{
+public:
+    MappedFile();
+    // Throws if the file can't be opened or mapped
+    explicit MappedFile(const std::wstring& a_Path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& a_Other);
+    MappedFile& operator=(MappedFile&& a_Other);
+
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+    bool IsValid() const;
+private:
+    void Close();
+
+    HANDLE m_File;
+    HANDLE m_Mapping;
+    const uint8_t* m_Data;
+    size_t m_Size;
+};
@@ -0,0 +1,173 @@
+#include "OffsetAllocator.h"
+
+#include <iterator>
+
+const uint64_t OffsetAllocator::s_InvalidOffset;
+
+OffsetAllocator::OffsetAllocator(uint64_t a_Size)
+    : m_Size(a_Size)
+{
+    if (a_Size > 0)
+    {
+        AddFreeRange(0, a_Size);
+    }
+}
+
+uint64_t OffsetAllocator::Allocate(uint64_t a_Size)
+{
+    if (a_Size == 0)
+    {
+        return s_InvalidOffset;
+    }
+
+    auto bestFit = m_FreeRangesBySize.lower_bound(a_Size);
+    if (bestFit == m_FreeRangesBySize.end())
+    {
+        return s_InvalidOffset;
+    }
+
+    uint64_t offset = bestFit->second;
+    uint64_t freeSize = bestFit->first;
+    RemoveFreeRange(m_FreeRangesByOffset.find(offset));
+
+    // The rest of the range stays free
+    if (freeSize > a_Size)
+    {
+        AddFreeRange(offset + a_Size, freeSize - a_Size);
+    }
+
+    m_Allocations[offset] = a_Size;
+    m_AllocatedSize += a_Size;
+    return offset;
+}
+
+void OffsetAllocator::Free(uint64_t a_Offset)
+{
+    auto allocation = m_Allocations.find(a_Offset);
+    if (allocation == m_Allocations.end())
+    {
+        return;
+    }
+
+    uint64_t offset = a_Offset;
+    uint64_t size = allocation->second;
+    m_AllocatedSize -= size;
+    m_Allocations.erase(allocation);
+
+    // Merge with the free ranges right before and after it
+    auto next = m_FreeRangesByOffset.lower_bound(offset);
+    if (next != m_FreeRangesByOffset.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            RemoveFreeRange(previous);
+        }
+    }
+    if (next != m_FreeRangesByOffset.end() && offset + size == next->first)
+    {
+        size += next->second;
+        RemoveFreeRange(next);
+    }
+
+    AddFreeRange(offset, size);
+}
+
+void OffsetAllocator::Grow(uint64_t a_NewSize)
+{
+    if (a_NewSize <= m_Size)
+    {
+        return;
+    }
+
+    uint64_t offset = m_Size;
+    uint64_t size = a_NewSize - m_Size;
+    m_Size = a_NewSize;
+
+    // Extend the free range at the end if there is one
+    if (!m_FreeRangesByOffset.empty())
+    {
+        auto last = std::prev(m_FreeRangesByOffset.end());
+        if (last->first + last->second == offset)
+        {
+            offset = last->first;
+            size += last->second;
+            RemoveFreeRange(last);
+        }
+    }
+    AddFreeRange(offset, size);
+}
+
+std::vector<OffsetAllocator::Move> OffsetAllocator::Compact()
+{
+    // Allocations only move towards the start, so copying them in offset order never overwrites one which still has to be copied
+    std::vector<Move> moves;
+    std::map<uint64_t, uint64_t> allocations;
+    uint64_t offset = 0;
+    for (const auto& allocation : m_Allocations)
+    {
+        if (allocation.first != offset)
+        {
+            moves.push_back({ allocation.first, offset, allocation.second });
+        }
+        allocations[offset] = allocation.second;
+        offset += allocation.second;
+    }
+
+    m_Allocations.swap(allocations);
+    m_FreeRangesByOffset.clear();
+    m_FreeRangesBySize.clear();
+    if (offset < m_Size)
+    {
+        AddFreeRange(offset, m_Size - offset);
+    }
+
+    return moves;
+}
+
+uint64_t OffsetAllocator::GetSize() const
+{
+    return m_Size;
+}
+
+uint64_t OffsetAllocator::GetAllocatedSize() const
+{
+    return m_AllocatedSize;
+}
+
+uint64_t OffsetAllocator::GetLargestFreeRange() const
+{
+    return m_FreeRangesBySize.empty() ? 0 : std::prev(m_FreeRangesBySize.end())->first;
+}
+
+float OffsetAllocator::GetFragmentation() const
+{
+    uint64_t freeSize = m_Size - m_AllocatedSize;
+    if (freeSize == 0)
+    {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(GetLargestFreeRange()) / static_cast<float>(freeSize);
+}
+
+void OffsetAllocator::AddFreeRange(uint64_t a_Offset, uint64_t a_Size)
+{
+    m_FreeRangesByOffset[a_Offset] = a_Size;
+    m_FreeRangesBySize.insert({ a_Size, a_Offset });
+}
+
+void OffsetAllocator::RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator a_Range)
+{
+    auto bySize = m_FreeRangesBySize.equal_range(a_Range->second);
+    for (auto it = bySize.first; it != bySize.second; ++it)
+    {
+        if (it->second == a_Range->first)
+        {
+            m_FreeRangesBySize.erase(it);
+            break;
+        }
+    }
+    m_FreeRangesByOffset.erase(a_Range);
+}
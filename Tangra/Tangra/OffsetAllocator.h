@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Hands out ranges of a linear space, like the elements of a large buffer. Freed ranges are merged with their free neighbours,
+// and the allocator can be compacted to move all the allocations to the start of the space.
+// Only does the bookkeeping, so it can be checked without a GPU. Not thread-safe.
+class OffsetAllocator
+{
+public:
+    static const uint64_t s_InvalidOffset = UINT64_MAX;
+
+    // An allocation which moved while compacting
+    struct Move
+    {
+        uint64_t m_OldOffset;
+        uint64_t m_NewOffset;
+        uint64_t m_Size;
+    };
+
+    OffsetAllocator(uint64_t a_Size);
+
+    // Returns the offset of a range of the size, taken from the smallest free range it fits in, or s_InvalidOffset if none fits
+    uint64_t Allocate(uint64_t a_Size);
+    // Free the range at the offset, which needs to have been returned by Allocate
+    void Free(uint64_t a_Offset);
+
+    // Make the space larger, the new part is free
+    void Grow(uint64_t a_NewSize);
+    // Move all the allocations to the start of the space, keeping their order. Returns the allocations which moved, in the order they need to be copied in.
+    std::vector<Move> Compact();
+
+    uint64_t GetSize() const;
+    uint64_t GetAllocatedSize() const;
+    uint64_t GetLargestFreeRange() const;
+    // Returns how much of the free space can't be used for a single allocation, from 0 when it is all one range to almost 1 when it is spread out
+    float GetFragmentation() const;
+private:
+
+    void AddFreeRange(uint64_t a_Offset, uint64_t a_Size);
+    void RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator a_Range);
+
+    uint64_t m_Size;
+    uint64_t m_AllocatedSize = 0;
+
+    // Free ranges by offset, for merging neighbours, and by size, for finding the best fit
+    std::map<uint64_t, uint64_t> m_FreeRangesByOffset;
+    std::multimap<uint64_t, uint64_t> m_FreeRangesBySize;
+    // Size of every allocation by offset
+    std::map<uint64_t, uint64_t> m_Allocations;
+};
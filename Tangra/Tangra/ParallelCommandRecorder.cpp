@@ -0,0 +1,106 @@
+#include "ParallelCommandRecorder.h"
+#include "CommandQueue.h"
+#include "GraphicsCommandList.h"
+#include "ServiceLocator.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <exception>
+#include <future>
+
+ParallelCommandRecorder::ParallelCommandRecorder(ServiceLocator& a_ServiceLocator, CommandQueue& a_CommandQueue)
+    : m_Services(a_ServiceLocator)
+    , m_CommandQueue(a_CommandQueue)
+    , m_LastRecordingTime(0.0)
+{
+}
+
+void ParallelCommandRecorder::AddJob(RecordingJob a_Job)
+{
+    m_Jobs.push_back(std::move(a_Job));
+}
+
+std::vector<GraphicsCommandList*> ParallelCommandRecorder::Record()
+{
+    std::vector<GraphicsCommandList*> commandLists(m_Jobs.size(), nullptr);
+    if (m_Jobs.empty())
+    {
+        return commandLists;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Every job writes its list into its own slot, which keeps the submission order equal to the job order.
+    // The list is stored before the job runs, so it can be handed back if the job throws.
+    auto recordJob = [this, &commandLists](size_t a_JobIndex)
+    {
+        commandLists[a_JobIndex] = m_CommandQueue.GetCommandList();
+        m_Jobs[a_JobIndex](*commandLists[a_JobIndex]);
+    };
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(m_Jobs.size() - 1);
+    for (size_t i = 1; i < m_Jobs.size(); i++)
+    {
+        futures.push_back(m_Services.m_ThreadPool->Enqueue([&recordJob, i]() { recordJob(i); }));
+    }
+
+    // Record the first job on this thread instead of idling while the workers are busy
+    std::exception_ptr exception;
+    try
+    {
+        recordJob(0);
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    // All the jobs need to have finished before leaving, since they reference the local list of command lists
+    for (std::future<void>& future : futures)
+    {
+        future.wait();
+    }
+
+    m_Jobs.clear();
+
+    for (std::future<void>& future : futures)
+    {
+        try
+        {
+            future.get();
+        }
+        catch (...)
+        {
+            if (!exception)
+            {
+                exception = std::current_exception();
+            }
+        }
+    }
+
+    // None of the lists are submitted if a job failed, they go back to the queue so they aren't lost
+    if (exception)
+    {
+        std::vector<GraphicsCommandList*> takenLists;
+        for (GraphicsCommandList* commandList : commandLists)
+        {
+            if (commandList != nullptr)
+            {
+                takenLists.push_back(commandList);
+            }
+        }
+        m_CommandQueue.DiscardCommandLists(takenLists);
+        std::rethrow_exception(exception);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_LastRecordingTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    return commandLists;
+}
+
+double ParallelCommandRecorder::GetLastRecordingTime() const
+{
+    return m_LastRecordingTime;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class CommandQueue;
+class GraphicsCommandList;
+
+struct ServiceLocator;
+
+// Splits the recording of a frame into ordered jobs which are recorded in parallel on the thread pool.
+// Every job records into its own command list and the lists are handed back in the order the jobs were added,
+// so the submission order is deterministic regardless of which job finished first.
+class ParallelCommandRecorder
+{
+public:
+    using RecordingJob = std::function<void(GraphicsCommandList&)>;
+
+    ParallelCommandRecorder(ServiceLocator& a_ServiceLocator, CommandQueue& a_CommandQueue);
+
+    // Add a job to be recorded with the next call to Record
+    void AddJob(RecordingJob a_Job);
+
+    // Record all the added jobs in parallel and wait for them to finish. The calling thread records the first job itself.
+    // The returned lists are ordered like the jobs and still need to be submitted, preferably with CommandQueue::ExecuteCommandLists.
+    // If a job throws, the exception is rethrown once all the jobs have finished and the lists are handed back to the queue unsubmitted.
+    std::vector<GraphicsCommandList*> Record();
+
+    // Returns the CPU time in milliseconds the last call to Record took
+    double GetLastRecordingTime() const;
+private:
+    ServiceLocator& m_Services;
+    CommandQueue& m_CommandQueue;
+
+    std::vector<RecordingJob> m_Jobs;
+
+    double m_LastRecordingTime;
+};
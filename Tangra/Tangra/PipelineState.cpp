@@ -3,37 +3,59 @@
 #include "Application.h"
 #include "Device.h"
 #include "ServiceLocator.h"
+#include "ShaderStore.h"
 
-#include <d3dcompiler.h>
+#include <algorithm>
+#include <cstring>
 
 using namespace Microsoft::WRL;
 
 PipelineState::PipelineState(InitializationData a_InitData, ServiceLocator& a_ServiceLocator)
     : m_Services(a_ServiceLocator)
 {
-    auto device = m_Services.m_Device->GetDeviceObject();
-
     // Create the root signature description
-    CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
-    CD3DX12_ROOT_PARAMETER* rootParametersPtr =      !a_InitData.m_RootParameters.empty() ? &a_InitData.m_RootParameters[0] : nullptr;
+    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
+    CD3DX12_ROOT_PARAMETER1* rootParametersPtr =     !a_InitData.m_RootParameters.empty() ? &a_InitData.m_RootParameters[0] : nullptr;
     CD3DX12_STATIC_SAMPLER_DESC* staticSamplersPtr = !a_InitData.m_StaticSamplers.empty() ? &a_InitData.m_StaticSamplers[0] : nullptr;
-    rootSignatureDesc.Init(static_cast<UINT>(a_InitData.m_RootParameters.size()), rootParametersPtr,
+    rootSignatureDesc.Init_1_1(static_cast<UINT>(a_InitData.m_RootParameters.size()), rootParametersPtr,
         static_cast<UINT>(a_InitData.m_StaticSamplers.size()), staticSamplersPtr, a_InitData.m_RootSignatureFlags);
 
-    // Serialize and create the root signature
+    // Serialize the root signature. The description is converted to version 1.0 if that is all the device supports.
     ComPtr<ID3DBlob> rootSignatureSerialized, errorBlob;
-    ThrowIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rootSignatureSerialized, &errorBlob));
-    ThrowIfFailed(device->CreateRootSignature(0, rootSignatureSerialized->GetBufferPointer(), rootSignatureSerialized->GetBufferSize(), IID_PPV_ARGS(&m_D3D12RootSignature)));
+    ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, m_Services.m_Device->GetRootSignatureVersion(), &rootSignatureSerialized, &errorBlob));
+    // Pipeline states with the same layout share the root signature, so command lists keep their root arguments when switching between them
+    m_D3D12RootSignature = m_Services.m_Device->GetRootSignatureCache().GetRootSignature(rootSignatureSerialized.Get());
+
+    // The dynamic descriptor heaps of the command lists need to know how large the tables are
+    for (const CD3DX12_ROOT_PARAMETER1& parameter : a_InitData.m_RootParameters)
+    {
+        UINT tableSize = 0;
+        if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+        {
+            for (UINT i = 0; i < parameter.DescriptorTable.NumDescriptorRanges; i++)
+            {
+                const D3D12_DESCRIPTOR_RANGE1& range = parameter.DescriptorTable.pDescriptorRanges[i];
+                // Unbounded tables, like the bindless texture table, are bound directly instead
+                if (range.NumDescriptors == UINT_MAX)
+                {
+                    tableSize = 0;
+                    break;
+                }
+                UINT offset = range.OffsetInDescriptorsFromTableStart == D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND ? tableSize : range.OffsetInDescriptorsFromTableStart;
+                tableSize = std::max(tableSize, offset + range.NumDescriptors);
+            }
+        }
+        m_DescriptorTableSizes.push_back(tableSize);
+    }
 
     // Describe the input layout for the pipeline
     D3D12_INPUT_LAYOUT_DESC inputLayoutDesc;
     inputLayoutDesc.NumElements = static_cast<UINT>(a_InitData.m_InputElements.size());
     inputLayoutDesc.pInputElementDescs = &a_InitData.m_InputElements[0];
 
-    // Read shaders from .cso files, maybe make this runtime shader compilation?
-    ComPtr<ID3DBlob> vertexShaderBlob, pixelShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(&a_InitData.m_VertexShaderPath[0], &vertexShaderBlob));
-    ThrowIfFailed(D3DReadFileToBlob(&a_InitData.m_PixelShaderPath[0], &pixelShaderBlob));
+    // The shader store maps every .cso once and shares the bytecode between pipeline states, without copying it
+    D3D12_SHADER_BYTECODE vertexShader = m_Services.m_ShaderStore->GetShader(a_InitData.m_VertexShaderPath);
+    D3D12_SHADER_BYTECODE pixelShader = m_Services.m_ShaderStore->GetShader(a_InitData.m_PixelShaderPath);
 
     // Fill in the RTV formats to 8, appears to be necessary to avoid D3D12 errors
     while (a_InitData.m_RTVFormats.size() < 8)
@@ -48,8 +70,8 @@ PipelineState::PipelineState(InitializationData a_InitData, ServiceLocator& a_Se
     stateStream.m_RootSignature = m_D3D12RootSignature.Get();
     stateStream.m_DSVFormat = a_InitData.m_DSVFormat;
     stateStream.m_InputLayout = inputLayoutDesc;
-    stateStream.m_PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
-    stateStream.m_VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
+    stateStream.m_PS = CD3DX12_SHADER_BYTECODE(pixelShader);
+    stateStream.m_VS = CD3DX12_SHADER_BYTECODE(vertexShader);
     stateStream.m_PrimitiveTopologyType = a_InitData.m_PrimitiveTopology;
     stateStream.m_RTVFormats = rtvFormats;
     stateStream.m_depthStencil = a_InitData.m_DepthStencil;
@@ -58,8 +80,52 @@ PipelineState::PipelineState(InitializationData a_InitData, ServiceLocator& a_Se
     stateStreamDesc.SizeInBytes = sizeof(PipelineStateStream);
     stateStreamDesc.pPipelineStateSubobjectStream = &stateStream;
 
-    // create the pipeline from the pipeline state stream
-    ThrowIfFailed(device->CreatePipelineState(&stateStreamDesc, IID_PPV_ARGS(&m_D3D12PipelineState)));
+    // Identical pipelines are only created once, and are loaded from the on-disk pipeline library when an earlier run compiled them
+    uint64_t key = HashBytes(rootSignatureSerialized->GetBufferPointer(), rootSignatureSerialized->GetBufferSize());
+    key = HashBytes(vertexShader.pShaderBytecode, vertexShader.BytecodeLength, key);
+    key = HashBytes(pixelShader.pShaderBytecode, pixelShader.BytecodeLength, key);
+    key = HashInitializationData(a_InitData, key);
+    m_D3D12PipelineState = m_Services.m_Device->GetPipelineStateCache().GetPipelineState(key, stateStreamDesc);
+}
+
+uint64_t PipelineState::HashInitializationData(const InitializationData& a_InitData, uint64_t a_Seed)
+{
+    // Fields are hashed one by one, since the padding inside the structs isn't initialized and would make the hash differ between runs.
+    // The root signature and the shaders are hashed from their blobs.
+    uint64_t hash = a_Seed;
+    for (const D3D12_INPUT_ELEMENT_DESC& element : a_InitData.m_InputElements)
+    {
+        hash = HashBytes(element.SemanticName, strlen(element.SemanticName), hash);
+        hash = HashBytes(&element.SemanticIndex, sizeof(element.SemanticIndex), hash);
+        hash = HashBytes(&element.Format, sizeof(element.Format), hash);
+        hash = HashBytes(&element.InputSlot, sizeof(element.InputSlot), hash);
+        hash = HashBytes(&element.AlignedByteOffset, sizeof(element.AlignedByteOffset), hash);
+        hash = HashBytes(&element.InputSlotClass, sizeof(element.InputSlotClass), hash);
+        hash = HashBytes(&element.InstanceDataStepRate, sizeof(element.InstanceDataStepRate), hash);
+    }
+    hash = HashBytes(&a_InitData.m_PrimitiveTopology, sizeof(a_InitData.m_PrimitiveTopology), hash);
+    hash = HashBytes(&a_InitData.m_DSVFormat, sizeof(a_InitData.m_DSVFormat), hash);
+    for (DXGI_FORMAT format : a_InitData.m_RTVFormats)
+    {
+        hash = HashBytes(&format, sizeof(format), hash);
+    }
+
+    const D3D12_DEPTH_STENCIL_DESC& depthStencil = a_InitData.m_DepthStencil;
+    const D3D12_DEPTH_STENCILOP_DESC* faces[] = { &depthStencil.FrontFace, &depthStencil.BackFace };
+    hash = HashBytes(&depthStencil.DepthEnable, sizeof(depthStencil.DepthEnable), hash);
+    hash = HashBytes(&depthStencil.DepthWriteMask, sizeof(depthStencil.DepthWriteMask), hash);
+    hash = HashBytes(&depthStencil.DepthFunc, sizeof(depthStencil.DepthFunc), hash);
+    hash = HashBytes(&depthStencil.StencilEnable, sizeof(depthStencil.StencilEnable), hash);
+    hash = HashBytes(&depthStencil.StencilReadMask, sizeof(depthStencil.StencilReadMask), hash);
+    hash = HashBytes(&depthStencil.StencilWriteMask, sizeof(depthStencil.StencilWriteMask), hash);
+    for (const D3D12_DEPTH_STENCILOP_DESC* face : faces)
+    {
+        hash = HashBytes(&face->StencilFailOp, sizeof(face->StencilFailOp), hash);
+        hash = HashBytes(&face->StencilDepthFailOp, sizeof(face->StencilDepthFailOp), hash);
+        hash = HashBytes(&face->StencilPassOp, sizeof(face->StencilPassOp), hash);
+        hash = HashBytes(&face->StencilFunc, sizeof(face->StencilFunc), hash);
+    }
+    return hash;
 }
 
 Microsoft::WRL::ComPtr<ID3D12PipelineState> PipelineState::GetPSO()
@@ -71,3 +137,8 @@ Microsoft::WRL::ComPtr<ID3D12RootSignature> PipelineState::GetRootSignature()
 {
     return m_D3D12RootSignature;
 }
+
+const std::vector<UINT>& PipelineState::GetDescriptorTableSizes() const
+{
+    return m_DescriptorTableSizes;
+}
@@ -13,7 +13,10 @@ public:
     struct InitializationData
     {
         D3D12_ROOT_SIGNATURE_FLAGS m_RootSignatureFlags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
-        std::vector<CD3DX12_ROOT_PARAMETER> m_RootParameters;
+        // Root parameters use the version 1.1 types, so descriptor ranges and root descriptors can carry DATA_STATIC and DESCRIPTORS_VOLATILE flags.
+        // Without flags, descriptors need to be written before the table is set and can't change until the list has executed.
+        // The flags are dropped when the device only supports version 1.0, which treats everything as volatile.
+        std::vector<CD3DX12_ROOT_PARAMETER1> m_RootParameters;
         std::vector<CD3DX12_STATIC_SAMPLER_DESC> m_StaticSamplers;
         std::vector<D3D12_INPUT_ELEMENT_DESC> m_InputElements;
         D3D12_PRIMITIVE_TOPOLOGY_TYPE m_PrimitiveTopology = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
@@ -29,10 +32,15 @@ public:
     // getters for the D3D12 interfaces
     Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPSO();
     Microsoft::WRL::ComPtr<ID3D12RootSignature> GetRootSignature();
+    // Number of descriptors in the table of every root parameter, 0 for parameters which aren't tables or are unbounded
+    const std::vector<UINT>& GetDescriptorTableSizes() const;
 
 
 private:
 
+    // Stable hash of everything in the initialization data which ends up in the pipeline, besides the root signature and the shaders
+    static uint64_t HashInitializationData(const InitializationData& a_InitData, uint64_t a_Seed);
+
     struct PipelineStateStream
     {
         CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE m_RootSignature;
@@ -49,6 +57,7 @@ private:
 
     Microsoft::WRL::ComPtr<ID3D12PipelineState> m_D3D12PipelineState;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_D3D12RootSignature;
+    std::vector<UINT> m_DescriptorTableSizes;
 
 };
 
@@ -0,0 +1,220 @@
+#include "PipelineStateCache.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include <dxgi1_6.h>
+
+#include <chrono>
+#include <cwchar>
+#include <fstream>
+#include <iostream>
+
+using namespace Microsoft::WRL;
+
+const uint32_t PipelineStateCache::s_FileMagic;
+const uint32_t PipelineStateCache::s_FileVersion;
+
+PipelineStateCache::PipelineStateCache(ServiceLocator& a_ServiceLocator, const std::wstring& a_FilePath)
+    : m_Services(a_ServiceLocator)
+    , m_FilePath(a_FilePath)
+    , m_FileHeader(CreateFileHeader())
+{
+    ReadLibraryFromDisk();
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+    Save();
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetPipelineState(uint64_t a_Key, const D3D12_PIPELINE_STATE_STREAM_DESC& a_Desc)
+{
+    const std::wstring name = GetPipelineName(a_Key);
+    ComPtr<ID3D12PipelineState> pipelineState;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_Statistics.m_NumRequests;
+
+        auto existing = m_PipelineStates.find(a_Key);
+        if (existing != m_PipelineStates.end())
+        {
+            ++m_Statistics.m_NumMemoryHits;
+            return existing->second;
+        }
+
+        // Loading fails if the library doesn't contain the pipeline or the description doesn't match the stored one
+        if (m_Library)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (SUCCEEDED(m_Library->LoadPipeline(name.c_str(), &a_Desc, IID_PPV_ARGS(&pipelineState))))
+            {
+                auto end = std::chrono::high_resolution_clock::now();
+                m_Statistics.m_LoadMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+                ++m_Statistics.m_NumLibraryHits;
+
+                m_PipelineStates[a_Key] = pipelineState;
+                m_Statistics.m_NumPipelineStates = m_PipelineStates.size();
+                return pipelineState;
+            }
+        }
+    }
+
+    // Compiling is slow, so it happens outside the lock
+    auto start = std::chrono::high_resolution_clock::now();
+    ThrowIfFailed(m_Services.m_Device->GetDeviceObject()->CreatePipelineState(&a_Desc, IID_PPV_ARGS(&pipelineState)));
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Statistics.m_CompileMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    ++m_Statistics.m_NumCompiled;
+
+    // Another thread may have compiled the same pipeline in the meantime, everyone gets the one which was stored first
+    auto existing = m_PipelineStates.find(a_Key);
+    if (existing != m_PipelineStates.end())
+    {
+        return existing->second;
+    }
+
+    m_PipelineStates[a_Key] = pipelineState;
+    m_Statistics.m_NumPipelineStates = m_PipelineStates.size();
+    if (m_Library && SUCCEEDED(m_Library->StorePipeline(name.c_str(), pipelineState.Get())))
+    {
+        m_Dirty = true;
+    }
+    return pipelineState;
+}
+
+void PipelineStateCache::Save()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Library || !m_Dirty)
+    {
+        return;
+    }
+
+    std::vector<uint8_t> libraryData(m_Library->GetSerializedSize());
+    if (FAILED(m_Library->Serialize(libraryData.data(), libraryData.size())))
+    {
+        std::cout << "WARNING: Could not serialize the pipeline library." << std::endl;
+        return;
+    }
+
+    FileHeader header = m_FileHeader;
+    header.m_LibrarySize = libraryData.size();
+
+    std::ofstream file(m_FilePath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(libraryData.data()), libraryData.size());
+    if (!file)
+    {
+        std::cout << "WARNING: Could not write the pipeline library to disk." << std::endl;
+        return;
+    }
+    m_Dirty = false;
+}
+
+PipelineStateCache::Statistics PipelineStateCache::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
+
+PipelineStateCache::FileHeader PipelineStateCache::CreateFileHeader()
+{
+    ComPtr<IDXGIAdapter4> adapter = m_Services.m_Device->GetAdapter();
+    DXGI_ADAPTER_DESC3 adapterDesc = {};
+    ThrowIfFailed(adapter->GetDesc3(&adapterDesc));
+
+    // The user mode driver version is only reported through this interface check
+    LARGE_INTEGER driverVersion = {};
+    if (FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+    {
+        driverVersion.QuadPart = 0;
+    }
+
+    FileHeader header = {};
+    header.m_Magic = s_FileMagic;
+    header.m_Version = s_FileVersion;
+    header.m_VendorId = adapterDesc.VendorId;
+    header.m_DeviceId = adapterDesc.DeviceId;
+    header.m_SubSysId = adapterDesc.SubSysId;
+    header.m_Revision = adapterDesc.Revision;
+    header.m_DriverVersion = driverVersion.QuadPart;
+    header.m_LibrarySize = 0;
+    return header;
+}
+
+void PipelineStateCache::ReadLibraryFromDisk()
+{
+    ComPtr<ID3D12Device1> device;
+    if (FAILED(m_Services.m_Device->GetDeviceObject().As(&device)))
+    {
+        return;
+    }
+
+    // Only use the file if it was written for this adapter and driver, compiled pipelines can't be used with anything else
+    std::ifstream file(m_FilePath, std::ios::binary);
+    if (file)
+    {
+        const FileHeader& expected = m_FileHeader;
+        FileHeader header = {};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if (file && header.m_Magic == expected.m_Magic && header.m_Version == expected.m_Version &&
+            header.m_VendorId == expected.m_VendorId && header.m_DeviceId == expected.m_DeviceId &&
+            header.m_SubSysId == expected.m_SubSysId && header.m_Revision == expected.m_Revision &&
+            header.m_DriverVersion == expected.m_DriverVersion)
+        {
+            m_LibraryData.resize(static_cast<size_t>(header.m_LibrarySize));
+            file.read(reinterpret_cast<char*>(m_LibraryData.data()), m_LibraryData.size());
+            if (!file)
+            {
+                m_LibraryData.clear();
+            }
+        }
+        else
+        {
+            std::cout << "Pipeline library on disk was written for another adapter or driver, it will be rebuilt." << std::endl;
+        }
+    }
+
+    // The runtime rejects the data as well if the driver doesn't accept it anymore, in which case the library starts out empty
+    ComPtr<ID3D12PipelineLibrary> library;
+    if (!m_LibraryData.empty())
+    {
+        if (SUCCEEDED(device->CreatePipelineLibrary(m_LibraryData.data(), m_LibraryData.size(), IID_PPV_ARGS(&library))))
+        {
+            m_Statistics.m_LibraryLoadedFromDisk = true;
+        }
+        else
+        {
+            std::cout << "Pipeline library on disk was rejected by the driver, it will be rebuilt." << std::endl;
+            m_LibraryData.clear();
+        }
+    }
+    if (!library)
+    {
+        // Fails when pipeline libraries aren't supported, for instance under some graphics debuggers
+        if (FAILED(device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library))))
+        {
+            return;
+        }
+        // A new library needs to be written even if it ends up with the same pipelines as the rejected file
+        m_Dirty = true;
+    }
+
+    // Loading from a pipeline state stream needs the newer interface
+    if (FAILED(library.As(&m_Library)))
+    {
+        m_Library.Reset();
+    }
+}
+
+std::wstring PipelineStateCache::GetPipelineName(uint64_t a_Key)
+{
+    wchar_t name[17];
+    swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(a_Key));
+    return name;
+}
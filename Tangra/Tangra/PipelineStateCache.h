@@ -0,0 +1,87 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ServiceLocator;
+
+// Creates every distinct pipeline state once, keyed by a stable hash of its description and shader bytecode.
+// Compiled pipelines are stored in an ID3D12PipelineLibrary which is written to disk, so the next start loads them instead of compiling them again.
+// The file is ignored when the adapter or driver changed since it was written. Without pipeline library support pipelines are only deduplicated in memory.
+// Thread-safe, pipelines are compiled outside the lock so several threads can compile at the same time.
+class PipelineStateCache
+{
+public:
+
+    struct Statistics
+    {
+        // Number of distinct pipeline states created
+        size_t m_NumPipelineStates = 0;
+        uint64_t m_NumRequests = 0;
+        // Requests for pipeline states which were already created
+        uint64_t m_NumMemoryHits = 0;
+        // Pipeline states loaded from the pipeline library, and the time spent loading them
+        uint64_t m_NumLibraryHits = 0;
+        double m_LoadMilliseconds = 0.0;
+        // Pipeline states compiled by the driver, and the time spent compiling them
+        uint64_t m_NumCompiled = 0;
+        double m_CompileMilliseconds = 0.0;
+        // True if a pipeline library written by an earlier run was loaded, so this is a warm start
+        bool m_LibraryLoadedFromDisk = false;
+    };
+
+    // Loads the pipeline library from the file if it was written for the same adapter and driver
+    PipelineStateCache(ServiceLocator& a_ServiceLocator, const std::wstring& a_FilePath);
+    // Writes the library back to disk if pipelines were added since it was last saved
+    ~PipelineStateCache();
+
+    // Returns the pipeline state with the key. It is loaded from the library or compiled from the description if it wasn't created before.
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState(uint64_t a_Key, const D3D12_PIPELINE_STATE_STREAM_DESC& a_Desc);
+
+    // Write the pipeline library to disk if pipelines were added since it was last saved
+    void Save();
+
+    Statistics GetStatistics();
+private:
+
+    // Written in front of the serialized library, to reject files from other adapters, drivers or versions of the file format
+    struct FileHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        UINT m_VendorId;
+        UINT m_DeviceId;
+        UINT m_SubSysId;
+        UINT m_Revision;
+        int64_t m_DriverVersion;
+        uint64_t m_LibrarySize;
+    };
+
+    static const uint32_t s_FileMagic = 0x43535054; // "TPSC"
+    static const uint32_t s_FileVersion = 1;
+
+    // Describes the current adapter and driver, created once since the device may already be gone when the library is saved at destruction
+    FileHeader CreateFileHeader();
+    void ReadLibraryFromDisk();
+    static std::wstring GetPipelineName(uint64_t a_Key);
+
+    ServiceLocator& m_Services;
+    std::wstring m_FilePath;
+    FileHeader m_FileHeader;
+
+    std::mutex m_Mutex;
+    std::unordered_map<uint64_t, Microsoft::WRL::ComPtr<ID3D12PipelineState>> m_PipelineStates;
+
+    // The library reads from the data it was created from, so the data is kept for as long as the library
+    std::vector<uint8_t> m_LibraryData;
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary1> m_Library;
+    // Set when pipelines were stored in the library since it was last saved
+    bool m_Dirty = false;
+
+    Statistics m_Statistics;
+};
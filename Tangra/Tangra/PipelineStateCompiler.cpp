@@ -0,0 +1,171 @@
+#include "PipelineStateCompiler.h"
+#include "ServiceLocator.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+const PipelineStateCompiler::PipelineHandle PipelineStateCompiler::s_InvalidPipeline;
+
+namespace
+{
+    size_t GetCompilerThreadCount(size_t a_NumThreads)
+    {
+        if (a_NumThreads > 0)
+        {
+            return a_NumThreads;
+        }
+        return std::max<size_t>(1, static_cast<size_t>(std::thread::hardware_concurrency()) / 4);
+    }
+}
+
+PipelineStateCompiler::PipelineStateCompiler(ServiceLocator& a_ServiceLocator, size_t a_NumThreads)
+    : m_Services(a_ServiceLocator)
+    , m_ShuttingDown(false)
+    , m_ThreadPool(GetCompilerThreadCount(a_NumThreads))
+{
+}
+
+PipelineStateCompiler::~PipelineStateCompiler()
+{
+    m_ShuttingDown = true;
+    // Wait for the compiles which already started, the rest return right away
+    WaitForAll();
+}
+
+PipelineStateCompiler::PipelineHandle PipelineStateCompiler::RequestPipelineState(const PipelineState::InitializationData& a_InitData, PipelineHandle a_Fallback)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    PipelineHandle handle = static_cast<PipelineHandle>(m_Requests.size());
+    m_Requests.emplace_back();
+    m_Requests.back().m_Fallback = a_Fallback;
+    m_Requests.back().m_RequestTime = std::chrono::high_resolution_clock::now();
+
+    ++m_Statistics.m_NumRequested;
+    ++m_Statistics.m_QueueDepth;
+
+    // Forget the compiles which have finished, so the list doesn't grow for the whole session
+    m_Compiles.erase(std::remove_if(m_Compiles.begin(), m_Compiles.end(), [](const std::future<void>& a_Compile)
+    {
+        return a_Compile.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), m_Compiles.end());
+
+    std::shared_ptr<OwnedInitializationData> initData = CopyInitializationData(a_InitData);
+    m_Compiles.push_back(m_ThreadPool.Enqueue([this, handle, initData]() { Compile(handle, initData->m_InitData); }));
+    return handle;
+}
+
+bool PipelineStateCompiler::IsReady(PipelineHandle a_Pipeline)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return a_Pipeline < m_Requests.size() && m_Requests[a_Pipeline].m_PipelineState != nullptr;
+}
+
+PipelineState* PipelineStateCompiler::GetPipelineState(PipelineHandle a_Pipeline)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Follow the fallbacks until one is ready, a fallback may be waiting for its own compile as well
+    PipelineHandle handle = a_Pipeline;
+    for (size_t i = 0; i < m_Requests.size() && handle < m_Requests.size(); i++)
+    {
+        const Request& request = m_Requests[handle];
+        if (request.m_PipelineState)
+        {
+            return request.m_PipelineState.get();
+        }
+        handle = request.m_Fallback;
+    }
+    return nullptr;
+}
+
+void PipelineStateCompiler::WaitForAll()
+{
+    std::vector<std::future<void>> compiles;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        compiles.swap(m_Compiles);
+    }
+
+    // Compile catches its own exceptions, so the futures only signal completion
+    for (std::future<void>& compile : compiles)
+    {
+        compile.wait();
+    }
+}
+
+PipelineStateCompiler::Statistics PipelineStateCompiler::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
+
+std::shared_ptr<PipelineStateCompiler::OwnedInitializationData> PipelineStateCompiler::CopyInitializationData(const PipelineState::InitializationData& a_InitData)
+{
+    auto copy = std::make_shared<OwnedInitializationData>();
+    copy->m_InitData = a_InitData;
+
+    // Reserve up front, the pointers into the copies need to stay valid while the rest is copied
+    copy->m_DescriptorRanges.reserve(a_InitData.m_RootParameters.size());
+    for (CD3DX12_ROOT_PARAMETER1& parameter : copy->m_InitData.m_RootParameters)
+    {
+        if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+        {
+            const D3D12_ROOT_DESCRIPTOR_TABLE1& table = parameter.DescriptorTable;
+            copy->m_DescriptorRanges.emplace_back(table.pDescriptorRanges, table.pDescriptorRanges + table.NumDescriptorRanges);
+            parameter.DescriptorTable.pDescriptorRanges = copy->m_DescriptorRanges.back().data();
+        }
+    }
+
+    copy->m_SemanticNames.reserve(a_InitData.m_InputElements.size());
+    for (D3D12_INPUT_ELEMENT_DESC& element : copy->m_InitData.m_InputElements)
+    {
+        copy->m_SemanticNames.emplace_back(element.SemanticName);
+        element.SemanticName = copy->m_SemanticNames.back().c_str();
+    }
+    return copy;
+}
+
+void PipelineStateCompiler::Compile(PipelineHandle a_Pipeline, const PipelineState::InitializationData& a_InitData)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        --m_Statistics.m_QueueDepth;
+        if (m_ShuttingDown)
+        {
+            return;
+        }
+        ++m_Statistics.m_NumCompiling;
+    }
+
+    // The pipeline state cache makes compiling the same pipeline twice, or one an earlier run compiled, cheap
+    std::unique_ptr<PipelineState> pipelineState;
+    try
+    {
+        pipelineState = std::make_unique<PipelineState>(a_InitData, m_Services);
+    }
+    catch (const std::exception& a_Exception)
+    {
+        std::cout << "ERROR: Pipeline state " << a_Pipeline << " failed to compile: " << a_Exception.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    --m_Statistics.m_NumCompiling;
+    if (!pipelineState)
+    {
+        ++m_Statistics.m_NumFailed;
+        return;
+    }
+
+    Request& request = m_Requests[a_Pipeline];
+    request.m_PipelineState = std::move(pipelineState);
+
+    double latency = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - request.m_RequestTime).count();
+    ++m_Statistics.m_NumCompleted;
+    m_TotalLatencyMilliseconds += latency;
+    m_Statistics.m_LastLatencyMilliseconds = latency;
+    m_Statistics.m_AverageLatencyMilliseconds = m_TotalLatencyMilliseconds / static_cast<double>(m_Statistics.m_NumCompleted);
+    m_Statistics.m_MaxLatencyMilliseconds = std::max(m_Statistics.m_MaxLatencyMilliseconds, latency);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PipelineState.h"
+#include "ThreadPool.h"
+
+struct ServiceLocator;
+
+// Compiles pipeline states on worker threads, so requesting one never stalls the thread which records the frame.
+// A request returns a handle right away. Until the pipeline has compiled the handle resolves to its fallback pipeline, or to nothing so the draw
+// can be skipped. The compiler has its own small thread pool, so compiles never delay the command recording on the shared pool. Thread-safe.
+class PipelineStateCompiler
+{
+public:
+    using PipelineHandle = uint32_t;
+
+    static const PipelineHandle s_InvalidPipeline = UINT32_MAX;
+
+    struct Statistics
+    {
+        // Requests waiting for a worker thread, and requests being compiled right now
+        size_t m_QueueDepth = 0;
+        size_t m_NumCompiling = 0;
+        uint64_t m_NumRequested = 0;
+        uint64_t m_NumCompleted = 0;
+        uint64_t m_NumFailed = 0;
+        // Time from the request until the pipeline was ready, over all completed requests
+        double m_LastLatencyMilliseconds = 0.0;
+        double m_AverageLatencyMilliseconds = 0.0;
+        double m_MaxLatencyMilliseconds = 0.0;
+    };
+
+    // A thread count of 0 uses a quarter of the hardware threads, leaving the rest to the shared pool
+    PipelineStateCompiler(ServiceLocator& a_ServiceLocator, size_t a_NumThreads = 0);
+    // Requests which haven't started compiling are dropped, the ones being compiled are finished
+    ~PipelineStateCompiler();
+
+    // Queue the pipeline state for compilation. Draws use the fallback pipeline, which needs the same root signature, until it has compiled.
+    PipelineHandle RequestPipelineState(const PipelineState::InitializationData& a_InitData, PipelineHandle a_Fallback = s_InvalidPipeline);
+
+    // Returns true once the pipeline state of the handle has compiled
+    bool IsReady(PipelineHandle a_Pipeline);
+    // Returns the compiled pipeline state, its fallback while it is compiling or nullptr if neither is ready, in which case the draw should be skipped
+    PipelineState* GetPipelineState(PipelineHandle a_Pipeline);
+
+    // Block until every requested pipeline state has compiled or failed
+    void WaitForAll();
+
+    Statistics GetStatistics();
+private:
+
+    struct Request
+    {
+        std::unique_ptr<PipelineState> m_PipelineState;
+        PipelineHandle m_Fallback = s_InvalidPipeline;
+        std::chrono::high_resolution_clock::time_point m_RequestTime;
+    };
+
+    // Initialization data which owns what its root parameters and input elements point to, since the caller's may be gone by the time it is compiled
+    struct OwnedInitializationData
+    {
+        PipelineState::InitializationData m_InitData;
+        std::vector<std::vector<D3D12_DESCRIPTOR_RANGE1>> m_DescriptorRanges;
+        std::vector<std::string> m_SemanticNames;
+    };
+
+    static std::shared_ptr<OwnedInitializationData> CopyInitializationData(const PipelineState::InitializationData& a_InitData);
+    void Compile(PipelineHandle a_Pipeline, const PipelineState::InitializationData& a_InitData);
+
+    ServiceLocator& m_Services;
+
+    std::mutex m_Mutex;
+    std::vector<Request> m_Requests;
+    std::vector<std::future<void>> m_Compiles;
+
+    Statistics m_Statistics;
+    double m_TotalLatencyMilliseconds = 0.0;
+
+    // Set when the compiler is destroyed, so the queued requests return without compiling
+    std::atomic<bool> m_ShuttingDown;
+    // Declared last, so the worker threads are joined before anything they use is destroyed
+    ThreadPool m_ThreadPool;
+};
@@ -1,8 +1,16 @@
 sampler samp : register(s0, space1);
 
-Texture2D diffuseTex : register(t0, space0);
+// Every texture in the shader visible heap, the draw picks one with its texture index
+Texture2D textures[] : register(t0, space2);
+
+struct DrawConstants
+{
+    uint textureIndex;
+};
+
+ConstantBuffer<DrawConstants> DrawCB : register(b1, space0);
 
 float4 main(float2 texCoord : TEXCOORD) : SV_TARGET
 {
-    return diffuseTex.Sample(samp, texCoord);
-}
\ No newline at end of file
+    return textures[DrawCB.textureIndex].Sample(samp, texCoord);
+}
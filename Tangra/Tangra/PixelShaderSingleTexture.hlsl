@@ -0,0 +1,9 @@
+sampler samp : register(s0, space1);
+
+// Used on devices without bindless support, the draw binds its texture with a table of one descriptor
+Texture2D tex : register(t0, space2);
+
+float4 main(float2 texCoord : TEXCOORD) : SV_TARGET
+{
+    return tex.Sample(samp, texCoord);
+}
@@ -0,0 +1,399 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+const size_t RenderGraph::s_InvalidIndex;
+
+namespace
+{
+    using Usage = RenderGraph::ResourceUsage;
+
+    const uint32_t g_ReadOnlyUsages = static_cast<uint32_t>(Usage::DepthRead) | static_cast<uint32_t>(Usage::PixelShaderResource) |
+        static_cast<uint32_t>(Usage::NonPixelShaderResource) | static_cast<uint32_t>(Usage::CopySource) | static_cast<uint32_t>(Usage::VertexBuffer) |
+        static_cast<uint32_t>(Usage::IndexBuffer) | static_cast<uint32_t>(Usage::Present);
+    const uint32_t g_ComputeCompatibleUsages = static_cast<uint32_t>(Usage::NonPixelShaderResource) | static_cast<uint32_t>(Usage::UnorderedAccess) |
+        static_cast<uint32_t>(Usage::CopySource) | static_cast<uint32_t>(Usage::CopyDest) | static_cast<uint32_t>(Usage::VertexBuffer) |
+        static_cast<uint32_t>(Usage::Present);
+
+    // Where the graph is in its walk over a resource
+    struct ResourceState
+    {
+        RenderGraph::ResourceUsage m_Usage;
+        // Last step which wrote to or transitioned the resource, and the steps which read it since
+        size_t m_LastWriter = RenderGraph::s_InvalidIndex;
+        std::vector<size_t> m_Readers;
+    };
+
+    size_t QueueIndex(RenderGraph::QueueType a_Queue)
+    {
+        return a_Queue == RenderGraph::QueueType::Graphics ? 0 : 1;
+    }
+
+    void AddUnique(std::vector<size_t>& a_Values, size_t a_Value)
+    {
+        if (std::find(a_Values.begin(), a_Values.end(), a_Value) == a_Values.end())
+        {
+            a_Values.push_back(a_Value);
+        }
+    }
+}
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& a_Graph, size_t a_Pass)
+    : m_Graph(a_Graph)
+    , m_Pass(a_Pass)
+{
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(ResourceHandle a_Resource, ResourceUsage a_Usage)
+{
+    AddAccess(a_Resource, a_Usage, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(ResourceHandle a_Resource, ResourceUsage a_Usage)
+{
+    AddAccess(a_Resource, a_Usage, true);
+    return *this;
+}
+
+void RenderGraph::PassBuilder::AddAccess(ResourceHandle a_Resource, ResourceUsage a_Usage, bool a_IsWrite)
+{
+    Pass& pass = m_Graph.m_Passes[m_Pass];
+    auto access = std::find_if(pass.m_Accesses.begin(), pass.m_Accesses.end(), [a_Resource](const Access& a_Access)
+    {
+        return a_Access.m_Resource == a_Resource;
+    });
+    if (access == pass.m_Accesses.end())
+    {
+        pass.m_Accesses.push_back({ a_Resource, a_Usage, a_IsWrite });
+        return;
+    }
+
+    // The resource can only be in one state during the pass, so all the declarations need to fit in it. The present state can't be combined with anything.
+    bool combinedRead = !access->m_IsWrite && !a_IsWrite && IsReadOnly(access->m_Usage) && IsReadOnly(a_Usage) &&
+        access->m_Usage != ResourceUsage::Present && a_Usage != ResourceUsage::Present;
+    if (access->m_Usage == a_Usage)
+    {
+        access->m_IsWrite = access->m_IsWrite || a_IsWrite;
+    }
+    else if (combinedRead)
+    {
+        access->m_Usage = static_cast<ResourceUsage>(static_cast<uint32_t>(access->m_Usage) | static_cast<uint32_t>(a_Usage));
+    }
+    else
+    {
+        throw std::runtime_error("Pass " + pass.m_Name + " uses resource " + m_Graph.GetResourceName(a_Resource) + " in conflicting ways");
+    }
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffects()
+{
+    m_Graph.m_Passes[m_Pass].m_HasSideEffects = true;
+    return *this;
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportResource(const std::string& a_Name, ResourceUsage a_InitialUsage, ResourceUsage a_FinalUsage)
+{
+    m_Resources.push_back({ a_Name, true, a_InitialUsage, a_FinalUsage });
+    return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateResource(const std::string& a_Name)
+{
+    m_Resources.push_back({ a_Name, false, ResourceUsage::Common, ResourceUsage::Common });
+    return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& a_Name, PassType a_Type, ExecuteCallback a_Execute)
+{
+    Pass pass;
+    pass.m_Name = a_Name;
+    pass.m_Type = a_Type;
+    pass.m_Execute = a_Execute;
+    m_Passes.push_back(pass);
+
+    return PassBuilder(*this, m_Passes.size() - 1);
+}
+
+void RenderGraph::SetAsyncComputeEnabled(bool a_Enabled)
+{
+    m_AsyncComputeEnabled = a_Enabled;
+}
+
+RenderGraph::Schedule RenderGraph::Compile() const
+{
+    Schedule schedule;
+
+    std::vector<bool> livePasses = FindLivePasses();
+
+    std::vector<ResourceState> states(m_Resources.size());
+    for (size_t i = 0; i < m_Resources.size(); i++)
+    {
+        states[i].m_Usage = m_Resources[i].m_InitialUsage;
+    }
+    schedule.m_ResourceLifetimes.resize(m_Resources.size());
+
+    // Steps on other queues every step needs to wait for
+    std::vector<std::vector<size_t>> crossQueueDependencies;
+
+    auto addStep = [&](size_t a_Pass, QueueType a_Queue, std::vector<Barrier>& a_Barriers)
+    {
+        Step step;
+        step.m_Pass = a_Pass;
+        step.m_Queue = a_Queue;
+        step.m_Barriers.swap(a_Barriers);
+        schedule.m_NumBarriers += step.m_Barriers.size();
+        schedule.m_Steps.push_back(step);
+        crossQueueDependencies.emplace_back();
+        return schedule.m_Steps.size() - 1;
+    };
+
+    // Order the step after the earlier accesses it conflicts with. Transitions count as writes, so they wait for all the earlier readers.
+    auto accessResource = [&](size_t a_Step, ResourceHandle a_Resource, ResourceUsage a_Usage, bool a_IsWrite)
+    {
+        ResourceLifetime& lifetime = schedule.m_ResourceLifetimes[a_Resource];
+        if (!lifetime.IsUsed())
+        {
+            lifetime.m_FirstStep = a_Step;
+        }
+        lifetime.m_LastStep = a_Step;
+        lifetime.m_UsedOnCompute = lifetime.m_UsedOnCompute || schedule.m_Steps[a_Step].m_Queue == QueueType::Compute;
+
+        ResourceState& state = states[a_Resource];
+        bool isWrite = a_IsWrite || state.m_Usage != a_Usage;
+
+        std::vector<size_t> dependencies;
+        if (state.m_LastWriter != s_InvalidIndex)
+        {
+            dependencies.push_back(state.m_LastWriter);
+        }
+        if (isWrite)
+        {
+            dependencies.insert(dependencies.end(), state.m_Readers.begin(), state.m_Readers.end());
+        }
+        for (size_t dependency : dependencies)
+        {
+            // Steps on the same queue are already ordered by the queue
+            if (schedule.m_Steps[dependency].m_Queue != schedule.m_Steps[a_Step].m_Queue)
+            {
+                AddUnique(crossQueueDependencies[a_Step], dependency);
+            }
+        }
+
+        if (isWrite)
+        {
+            state.m_LastWriter = a_Step;
+            state.m_Readers.clear();
+        }
+        else
+        {
+            state.m_Readers.push_back(a_Step);
+        }
+        state.m_Usage = a_Usage;
+    };
+
+    for (size_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+    {
+        if (!livePasses[passIndex])
+        {
+            schedule.m_CulledPasses.push_back(passIndex);
+            continue;
+        }
+
+        const Pass& pass = m_Passes[passIndex];
+        QueueType queue = pass.m_Type == PassType::Compute && m_AsyncComputeEnabled ? QueueType::Compute : QueueType::Graphics;
+
+        std::vector<Barrier> barriers;
+        std::vector<Barrier> graphicsBarriers;
+        for (const Access& access : pass.m_Accesses)
+        {
+            const ResourceState& state = states[access.m_Resource];
+            if (state.m_Usage != access.m_Usage)
+            {
+                Barrier barrier = { access.m_Resource, state.m_Usage, access.m_Usage };
+
+                // The compute queue can't transition from or to graphics states, so the graphics queue does that before the pass
+                bool computeCanTransition = IsComputeCompatible(barrier.m_Before) && IsComputeCompatible(barrier.m_After);
+                if (queue == QueueType::Compute && !computeCanTransition)
+                {
+                    graphicsBarriers.push_back(barrier);
+                }
+                else
+                {
+                    barriers.push_back(barrier);
+                }
+            }
+            else if (access.m_Usage == ResourceUsage::UnorderedAccess && state.m_LastWriter != s_InvalidIndex)
+            {
+                // Unordered access after unordered access needs the earlier writes to finish
+                barriers.push_back({ access.m_Resource, ResourceUsage::UnorderedAccess, ResourceUsage::UnorderedAccess });
+            }
+        }
+
+        if (!graphicsBarriers.empty())
+        {
+            std::vector<Barrier> barrierStepBarriers = graphicsBarriers;
+            size_t barrierStep = addStep(s_InvalidIndex, QueueType::Graphics, barrierStepBarriers);
+            for (const Barrier& barrier : graphicsBarriers)
+            {
+                accessResource(barrierStep, barrier.m_Resource, barrier.m_After, true);
+            }
+        }
+
+        size_t passStep = addStep(passIndex, queue, barriers);
+        for (const Access& access : pass.m_Accesses)
+        {
+            accessResource(passStep, access.m_Resource, access.m_Usage, access.m_IsWrite);
+        }
+    }
+
+    // Move the imported resources into the state the code outside of the graph expects them in
+    std::vector<Barrier> finalBarriers;
+    for (size_t i = 0; i < m_Resources.size(); i++)
+    {
+        if (m_Resources[i].m_IsImported && states[i].m_Usage != m_Resources[i].m_FinalUsage)
+        {
+            finalBarriers.push_back({ static_cast<ResourceHandle>(i), states[i].m_Usage, m_Resources[i].m_FinalUsage });
+        }
+    }
+    if (!finalBarriers.empty())
+    {
+        std::vector<Barrier> barrierStepBarriers = finalBarriers;
+        size_t finalStep = addStep(s_InvalidIndex, QueueType::Graphics, barrierStepBarriers);
+        for (const Barrier& barrier : finalBarriers)
+        {
+            accessResource(finalStep, barrier.m_Resource, barrier.m_After, true);
+        }
+    }
+
+    // Group the steps into submissions. A queue can only wait at the start of a submission, and a submission which is waited on
+    // needs to be submitted before the one waiting on it, so both end up starting new submissions.
+    std::vector<size_t> stepSubmissions(schedule.m_Steps.size(), s_InvalidIndex);
+    size_t openSubmissions[2] = { s_InvalidIndex, s_InvalidIndex };
+    for (size_t stepIndex = 0; stepIndex < schedule.m_Steps.size(); stepIndex++)
+    {
+        size_t queueIndex = QueueIndex(schedule.m_Steps[stepIndex].m_Queue);
+
+        std::vector<size_t> waits;
+        for (size_t dependency : crossQueueDependencies[stepIndex])
+        {
+            size_t dependencySubmission = stepSubmissions[dependency];
+            if (openSubmissions[1 - queueIndex] == dependencySubmission)
+            {
+                openSubmissions[1 - queueIndex] = s_InvalidIndex;
+            }
+            AddUnique(waits, dependencySubmission);
+        }
+
+        // The open submission can be extended if it already waits for everything this step needs
+        size_t submission = openSubmissions[queueIndex];
+        if (submission != s_InvalidIndex)
+        {
+            const std::vector<size_t>& submissionWaits = schedule.m_Submissions[submission].m_WaitForSubmissions;
+            for (size_t wait : waits)
+            {
+                if (std::find(submissionWaits.begin(), submissionWaits.end(), wait) == submissionWaits.end())
+                {
+                    submission = s_InvalidIndex;
+                    break;
+                }
+            }
+        }
+
+        if (submission == s_InvalidIndex)
+        {
+            Submission newSubmission;
+            newSubmission.m_Queue = schedule.m_Steps[stepIndex].m_Queue;
+            newSubmission.m_WaitForSubmissions = waits;
+            schedule.m_Submissions.push_back(newSubmission);
+            submission = schedule.m_Submissions.size() - 1;
+            openSubmissions[queueIndex] = submission;
+        }
+
+        schedule.m_Submissions[submission].m_Steps.push_back(stepIndex);
+        stepSubmissions[stepIndex] = submission;
+    }
+
+    return schedule;
+}
+
+size_t RenderGraph::GetNumPasses() const
+{
+    return m_Passes.size();
+}
+
+const std::string& RenderGraph::GetPassName(size_t a_Pass) const
+{
+    return m_Passes[a_Pass].m_Name;
+}
+
+void RenderGraph::ExecutePass(size_t a_Pass, GraphicsCommandList& a_CommandList) const
+{
+    if (m_Passes[a_Pass].m_Execute)
+    {
+        m_Passes[a_Pass].m_Execute(a_CommandList);
+    }
+}
+
+size_t RenderGraph::GetNumResources() const
+{
+    return m_Resources.size();
+}
+
+const std::string& RenderGraph::GetResourceName(ResourceHandle a_Resource) const
+{
+    return m_Resources[a_Resource].m_Name;
+}
+
+bool RenderGraph::IsImported(ResourceHandle a_Resource) const
+{
+    return m_Resources[a_Resource].m_IsImported;
+}
+
+bool RenderGraph::IsComputeCompatible(ResourceUsage a_Usage)
+{
+    return (static_cast<uint32_t>(a_Usage) & ~g_ComputeCompatibleUsages) == 0;
+}
+
+bool RenderGraph::IsReadOnly(ResourceUsage a_Usage)
+{
+    // The common state allows writes
+    return a_Usage != ResourceUsage::Common && (static_cast<uint32_t>(a_Usage) & ~g_ReadOnlyUsages) == 0;
+}
+
+std::vector<bool> RenderGraph::FindLivePasses() const
+{
+    std::vector<bool> livePasses(m_Passes.size(), false);
+
+    // Imported resources are used outside of the graph, so everything written to them is a result
+    std::vector<bool> neededResources(m_Resources.size(), false);
+    for (size_t i = 0; i < m_Resources.size(); i++)
+    {
+        neededResources[i] = m_Resources[i].m_IsImported;
+    }
+
+    // Walk backwards, so the passes producing what a live pass uses are found after it
+    for (size_t passIndex = m_Passes.size(); passIndex > 0; passIndex--)
+    {
+        const Pass& pass = m_Passes[passIndex - 1];
+
+        bool isLive = pass.m_HasSideEffects;
+        for (const Access& access : pass.m_Accesses)
+        {
+            isLive = isLive || (access.m_IsWrite && neededResources[access.m_Resource]);
+        }
+
+        if (isLive)
+        {
+            livePasses[passIndex - 1] = true;
+            // Writes can depend on the earlier contents too, like blending or depth testing, so every resource the pass uses is needed
+            for (const Access& access : pass.m_Accesses)
+            {
+                neededResources[access.m_Resource] = true;
+            }
+        }
+    }
+
+    return livePasses;
+}
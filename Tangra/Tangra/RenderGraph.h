@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class GraphicsCommandList;
+
+// Describes a frame as a list of passes which declare the resources they read and write.
+// Compiling the graph culls the passes whose results are never used, assigns compute passes to the compute queue,
+// works out the barriers between the passes and groups the passes into queue submissions with the cross-queue waits between them.
+// The graph only depends on the standard library, so schedules can be built and checked without a GPU. RenderGraphExecutor records and submits them.
+class RenderGraph
+{
+public:
+    using ResourceHandle = uint32_t;
+    using ExecuteCallback = std::function<void(GraphicsCommandList&)>;
+
+    static const size_t s_InvalidIndex = static_cast<size_t>(-1);
+
+    // The way a pass uses a resource, which decides the state the resource needs to be in.
+    // The usages are flags, so a pass reading a resource in several ways can use it in all of those read-only usages at once.
+    enum class ResourceUsage : uint32_t
+    {
+        Common = 0,
+        RenderTarget = 1 << 0,
+        DepthWrite = 1 << 1,
+        DepthRead = 1 << 2,
+        PixelShaderResource = 1 << 3,
+        NonPixelShaderResource = 1 << 4,
+        UnorderedAccess = 1 << 5,
+        CopySource = 1 << 6,
+        CopyDest = 1 << 7,
+        VertexBuffer = 1 << 8,
+        IndexBuffer = 1 << 9,
+        Present = 1 << 10
+    };
+
+    enum class QueueType
+    {
+        Graphics,
+        Compute
+    };
+
+    // Graphics passes always run on the graphics queue, compute passes run on the compute queue if async compute is enabled
+    enum class PassType
+    {
+        Graphics,
+        Compute
+    };
+
+    // A transition from one usage to another, or a UAV barrier if both usages are UnorderedAccess
+    struct Barrier
+    {
+        ResourceHandle m_Resource;
+        ResourceUsage m_Before;
+        ResourceUsage m_After;
+
+        bool IsUAVBarrier() const { return m_Before == ResourceUsage::UnorderedAccess && m_After == ResourceUsage::UnorderedAccess; }
+    };
+
+    // A pass with the barriers to record in front of it. Steps without a pass only record barriers,
+    // for transitions the compute queue can't do and for the final transitions of the imported resources.
+    struct Step
+    {
+        size_t m_Pass = s_InvalidIndex;
+        QueueType m_Queue = QueueType::Graphics;
+        std::vector<Barrier> m_Barriers;
+    };
+
+    // Steps which are submitted to a queue together. The queue waits for the listed earlier submissions of other queues first.
+    struct Submission
+    {
+        QueueType m_Queue = QueueType::Graphics;
+        std::vector<size_t> m_Steps;
+        std::vector<size_t> m_WaitForSubmissions;
+    };
+
+    // Steps between which a resource is used, for placing resources which are never used at the same time in the same memory
+    struct ResourceLifetime
+    {
+        size_t m_FirstStep = s_InvalidIndex;
+        size_t m_LastStep = s_InvalidIndex;
+        bool m_UsedOnCompute = false;
+
+        bool IsUsed() const { return m_FirstStep != s_InvalidIndex; }
+    };
+
+    struct Schedule
+    {
+        std::vector<Step> m_Steps;
+        // Ordered the way they need to be submitted in
+        std::vector<Submission> m_Submissions;
+        std::vector<size_t> m_CulledPasses;
+        // Indexed by resource handle
+        std::vector<ResourceLifetime> m_ResourceLifetimes;
+        size_t m_NumBarriers = 0;
+    };
+
+    // Used to declare the resources a pass uses. Declaring a resource more than once merges the declarations: read-only usages are combined,
+    // and declaring the same usage again only adds the write. Any other mix, like reading a resource the pass also writes, throws.
+    class PassBuilder
+    {
+    public:
+        PassBuilder& Read(ResourceHandle a_Resource, ResourceUsage a_Usage);
+        PassBuilder& Write(ResourceHandle a_Resource, ResourceUsage a_Usage);
+        // Keep the pass even if nothing uses its results, for passes which have effects outside of the graph
+        PassBuilder& SetSideEffects();
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& a_Graph, size_t a_Pass);
+
+        void AddAccess(ResourceHandle a_Resource, ResourceUsage a_Usage, bool a_IsWrite);
+
+        RenderGraph& m_Graph;
+        size_t m_Pass;
+    };
+
+    // Add a resource which lives outside of the graph, like the back buffer. Everything written to it is considered a result of the graph.
+    // The resource is transitioned to the final usage at the end of the graph, unless the final usage is the same as the initial usage and nothing changed it.
+    ResourceHandle ImportResource(const std::string& a_Name, ResourceUsage a_InitialUsage, ResourceUsage a_FinalUsage);
+    // Add a resource which only lives within the graph. Passes writing to it are culled if no pass reads it.
+    ResourceHandle CreateResource(const std::string& a_Name);
+
+    // Add a pass. Passes run in the order they are added in, and the callback is called when the pass is recorded.
+    PassBuilder AddPass(const std::string& a_Name, PassType a_Type, ExecuteCallback a_Execute);
+
+    void SetAsyncComputeEnabled(bool a_Enabled);
+
+    // Build the schedule for the passes and resources which have been added
+    Schedule Compile() const;
+
+    size_t GetNumPasses() const;
+    const std::string& GetPassName(size_t a_Pass) const;
+    // Record the pass into the command list
+    void ExecutePass(size_t a_Pass, GraphicsCommandList& a_CommandList) const;
+
+    size_t GetNumResources() const;
+    const std::string& GetResourceName(ResourceHandle a_Resource) const;
+    bool IsImported(ResourceHandle a_Resource) const;
+
+    // Returns true if the compute queue can transition resources to and from all the usages
+    static bool IsComputeCompatible(ResourceUsage a_Usage);
+    // Returns true if none of the usages modify the resource
+    static bool IsReadOnly(ResourceUsage a_Usage);
+private:
+
+    struct Access
+    {
+        ResourceHandle m_Resource;
+        ResourceUsage m_Usage;
+        bool m_IsWrite;
+    };
+
+    // Every resource appears at most once per pass
+    struct Pass
+    {
+        std::string m_Name;
+        PassType m_Type;
+        ExecuteCallback m_Execute;
+        std::vector<Access> m_Accesses;
+        bool m_HasSideEffects = false;
+    };
+
+    struct Resource
+    {
+        std::string m_Name;
+        bool m_IsImported;
+        ResourceUsage m_InitialUsage;
+        ResourceUsage m_FinalUsage;
+    };
+
+    // Returns for every pass whether it contributes to a result of the graph
+    std::vector<bool> FindLivePasses() const;
+
+    std::vector<Pass> m_Passes;
+    std::vector<Resource> m_Resources;
+
+    bool m_AsyncComputeEnabled = true;
+};
@@ -0,0 +1,329 @@
+#include "RenderGraphExecutor.h"
+#include "CommandQueue.h"
+#include "Device.h"
+#include "GraphicsCommandList.h"
+#include "ParallelCommandRecorder.h"
+#include "RenderResource.h"
+#include "ServiceLocator.h"
+
+#include <stdexcept>
+
+RenderGraphExecutor::RenderGraphExecutor(ServiceLocator& a_ServiceLocator)
+    : m_Services(a_ServiceLocator)
+{
+    m_GraphicsRecorder = std::make_unique<ParallelCommandRecorder>(m_Services, *m_Services.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT));
+    m_ComputeRecorder = std::make_unique<ParallelCommandRecorder>(m_Services, *m_Services.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE));
+    m_TransientPool = std::make_unique<TransientResourcePool>(m_Services);
+}
+
+RenderGraphExecutor::~RenderGraphExecutor()
+{
+}
+
+void RenderGraphExecutor::BindResource(RenderGraph::ResourceHandle a_Resource, const RenderResource& a_RenderResource)
+{
+    if (m_BoundResources.size() <= a_Resource)
+    {
+        m_BoundResources.resize(a_Resource + 1, nullptr);
+    }
+    m_BoundResources[a_Resource] = &a_RenderResource;
+}
+
+void RenderGraphExecutor::SetTransientResourceDesc(RenderGraph::ResourceHandle a_Resource, const D3D12_RESOURCE_DESC& a_Desc, const D3D12_CLEAR_VALUE* a_ClearValue)
+{
+    TransientResourcePool::Request& request = m_TransientRequests[a_Resource];
+    request.m_Desc = a_Desc;
+    request.m_HasClearValue = a_ClearValue != nullptr;
+    if (a_ClearValue != nullptr)
+    {
+        request.m_ClearValue = *a_ClearValue;
+    }
+}
+
+uint64_t RenderGraphExecutor::Execute(const RenderGraph& a_Graph)
+{
+    m_LastSchedule = a_Graph.Compile();
+    const std::vector<RenderGraph::ResourceLifetime>& lifetimes = m_LastSchedule.m_ResourceLifetimes;
+
+    CommandQueue* directQueue = m_Services.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    CommandQueue* computeQueue = m_Services.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+    // Allocate the created resources which survived culling
+    std::vector<RenderGraph::ResourceHandle> transientResources;
+    std::vector<TransientResourcePool::Request> transientRequests;
+    for (size_t i = 0; i < a_Graph.GetNumResources(); i++)
+    {
+        RenderGraph::ResourceHandle handle = static_cast<RenderGraph::ResourceHandle>(i);
+        if (a_Graph.IsImported(handle) || !lifetimes[i].IsUsed())
+        {
+            continue;
+        }
+
+        auto request = m_TransientRequests.find(handle);
+        if (request == m_TransientRequests.end())
+        {
+            throw std::runtime_error("Render graph resource " + a_Graph.GetResourceName(handle) + " has no description");
+        }
+
+        TransientResourcePool::Request transientRequest = request->second;
+        transientRequest.m_FirstUse = lifetimes[i].m_FirstStep;
+        transientRequest.m_LastUse = lifetimes[i].m_LastStep;
+        // Compute steps run alongside the graphics steps, so the step order doesn't tell when their memory is free again
+        if (lifetimes[i].m_UsedOnCompute)
+        {
+            transientRequest.m_FirstUse = 0;
+            transientRequest.m_LastUse = m_LastSchedule.m_Steps.size();
+        }
+        transientResources.push_back(handle);
+        transientRequests.push_back(transientRequest);
+    }
+
+    // Aliasing barriers are recorded before the first use of the resource taking over the memory, ahead of its state fixups.
+    // The barriers handing the memory back to the first resources for the next frame are recorded after the last graphics pass.
+    // Created resources are targets which start out undefined every frame, so they are discarded at their first use.
+    std::vector<std::vector<std::pair<const RenderResource*, const RenderResource*>>> stepAliasingBarriers(m_LastSchedule.m_Steps.size());
+    std::vector<std::vector<const RenderResource*>> stepHandBackBarriers(m_LastSchedule.m_Steps.size());
+    std::vector<std::vector<const RenderResource*>> stepDiscards(m_LastSchedule.m_Steps.size());
+    TransientResourcePool::Allocation* transientAllocation = nullptr;
+    if (!transientRequests.empty())
+    {
+        transientAllocation = &m_TransientPool->Acquire(transientRequests);
+        const AliasingPlanner::Plan& plan = transientAllocation->m_Plan;
+
+        size_t lastGraphicsStep = 0;
+        bool hasComputeSteps = false;
+        for (size_t i = 0; i < m_LastSchedule.m_Steps.size(); i++)
+        {
+            if (m_LastSchedule.m_Steps[i].m_Queue == RenderGraph::QueueType::Graphics)
+            {
+                lastGraphicsStep = i;
+            }
+            else
+            {
+                hasComputeSteps = true;
+            }
+        }
+
+        std::vector<bool> isAliasedLater(transientRequests.size(), false);
+        for (const AliasingPlanner::Placement& placement : plan.m_Placements)
+        {
+            for (size_t aliased : placement.m_AliasedResources)
+            {
+                isAliasedLater[aliased] = true;
+            }
+        }
+
+        for (size_t i = 0; i < transientRequests.size(); i++)
+        {
+            const RenderResource& resource = transientAllocation->m_Resources[i];
+            BindResource(transientResources[i], resource);
+            stepDiscards[lifetimes[transientResources[i]].m_FirstStep].push_back(&resource);
+
+            // The memory switches over right before the resource's first use, the previous occupant is done with it by then
+            for (size_t aliased : plan.m_Placements[i].m_AliasedResources)
+            {
+                stepAliasingBarriers[lifetimes[transientResources[i]].m_FirstStep].push_back({ &transientAllocation->m_Resources[aliased], &resource });
+            }
+            // Hand the memory back to the resources which use it first, ready for the next frame
+            if (plan.m_Placements[i].m_AliasedResources.empty() && isAliasedLater[i])
+            {
+                stepHandBackBarriers[lastGraphicsStep].push_back(&resource);
+            }
+        }
+
+        // The compute queue could otherwise start on the memory while the previous frame still uses it on the direct queue
+        if (hasComputeSteps)
+        {
+            computeQueue->WaitForQueue(*directQueue, directQueue->GetLastSignaledFenceValue());
+        }
+    }
+
+    for (size_t i = 0; i < a_Graph.GetNumResources(); i++)
+    {
+        if (lifetimes[i].IsUsed() && (i >= m_BoundResources.size() || m_BoundResources[i] == nullptr))
+        {
+            throw std::runtime_error("Render graph resource " + a_Graph.GetResourceName(static_cast<RenderGraph::ResourceHandle>(i)) + " has not been bound");
+        }
+    }
+
+    std::vector<CommandQueue::SyncPoint> submissionSyncPoints(m_LastSchedule.m_Submissions.size());
+    std::vector<bool> isWaitedOn(m_LastSchedule.m_Submissions.size(), false);
+    uint64_t directFenceValue = directQueue->GetLastSignaledFenceValue();
+
+    for (size_t submissionIndex = 0; submissionIndex < m_LastSchedule.m_Submissions.size(); submissionIndex++)
+    {
+        const RenderGraph::Submission& submission = m_LastSchedule.m_Submissions[submissionIndex];
+        bool isGraphics = submission.m_Queue == RenderGraph::QueueType::Graphics;
+        CommandQueue* queue = isGraphics ? directQueue : computeQueue;
+        ParallelCommandRecorder& recorder = isGraphics ? *m_GraphicsRecorder : *m_ComputeRecorder;
+
+        // Steps without a pass only hold barriers, like the final transitions of the imported resources.
+        // They are recorded at the end of the previous step's list instead of in a list of their own.
+        std::vector<std::vector<size_t>> jobSteps;
+        for (size_t stepIndex : submission.m_Steps)
+        {
+            if (m_LastSchedule.m_Steps[stepIndex].m_Pass == RenderGraph::s_InvalidIndex && !jobSteps.empty())
+            {
+                jobSteps.back().push_back(stepIndex);
+            }
+            else
+            {
+                jobSteps.push_back({ stepIndex });
+            }
+        }
+
+        for (const std::vector<size_t>& steps : jobSteps)
+        {
+            recorder.AddJob([this, &a_Graph, &stepAliasingBarriers, &stepHandBackBarriers, &stepDiscards, steps](GraphicsCommandList& a_CommandList)
+            {
+                for (size_t stepIndex : steps)
+                {
+                    RecordStep(a_Graph, m_LastSchedule.m_Steps[stepIndex], stepAliasingBarriers[stepIndex], stepHandBackBarriers[stepIndex],
+                        stepDiscards[stepIndex], a_CommandList);
+                }
+            });
+        }
+
+        std::vector<CommandQueue::SyncPoint> dependencies;
+        for (size_t wait : submission.m_WaitForSubmissions)
+        {
+            dependencies.push_back(submissionSyncPoints[wait]);
+            isWaitedOn[wait] = true;
+        }
+
+        uint64_t fenceValue = queue->ExecuteCommandLists(recorder.Record(), dependencies);
+        submissionSyncPoints[submissionIndex] = queue->GetSyncPoint(fenceValue);
+        if (isGraphics)
+        {
+            directFenceValue = fenceValue;
+        }
+    }
+
+    // Compute work which no graphics submission waited for still needs to be covered by the returned fence value
+    bool needsComputeWait = false;
+    for (size_t i = 0; i < m_LastSchedule.m_Submissions.size(); i++)
+    {
+        if (m_LastSchedule.m_Submissions[i].m_Queue == RenderGraph::QueueType::Compute && !isWaitedOn[i])
+        {
+            directQueue->WaitForSyncPoint(submissionSyncPoints[i]);
+            needsComputeWait = true;
+        }
+    }
+    if (needsComputeWait)
+    {
+        directFenceValue = directQueue->Signal();
+    }
+
+    if (transientAllocation != nullptr)
+    {
+        m_TransientPool->Release(*transientAllocation, directFenceValue);
+    }
+
+    return directFenceValue;
+}
+
+void RenderGraphExecutor::RecordStep(const RenderGraph& a_Graph, const RenderGraph::Step& a_Step,
+    const std::vector<std::pair<const RenderResource*, const RenderResource*>>& a_AliasingBarriers, const std::vector<const RenderResource*>& a_HandBackBarriers,
+    const std::vector<const RenderResource*>& a_Discards, GraphicsCommandList& a_CommandList)
+{
+    // The barriers of the step are queued here and recorded as one batch before the first command of the pass.
+    // The memory has to belong to the resource before it can be transitioned or discarded.
+    for (const auto& aliasingBarrier : a_AliasingBarriers)
+    {
+        a_CommandList.AliasingBarrier(aliasingBarrier.first, *aliasingBarrier.second);
+    }
+    for (const RenderGraph::Barrier& barrier : a_Step.m_Barriers)
+    {
+        const RenderResource& resource = *m_BoundResources[barrier.m_Resource];
+        if (barrier.IsUAVBarrier())
+        {
+            a_CommandList.UAVBarrier(resource);
+        }
+        else
+        {
+            a_CommandList.TransitionResource(resource, GetD3D12State(barrier.m_After));
+        }
+    }
+
+    // Discarding needs the resource in the render target or depth write state, other first uses are left to the pass
+    for (const RenderResource* resource : a_Discards)
+    {
+        for (const RenderGraph::Barrier& barrier : a_Step.m_Barriers)
+        {
+            bool isTarget = barrier.m_After == RenderGraph::ResourceUsage::RenderTarget || barrier.m_After == RenderGraph::ResourceUsage::DepthWrite;
+            if (m_BoundResources[barrier.m_Resource] == resource && isTarget)
+            {
+                a_CommandList.DiscardResource(*resource);
+                break;
+            }
+        }
+    }
+
+    if (a_Step.m_Pass != RenderGraph::s_InvalidIndex)
+    {
+        a_Graph.ExecutePass(a_Step.m_Pass, a_CommandList);
+    }
+
+    // Recorded when the list is closed
+    for (const RenderResource* resource : a_HandBackBarriers)
+    {
+        a_CommandList.AliasingBarrier(nullptr, *resource);
+    }
+}
+
+const RenderGraph::Schedule& RenderGraphExecutor::GetLastSchedule() const
+{
+    return m_LastSchedule;
+}
+
+TransientResourcePool::Statistics RenderGraphExecutor::GetTransientPoolStatistics() const
+{
+    return m_TransientPool->GetStatistics();
+}
+
+D3D12_RESOURCE_STATES RenderGraphExecutor::GetD3D12State(RenderGraph::ResourceUsage a_Usage)
+{
+    // Combined read-only usages map to the combination of their states
+    uint32_t usage = static_cast<uint32_t>(a_Usage);
+    if ((usage & (usage - 1)) != 0)
+    {
+        D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+        for (uint32_t bit = 1; bit <= usage; bit <<= 1)
+        {
+            if ((usage & bit) != 0)
+            {
+                state |= GetD3D12State(static_cast<RenderGraph::ResourceUsage>(bit));
+            }
+        }
+        return state;
+    }
+
+    switch (a_Usage)
+    {
+    case RenderGraph::ResourceUsage::RenderTarget:
+        return D3D12_RESOURCE_STATE_RENDER_TARGET;
+    case RenderGraph::ResourceUsage::DepthWrite:
+        return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    case RenderGraph::ResourceUsage::DepthRead:
+        return D3D12_RESOURCE_STATE_DEPTH_READ;
+    case RenderGraph::ResourceUsage::PixelShaderResource:
+        return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    case RenderGraph::ResourceUsage::NonPixelShaderResource:
+        return D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    case RenderGraph::ResourceUsage::UnorderedAccess:
+        return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    case RenderGraph::ResourceUsage::CopySource:
+        return D3D12_RESOURCE_STATE_COPY_SOURCE;
+    case RenderGraph::ResourceUsage::CopyDest:
+        return D3D12_RESOURCE_STATE_COPY_DEST;
+    case RenderGraph::ResourceUsage::VertexBuffer:
+        return D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+    case RenderGraph::ResourceUsage::IndexBuffer:
+        return D3D12_RESOURCE_STATE_INDEX_BUFFER;
+    case RenderGraph::ResourceUsage::Present:
+        return D3D12_RESOURCE_STATE_PRESENT;
+    case RenderGraph::ResourceUsage::Common:
+    default:
+        return D3D12_RESOURCE_STATE_COMMON;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RenderGraph.h"
+#include "TransientResourcePool.h"
+
+class GraphicsCommandList;
+class ParallelCommandRecorder;
+class RenderResource;
+
+struct ServiceLocator;
+
+// Records and submits the schedule of a render graph. Every pass is recorded into its own command list on the thread pool, steps which only hold
+// barriers are recorded at the end of the list before them, and the lists of a submission are executed together after the cross-queue waits of the submission.
+// Resources created in the graph come from a transient resource pool, which lets the ones with separate lifetimes share memory.
+class RenderGraphExecutor
+{
+public:
+    RenderGraphExecutor(ServiceLocator& a_ServiceLocator);
+    ~RenderGraphExecutor();
+
+    // Bind the D3D12 resource the graph resource refers to. Needs to be done for every resource before executing the graph.
+    void BindResource(RenderGraph::ResourceHandle a_Resource, const RenderResource& a_RenderResource);
+    // Describe a resource created in the graph, so the executor can allocate it. Needs to be done for every created resource which isn't culled.
+    void SetTransientResourceDesc(RenderGraph::ResourceHandle a_Resource, const D3D12_RESOURCE_DESC& a_Desc, const D3D12_CLEAR_VALUE* a_ClearValue = nullptr);
+
+    // Compile, record and submit the graph. Returns a fence value of the direct queue which is reached once all the work of the graph is done.
+    uint64_t Execute(const RenderGraph& a_Graph);
+
+    // Returns the schedule of the last executed graph
+    const RenderGraph::Schedule& GetLastSchedule() const;
+    // Returns the statistics of the pool the created resources come from, including the memory saved by aliasing them
+    TransientResourcePool::Statistics GetTransientPoolStatistics() const;
+
+    // Returns the D3D12 state which matches the usage
+    static D3D12_RESOURCE_STATES GetD3D12State(RenderGraph::ResourceUsage a_Usage);
+private:
+    // Record the barriers of the step, then its pass, then the barriers handing aliased memory back for the next frame
+    void RecordStep(const RenderGraph& a_Graph, const RenderGraph::Step& a_Step,
+        const std::vector<std::pair<const RenderResource*, const RenderResource*>>& a_AliasingBarriers, const std::vector<const RenderResource*>& a_HandBackBarriers,
+        const std::vector<const RenderResource*>& a_Discards, GraphicsCommandList& a_CommandList);
+
+    ServiceLocator& m_Services;
+
+    std::unique_ptr<ParallelCommandRecorder> m_GraphicsRecorder;
+    std::unique_ptr<ParallelCommandRecorder> m_ComputeRecorder;
+
+    std::vector<const RenderResource*> m_BoundResources;
+
+    std::unique_ptr<TransientResourcePool> m_TransientPool;
+    // Descriptions of the created resources, the lifetimes are filled in from the schedule
+    std::unordered_map<RenderGraph::ResourceHandle, TransientResourcePool::Request> m_TransientRequests;
+
+    RenderGraph::Schedule m_LastSchedule;
+};
@@ -1,12 +1,45 @@
 #include "RenderResource.h"
+#include "DeferredReleaseQueue.h"
+#include "ResidencyManager.h"
 
 #include "DirectXTex.h"
 
+TrackedResourceState::~TrackedResourceState()
+{
+    if (m_ReleaseQueue && m_Resource)
+    {
+        m_ReleaseQueue->Release(m_Resource, m_LastUsedFenceValues);
+    }
+    if (m_ShaderVisibleAllocator)
+    {
+        m_ShaderVisibleAllocator->Free(m_ShaderVisibleDescriptors, m_LastUsedFenceValues);
+    }
+}
+
+RenderResource::RenderResource(Microsoft::WRL::ComPtr<ID3D12Resource> a_defaultBuffer, D3D12_RESOURCE_STATES a_InitialState)
+    : m_DefaultBuffer(a_defaultBuffer)
+    , m_TrackedState(std::make_shared<TrackedResourceState>())
+{
+    m_TrackedState->m_State = a_InitialState;
+    m_TrackedState->m_Resource = a_defaultBuffer;
+    m_TrackedState->m_ResidencyObject = ResidencyManager::GetResidencyObject(a_defaultBuffer.Get());
+}
+
 void RenderResource::SetName(std::wstring a_NewName)
 {
     m_DefaultBuffer->SetName(a_NewName.c_str());
 }
 
+Microsoft::WRL::ComPtr<ID3D12Resource> RenderResource::GetD3D12Resource() const
+{
+    return m_DefaultBuffer;
+}
+
+const std::shared_ptr<TrackedResourceState>& RenderResource::GetTrackedState() const
+{
+    return m_TrackedState;
+}
+
 RenderResource::~RenderResource()
 {
     
@@ -1,23 +1,58 @@
 #pragma once
 #include <d3d12.h>
 #include <wrl.h>
+#include <cstdint>
+#include <memory>
 #include <string>
+
+#include "DescriptorAllocator.h"
+
+class DeferredReleaseQueue;
 struct ServiceLocator;
 
-// Base class for all resource wrappers to give them common functionality such as naming
+// State of a resource at the end of all the command lists that have been executed so far.
+// Shared by all copies of a resource wrapper, and only accessed by the command queues while they hold ResourceStateTracker::LockGlobalStates.
+// When the last copy goes away the resource is handed to the deferred release queue, so it outlives the submissions which used it.
+// The command lists which use the resource hold on to the state until they are submitted, so that is also where its shader visible descriptors are freed.
+struct TrackedResourceState
+{
+    D3D12_RESOURCE_STATES m_State = D3D12_RESOURCE_STATE_COMMON;
+    // Residency manager object the memory of the resource belongs to, 0 if the memory isn't tracked
+    uint64_t m_ResidencyObject = 0;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_Resource;
+    // Fence value of the last submission which used the resource on every queue, indexed by CommandQueue::GetQueueIndex
+    uint64_t m_LastUsedFenceValues[3] = {};
+    // Set once the resource has been submitted, resources the GPU never used are released right away
+    DeferredReleaseQueue* m_ReleaseQueue = nullptr;
+
+    // Descriptors in the shader visible heap which shaders find the resource through, like its bindless SRV
+    DescriptorAllocation m_ShaderVisibleDescriptors;
+    DescriptorAllocator* m_ShaderVisibleAllocator = nullptr;
+
+    ~TrackedResourceState();
+};
+
+// Base class for all resource wrappers to give them common functionality such as naming and state tracking
 
 class RenderResource
 {
 public:
 
     RenderResource() = default;
-    RenderResource(Microsoft::WRL::ComPtr<ID3D12Resource> a_defaultBuffer) : m_DefaultBuffer(a_defaultBuffer) {}
+    // The initial state needs to match the state the resource was created in
+    RenderResource(Microsoft::WRL::ComPtr<ID3D12Resource> a_defaultBuffer, D3D12_RESOURCE_STATES a_InitialState = D3D12_RESOURCE_STATE_COMMON);
 
     void SetName(std::wstring a_NewName);
 
+    Microsoft::WRL::ComPtr<ID3D12Resource> GetD3D12Resource() const;
+    // Used by the command lists to find out which state the resource is in between command lists
+    const std::shared_ptr<TrackedResourceState>& GetTrackedState() const;
+
     ~RenderResource();
 protected:
 
     Microsoft::WRL::ComPtr<ID3D12Resource> m_DefaultBuffer;
+    std::shared_ptr<TrackedResourceState> m_TrackedState;
 };
 
@@ -0,0 +1,234 @@
+#include "ResidencyManager.h"
+#include "CommandQueue.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include <chrono>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    // Identifies the residency object in the private data of the resources
+    const GUID g_ResidencyObjectGUID = { 0x2b9e4d17, 0x8c63, 0x4f0a, { 0xb5, 0x7e, 0x19, 0xd2, 0x6a, 0x40, 0xc3, 0x8f } };
+
+    // The budget changes when other applications allocate memory, so it is checked regularly and not only after submissions
+    const std::chrono::milliseconds g_BudgetCheckInterval(100);
+}
+
+ResidencyManager::ResidencyManager(ServiceLocator& a_ServiceLocator)
+    : m_Policy(3)
+{
+    m_Device = a_ServiceLocator.m_Device->GetDeviceObject();
+    m_Device.As(&m_Device3);
+    ThrowIfFailed(a_ServiceLocator.m_Device->GetAdapter().As(&m_Adapter));
+
+    const D3D12_COMMAND_LIST_TYPE queueTypes[] = { D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_TYPE_COMPUTE, D3D12_COMMAND_LIST_TYPE_COPY };
+    for (D3D12_COMMAND_LIST_TYPE queueType : queueTypes)
+    {
+        m_QueueFences.push_back(a_ServiceLocator.m_Device->GetCommandQueue(queueType)->GetFenceObject());
+    }
+
+    ThrowIfFailed(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_ResidencyFence)));
+
+    m_Worker = std::thread(&ResidencyManager::WorkerLoop, this);
+}
+
+ResidencyManager::~ResidencyManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_ShuttingDown = true;
+    }
+    m_WorkerCondition.notify_all();
+    m_Worker.join();
+}
+
+ResidencyManager::ObjectId ResidencyManager::Track(ID3D12Pageable* a_Object, uint64_t a_Size)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ObjectId object = m_Policy.AddObject(a_Size);
+    m_Objects[object] = a_Object;
+    return object;
+}
+
+void ResidencyManager::Untrack(ObjectId a_Object)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    // The worker uses the object outside of the lock while it evicts it
+    m_EvictionCondition.wait(lock, [this, a_Object]() { return m_EvictingObjects.count(a_Object) == 0; });
+
+    m_Policy.RemoveObject(a_Object);
+    m_Objects.erase(a_Object);
+}
+
+ResidencyManager::WaitPoint ResidencyManager::MakeResident(const std::vector<ObjectId>& a_Objects, D3D12_COMMAND_LIST_TYPE a_QueueType)
+{
+    WaitPoint waitPoint;
+    std::vector<ID3D12Pageable*> pageables;
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+
+        // Making an object resident while it is being evicted would race with the eviction
+        m_EvictionCondition.wait(lock, [this, &a_Objects]()
+        {
+            for (ObjectId object : a_Objects)
+            {
+                if (m_EvictingObjects.count(object) != 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        });
+
+        size_t timeline = CommandQueue::GetQueueIndex(a_QueueType);
+        for (ObjectId object : a_Objects)
+        {
+            auto pageable = m_Objects.find(object);
+            if (pageable == m_Objects.end())
+            {
+                continue;
+            }
+
+            m_Policy.MarkUsed(object, timeline, ResidencyPolicy::s_PendingFenceValue);
+            if (!m_Policy.IsResident(object))
+            {
+                m_Policy.SetResident(object, true);
+                pageables.push_back(pageable->second);
+            }
+        }
+
+        if (pageables.empty())
+        {
+            return waitPoint;
+        }
+
+        m_Statistics.m_NumMakeResidents += pageables.size();
+
+        if (m_Device3)
+        {
+            waitPoint.m_Fence = m_ResidencyFence;
+            waitPoint.m_FenceValue = ++m_ResidencyFenceValue;
+            ThrowIfFailed(m_Device3->EnqueueMakeResident(D3D12_RESIDENCY_FLAG_NONE, static_cast<UINT>(pageables.size()), pageables.data(),
+                m_ResidencyFence.Get(), waitPoint.m_FenceValue));
+        }
+        else
+        {
+            ThrowIfFailed(m_Device->MakeResident(static_cast<UINT>(pageables.size()), pageables.data()));
+        }
+    }
+
+    // The usage went up, let the worker check whether something else needs to go
+    m_WorkerCondition.notify_one();
+    return waitPoint;
+}
+
+void ResidencyManager::MarkSubmitted(const std::vector<ObjectId>& a_Objects, D3D12_COMMAND_LIST_TYPE a_QueueType, uint64_t a_FenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    size_t timeline = CommandQueue::GetQueueIndex(a_QueueType);
+    for (ObjectId object : a_Objects)
+    {
+        if (m_Objects.count(object) != 0)
+        {
+            m_Policy.MarkUsed(object, timeline, a_FenceValue);
+        }
+    }
+}
+
+ResidencyManager::Statistics ResidencyManager::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Statistics statistics = m_Statistics;
+    statistics.m_NumObjects = m_Policy.GetNumObjects();
+    statistics.m_ResidentBytes = m_Policy.GetResidentSize();
+    return statistics;
+}
+
+void ResidencyManager::SetResidencyObject(ID3D12Resource* a_Resource, ObjectId a_Object)
+{
+    ThrowIfFailed(a_Resource->SetPrivateData(g_ResidencyObjectGUID, sizeof(ObjectId), &a_Object));
+}
+
+ResidencyManager::ObjectId ResidencyManager::GetResidencyObject(ID3D12Resource* a_Resource)
+{
+    ObjectId object = ResidencyPolicy::s_InvalidObject;
+    UINT dataSize = sizeof(ObjectId);
+    if (a_Resource == nullptr || FAILED(a_Resource->GetPrivateData(g_ResidencyObjectGUID, &dataSize, &object)))
+    {
+        return ResidencyPolicy::s_InvalidObject;
+    }
+    return object;
+}
+
+void ResidencyManager::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_ShuttingDown)
+    {
+        m_WorkerCondition.wait_for(lock, g_BudgetCheckInterval);
+        if (m_ShuttingDown)
+        {
+            break;
+        }
+
+        // The budget query and the fence reads don't need the lock
+        lock.unlock();
+        DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo = {};
+        HRESULT result = m_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo);
+        std::vector<uint64_t> completedFenceValues;
+        for (const ComPtr<ID3D12Fence1>& fence : m_QueueFences)
+        {
+            completedFenceValues.push_back(fence->GetCompletedValue());
+        }
+        lock.lock();
+
+        if (FAILED(result))
+        {
+            continue;
+        }
+        m_Statistics.m_Budget = memoryInfo.Budget;
+        m_Statistics.m_Usage = memoryInfo.CurrentUsage;
+
+        std::vector<ObjectId> evictions = m_Policy.SelectEvictions(memoryInfo.CurrentUsage, memoryInfo.Budget, completedFenceValues);
+        if (evictions.empty())
+        {
+            continue;
+        }
+
+        // Evict the whole batch with one call, outside of the lock so submissions which don't need these objects aren't held up.
+        // The objects can't be untracked and released until they are out of the evicting set again.
+        std::vector<ID3D12Pageable*> pageables;
+        for (ObjectId object : evictions)
+        {
+            pageables.push_back(m_Objects[object]);
+            m_EvictingObjects.insert(object);
+        }
+        m_Statistics.m_NumEvictions += evictions.size();
+
+        lock.unlock();
+        HRESULT evictResult = m_Device->Evict(static_cast<UINT>(pageables.size()), pageables.data());
+        lock.lock();
+
+        // The objects are still resident if the eviction failed, the next check can try again
+        if (FAILED(evictResult))
+        {
+            for (ObjectId object : evictions)
+            {
+                if (m_Objects.count(object) != 0)
+                {
+                    m_Policy.SetResident(object, true);
+                }
+            }
+        }
+
+        m_EvictingObjects.clear();
+        m_EvictionCondition.notify_all();
+    }
+}
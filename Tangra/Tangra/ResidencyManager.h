@@ -0,0 +1,99 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ResidencyPolicy.h"
+
+struct ServiceLocator;
+
+// Keeps the memory the engine allocates within the local video memory budget. Heaps and committed resources are tracked with the fence values
+// of the submissions that used them. A worker thread watches the budget and evicts the least recently used memory the GPU is done with in batches.
+// Submissions make evicted memory resident again without blocking, the queue waits on the residency fence before it executes the lists.
+class ResidencyManager
+{
+public:
+    using ObjectId = ResidencyPolicy::ObjectId;
+
+    // A fence value a queue needs to wait for before it can use the memory which was made resident
+    struct WaitPoint
+    {
+        Microsoft::WRL::ComPtr<ID3D12Fence> m_Fence;
+        uint64_t m_FenceValue = 0;
+
+        bool IsValid() const { return m_Fence != nullptr; }
+    };
+
+    struct Statistics
+    {
+        size_t m_NumObjects = 0;
+        uint64_t m_ResidentBytes = 0;
+        // Values reported by the adapter the last time the worker checked
+        uint64_t m_Budget = 0;
+        uint64_t m_Usage = 0;
+        uint64_t m_NumEvictions = 0;
+        uint64_t m_NumMakeResidents = 0;
+    };
+
+    // Needs to be created after the command queues
+    ResidencyManager(ServiceLocator& a_ServiceLocator);
+    // Stops the worker thread
+    ~ResidencyManager();
+
+    // Start tracking a heap or committed resource of the size. The manager doesn't hold a reference, so the object needs to be untracked before it is released.
+    ObjectId Track(ID3D12Pageable* a_Object, uint64_t a_Size);
+    // Stop tracking the object, waiting for it if it is being evicted right now
+    void Untrack(ObjectId a_Object);
+
+    // Make the objects resident for a submission to the queue of the type. Blocks only if one of them is being evicted right now.
+    // The objects can't be evicted until MarkSubmitted records the fence value of the submission.
+    WaitPoint MakeResident(const std::vector<ObjectId>& a_Objects, D3D12_COMMAND_LIST_TYPE a_QueueType);
+    // Record the fence value of the submission the objects were made resident for
+    void MarkSubmitted(const std::vector<ObjectId>& a_Objects, D3D12_COMMAND_LIST_TYPE a_QueueType, uint64_t a_FenceValue);
+
+    Statistics GetStatistics();
+
+    // Store the object the memory of the resource belongs to in the resource, so command lists can find it from the resource
+    static void SetResidencyObject(ID3D12Resource* a_Resource, ObjectId a_Object);
+    // Returns the object the memory of the resource belongs to, or ResidencyPolicy::s_InvalidObject if it isn't tracked
+    static ObjectId GetResidencyObject(ID3D12Resource* a_Resource);
+private:
+
+    // Check the budget and evict what the policy selects, until the manager is destroyed
+    void WorkerLoop();
+
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    // Only available from Windows 10 1709, MakeResident blocks without it
+    Microsoft::WRL::ComPtr<ID3D12Device3> m_Device3;
+    Microsoft::WRL::ComPtr<IDXGIAdapter3> m_Adapter;
+
+    // Fences of the direct, compute and copy queue, indexed by CommandQueue::GetQueueIndex
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Fence1>> m_QueueFences;
+
+    // Signalled by EnqueueMakeResident
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_ResidencyFence;
+    uint64_t m_ResidencyFenceValue = 0;
+
+    std::mutex m_Mutex;
+    // Wakes up the worker, and the submissions waiting for an eviction to finish
+    std::condition_variable m_WorkerCondition;
+    std::condition_variable m_EvictionCondition;
+
+    ResidencyPolicy m_Policy;
+    std::unordered_map<ObjectId, ID3D12Pageable*> m_Objects;
+    // Objects the worker is evicting right now
+    std::unordered_set<ObjectId> m_EvictingObjects;
+
+    Statistics m_Statistics;
+
+    bool m_ShuttingDown = false;
+    std::thread m_Worker;
+};
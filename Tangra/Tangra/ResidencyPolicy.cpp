@@ -0,0 +1,129 @@
+#include "ResidencyPolicy.h"
+
+#include <algorithm>
+
+const ResidencyPolicy::ObjectId ResidencyPolicy::s_InvalidObject;
+const uint64_t ResidencyPolicy::s_PendingFenceValue;
+
+ResidencyPolicy::ResidencyPolicy(size_t a_NumTimelines)
+    : m_NumTimelines(a_NumTimelines)
+{
+}
+
+ResidencyPolicy::ObjectId ResidencyPolicy::AddObject(uint64_t a_Size)
+{
+    Object object;
+    object.m_Size = a_Size;
+    object.m_IsResident = true;
+    object.m_LastUse = m_UseCounter++;
+    object.m_LastUsedFenceValues.resize(m_NumTimelines, 0);
+
+    ObjectId id = m_NextObject++;
+    m_Objects[id] = object;
+    m_ResidentSize += a_Size;
+    return id;
+}
+
+void ResidencyPolicy::RemoveObject(ObjectId a_Object)
+{
+    auto object = m_Objects.find(a_Object);
+    if (object == m_Objects.end())
+    {
+        return;
+    }
+
+    if (object->second.m_IsResident)
+    {
+        m_ResidentSize -= object->second.m_Size;
+    }
+    m_Objects.erase(object);
+}
+
+void ResidencyPolicy::MarkUsed(ObjectId a_Object, size_t a_Timeline, uint64_t a_FenceValue)
+{
+    Object& object = m_Objects.at(a_Object);
+    object.m_LastUse = m_UseCounter++;
+    object.m_LastUsedFenceValues[a_Timeline] = a_FenceValue;
+}
+
+bool ResidencyPolicy::IsResident(ObjectId a_Object) const
+{
+    return m_Objects.at(a_Object).m_IsResident;
+}
+
+void ResidencyPolicy::SetResident(ObjectId a_Object, bool a_IsResident)
+{
+    Object& object = m_Objects.at(a_Object);
+    if (object.m_IsResident != a_IsResident)
+    {
+        object.m_IsResident = a_IsResident;
+        if (a_IsResident)
+        {
+            m_ResidentSize += object.m_Size;
+        }
+        else
+        {
+            m_ResidentSize -= object.m_Size;
+        }
+    }
+}
+
+std::vector<ResidencyPolicy::ObjectId> ResidencyPolicy::SelectEvictions(uint64_t a_Usage, uint64_t a_Budget, const std::vector<uint64_t>& a_CompletedFenceValues)
+{
+    std::vector<ObjectId> evictions;
+    if (a_Usage <= a_Budget)
+    {
+        return evictions;
+    }
+
+    std::vector<std::pair<uint64_t, ObjectId>> candidates;
+    for (const auto& object : m_Objects)
+    {
+        if (!object.second.m_IsResident)
+        {
+            continue;
+        }
+
+        bool isIdle = true;
+        for (size_t timeline = 0; timeline < m_NumTimelines && isIdle; timeline++)
+        {
+            isIdle = object.second.m_LastUsedFenceValues[timeline] <= a_CompletedFenceValues[timeline];
+        }
+        if (isIdle)
+        {
+            candidates.push_back({ object.second.m_LastUse, object.first });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    uint64_t usage = a_Usage;
+    for (const auto& candidate : candidates)
+    {
+        if (usage <= a_Budget)
+        {
+            break;
+        }
+
+        Object& object = m_Objects[candidate.second];
+        usage -= std::min(usage, object.m_Size);
+        SetResident(candidate.second, false);
+        evictions.push_back(candidate.second);
+    }
+
+    return evictions;
+}
+
+uint64_t ResidencyPolicy::GetSize(ObjectId a_Object) const
+{
+    return m_Objects.at(a_Object).m_Size;
+}
+
+uint64_t ResidencyPolicy::GetResidentSize() const
+{
+    return m_ResidentSize;
+}
+
+size_t ResidencyPolicy::GetNumObjects() const
+{
+    return m_Objects.size();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Decides which objects to evict when the memory usage is over budget, least recently used first.
+// Uses are recorded with fence values on one or more timelines, like the fences of the command queues, and an object is only evicted
+// once the GPU has reached all of them. Doesn't depend on D3D12, so it can be run against a simulated budget. Not thread-safe.
+class ResidencyPolicy
+{
+public:
+    using ObjectId = uint64_t;
+
+    static const ObjectId s_InvalidObject = 0;
+    // Fence value for a use which hasn't been submitted yet, the object can't be evicted until the actual value is recorded
+    static const uint64_t s_PendingFenceValue = UINT64_MAX;
+
+    ResidencyPolicy(size_t a_NumTimelines);
+
+    // Start tracking an object, which starts out resident
+    ObjectId AddObject(uint64_t a_Size);
+    void RemoveObject(ObjectId a_Object);
+
+    // Record a use of the object on the timeline. It replaces the earlier fence value of the timeline, so a pending use can be completed.
+    void MarkUsed(ObjectId a_Object, size_t a_Timeline, uint64_t a_FenceValue);
+
+    bool IsResident(ObjectId a_Object) const;
+    void SetResident(ObjectId a_Object, bool a_IsResident);
+
+    // Returns the objects to evict to get the usage within the budget, least recently used first, and marks them as evicted.
+    // Only objects whose uses have all been completed are evicted, so the usage can stay over budget.
+    std::vector<ObjectId> SelectEvictions(uint64_t a_Usage, uint64_t a_Budget, const std::vector<uint64_t>& a_CompletedFenceValues);
+
+    uint64_t GetSize(ObjectId a_Object) const;
+    uint64_t GetResidentSize() const;
+    size_t GetNumObjects() const;
+private:
+
+    struct Object
+    {
+        uint64_t m_Size;
+        bool m_IsResident;
+        // Position in the order of uses, higher is more recent
+        uint64_t m_LastUse;
+        std::vector<uint64_t> m_LastUsedFenceValues;
+    };
+
+    size_t m_NumTimelines;
+    ObjectId m_NextObject = 1;
+    uint64_t m_UseCounter = 0;
+    uint64_t m_ResidentSize = 0;
+
+    std::unordered_map<ObjectId, Object> m_Objects;
+};
@@ -0,0 +1,201 @@
+#include "ResourceStateTracker.h"
+
+#include "d3dx12.h"
+
+std::mutex ResourceStateTracker::s_GlobalStateMutex;
+
+void ResourceStateTracker::TransitionResource(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter)
+{
+    const std::shared_ptr<TrackedResourceState>& globalState = a_Resource.GetTrackedState();
+    if (!globalState)
+    {
+        return;
+    }
+
+    ID3D12Resource* resource = a_Resource.GetD3D12Resource().Get();
+
+    // A transition which is still in progress needs to finish before the resource can move on
+    if (m_BegunTransitions.count(resource) != 0)
+    {
+        EndBegunTransition(resource);
+    }
+
+    // The first time the list uses the resource, the state it will be in is not known yet
+    auto finalState = m_FinalStates.find(resource);
+    if (finalState == m_FinalStates.end())
+    {
+        m_PendingTransitions.push_back({ globalState, resource, a_StateAfter });
+        m_FinalStates[resource] = { globalState, a_StateAfter };
+        return;
+    }
+
+    D3D12_RESOURCE_STATES stateBefore = finalState->second.m_State;
+    if (stateBefore == a_StateAfter)
+    {
+        return;
+    }
+    finalState->second.m_State = a_StateAfter;
+
+    // No command has used the state of a transition which is still queued, so it can be merged with this one
+    for (size_t i = m_QueuedBarriers.size(); i > 0; i--)
+    {
+        D3D12_RESOURCE_BARRIER& barrier = m_QueuedBarriers[i - 1];
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && barrier.Transition.pResource == resource)
+        {
+            // Halves of split transitions need to stay matched
+            if (barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE)
+            {
+                break;
+            }
+
+            if (barrier.Transition.StateBefore == a_StateAfter)
+            {
+                m_QueuedBarriers.erase(m_QueuedBarriers.begin() + (i - 1));
+            }
+            else
+            {
+                barrier.Transition.StateAfter = a_StateAfter;
+            }
+            return;
+        }
+
+        // Don't reorder a transition across other barriers on the same resource
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && (barrier.UAV.pResource == resource || barrier.UAV.pResource == nullptr))
+        {
+            break;
+        }
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING)
+        {
+            break;
+        }
+    }
+
+    m_QueuedBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, stateBefore, a_StateAfter));
+}
+
+void ResourceStateTracker::BeginTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter)
+{
+    ID3D12Resource* resource = a_Resource.GetD3D12Resource().Get();
+
+    auto finalState = m_FinalStates.find(resource);
+    if (finalState == m_FinalStates.end() || m_BegunTransitions.count(resource) != 0 || finalState->second.m_State == a_StateAfter)
+    {
+        return;
+    }
+
+    m_QueuedBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, finalState->second.m_State, a_StateAfter,
+        D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+    m_BegunTransitions[resource] = a_StateAfter;
+}
+
+void ResourceStateTracker::EndTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter)
+{
+    ID3D12Resource* resource = a_Resource.GetD3D12Resource().Get();
+
+    auto begunTransition = m_BegunTransitions.find(resource);
+    if (begunTransition != m_BegunTransitions.end() && begunTransition->second == a_StateAfter)
+    {
+        EndBegunTransition(resource);
+        return;
+    }
+
+    // Either nothing was begun or it was begun towards another state, which TransitionResource ends first
+    TransitionResource(a_Resource, a_StateAfter);
+}
+
+void ResourceStateTracker::EndAllTransitions()
+{
+    while (!m_BegunTransitions.empty())
+    {
+        EndBegunTransition(m_BegunTransitions.begin()->first);
+    }
+}
+
+void ResourceStateTracker::EndBegunTransition(ID3D12Resource* a_Resource)
+{
+    D3D12_RESOURCE_STATES stateAfter = m_BegunTransitions[a_Resource];
+    m_BegunTransitions.erase(a_Resource);
+
+    FinalState& finalState = m_FinalStates[a_Resource];
+    m_QueuedBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(a_Resource, finalState.m_State, stateAfter,
+        D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+    finalState.m_State = stateAfter;
+}
+
+void ResourceStateTracker::UAVBarrier(const RenderResource& a_Resource)
+{
+    m_QueuedBarriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(a_Resource.GetD3D12Resource().Get()));
+}
+
+void ResourceStateTracker::ResourceBarrier(const D3D12_RESOURCE_BARRIER& a_Barrier)
+{
+    m_QueuedBarriers.push_back(a_Barrier);
+}
+
+UINT ResourceStateTracker::FlushResourceBarriers(ID3D12GraphicsCommandList* a_CommandList)
+{
+    UINT numBarriers = static_cast<UINT>(m_QueuedBarriers.size());
+    if (numBarriers > 0)
+    {
+        a_CommandList->ResourceBarrier(numBarriers, &m_QueuedBarriers[0]);
+        m_QueuedBarriers.clear();
+    }
+    return numBarriers;
+}
+
+std::vector<D3D12_RESOURCE_BARRIER> ResourceStateTracker::ResolvePendingTransitions()
+{
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    for (const PendingTransition& transition : m_PendingTransitions)
+    {
+        D3D12_RESOURCE_STATES stateBefore = transition.m_GlobalState->m_State;
+        if (stateBefore != transition.m_StateAfter)
+        {
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(transition.m_Resource, stateBefore, transition.m_StateAfter));
+        }
+    }
+    m_PendingTransitions.clear();
+
+    return barriers;
+}
+
+void ResourceStateTracker::CommitFinalStates()
+{
+    for (auto& finalState : m_FinalStates)
+    {
+        finalState.second.m_GlobalState->m_State = finalState.second.m_State;
+    }
+    m_FinalStates.clear();
+}
+
+void ResourceStateTracker::GetUsedResources(std::vector<std::shared_ptr<TrackedResourceState>>& a_Resources) const
+{
+    // Every resource the list uses is transitioned at least once, so it has a final state
+    for (const auto& finalState : m_FinalStates)
+    {
+        a_Resources.push_back(finalState.second.m_GlobalState);
+    }
+}
+
+bool ResourceStateTracker::HasPendingTransitions() const
+{
+    return !m_PendingTransitions.empty();
+}
+
+bool ResourceStateTracker::HasTrackedResources() const
+{
+    return !m_PendingTransitions.empty() || !m_FinalStates.empty();
+}
+
+void ResourceStateTracker::Reset()
+{
+    m_QueuedBarriers.clear();
+    m_PendingTransitions.clear();
+    m_FinalStates.clear();
+    m_BegunTransitions.clear();
+}
+
+std::unique_lock<std::mutex> ResourceStateTracker::LockGlobalStates()
+{
+    return std::unique_lock<std::mutex>(s_GlobalStateMutex);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "RenderResource.h"
+
+// Tracks the states of the resources used by a single command list and batches the barriers between them.
+// The state a resource is in when the list starts executing is only known at submission time, so the first transition of every resource
+// is kept as a pending transition. The command queue resolves those against the global states right before executing the list.
+class ResourceStateTracker
+{
+public:
+
+    // Queue a transition of all the subresources of the resource. Transitions to the state the resource is already in are skipped.
+    void TransitionResource(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter);
+    // Queue the first half of a split transition. The resource can't be used until the transition has been ended.
+    // If the state of the resource isn't known in this list yet, nothing is queued and EndTransition queues a regular transition instead.
+    void BeginTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter);
+    // Queue the second half of a split transition, or a regular transition if no matching transition was begun
+    void EndTransition(const RenderResource& a_Resource, D3D12_RESOURCE_STATES a_StateAfter);
+    // Queue the second half of every split transition which was begun but not ended, split barriers can't cross command lists
+    void EndAllTransitions();
+    // Queue a UAV barrier for the resource
+    void UAVBarrier(const RenderResource& a_Resource);
+    // Queue a barrier which is not tracked, for resources which are not wrapped in a RenderResource
+    void ResourceBarrier(const D3D12_RESOURCE_BARRIER& a_Barrier);
+
+    // Record all the queued barriers with a single ResourceBarrier call. Returns the number of barriers recorded.
+    UINT FlushResourceBarriers(ID3D12GraphicsCommandList* a_CommandList);
+
+    // Returns the barriers needed to get the resources from their global states into the states the list expects them in.
+    // The caller needs to hold the global state lock.
+    std::vector<D3D12_RESOURCE_BARRIER> ResolvePendingTransitions();
+    // Write the states the resources are in at the end of the list to the global states. The caller needs to hold the global state lock.
+    void CommitFinalStates();
+    // Append the tracked states of all the resources used by the list. Needs to be called before the final states are committed.
+    void GetUsedResources(std::vector<std::shared_ptr<TrackedResourceState>>& a_Resources) const;
+    // Returns true if the list has transitions which need to be resolved against the global states
+    bool HasPendingTransitions() const;
+    // Returns true if the list uses resources whose global states need to be updated, lists that don't can be submitted without the global state lock
+    bool HasTrackedResources() const;
+
+    // Forget all the tracked states, for when the list is reset
+    void Reset();
+
+    // Lock that needs to be held while the global states are read or written, from resolving the pending transitions until the lists are executed
+    static std::unique_lock<std::mutex> LockGlobalStates();
+private:
+
+    struct PendingTransition
+    {
+        std::shared_ptr<TrackedResourceState> m_GlobalState;
+        ID3D12Resource* m_Resource;
+        D3D12_RESOURCE_STATES m_StateAfter;
+    };
+
+    struct FinalState
+    {
+        std::shared_ptr<TrackedResourceState> m_GlobalState;
+        D3D12_RESOURCE_STATES m_State;
+    };
+
+    // Barriers which have been queued but not recorded yet
+    std::vector<D3D12_RESOURCE_BARRIER> m_QueuedBarriers;
+    // First transition of every resource used by the list
+    std::vector<PendingTransition> m_PendingTransitions;
+    // State of every resource used by the list after its last transition
+    std::unordered_map<ID3D12Resource*, FinalState> m_FinalStates;
+    // Target states of the split transitions which have been begun but not ended yet
+    std::unordered_map<ID3D12Resource*, D3D12_RESOURCE_STATES> m_BegunTransitions;
+
+    // Queue the end half of a begun split transition and update the final state of the resource
+    void EndBegunTransition(ID3D12Resource* a_Resource);
+
+    static std::mutex s_GlobalStateMutex;
+};
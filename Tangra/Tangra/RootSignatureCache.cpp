@@ -0,0 +1,48 @@
+#include "RootSignatureCache.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ServiceLocator.h"
+
+#include <cstring>
+
+using namespace Microsoft::WRL;
+
+RootSignatureCache::RootSignatureCache(ServiceLocator& a_ServiceLocator)
+    : m_Services(a_ServiceLocator)
+{
+}
+
+ComPtr<ID3D12RootSignature> RootSignatureCache::GetRootSignature(ID3DBlob* a_SerializedRootSignature)
+{
+    const uint8_t* data = static_cast<const uint8_t*>(a_SerializedRootSignature->GetBufferPointer());
+    const size_t size = a_SerializedRootSignature->GetBufferSize();
+    // Serialized root signatures are small, so a simple byte-wise hash is fast enough
+    const uint64_t hash = HashBytes(data, size);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ++m_Statistics.m_NumRequests;
+
+    std::vector<Entry>& entries = m_RootSignatures[hash];
+    for (const Entry& entry : entries)
+    {
+        if (entry.m_Blob.size() == size && std::memcmp(entry.m_Blob.data(), data, size) == 0)
+        {
+            ++m_Statistics.m_NumHits;
+            return entry.m_RootSignature;
+        }
+    }
+
+    Entry entry;
+    entry.m_Blob.assign(data, data + size);
+    ThrowIfFailed(m_Services.m_Device->GetDeviceObject()->CreateRootSignature(0, data, size, IID_PPV_ARGS(&entry.m_RootSignature)));
+    entries.push_back(entry);
+    ++m_Statistics.m_NumRootSignatures;
+
+    return entry.m_RootSignature;
+}
+
+RootSignatureCache::Statistics RootSignatureCache::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct ServiceLocator;
+
+// Creates every distinct root signature once, keyed by a hash of its serialized blob.
+// Pipeline states with the same layout get the same root signature object, so command lists can skip setting it when switching between them
+// and the root arguments stay bound. Root signatures are kept until the cache is destroyed. Thread-safe.
+class RootSignatureCache
+{
+public:
+
+    struct Statistics
+    {
+        // Number of distinct root signatures created
+        size_t m_NumRootSignatures = 0;
+        uint64_t m_NumRequests = 0;
+        uint64_t m_NumHits = 0;
+    };
+
+    RootSignatureCache(ServiceLocator& a_ServiceLocator);
+
+    // Returns the root signature for the serialized blob, creating it if no identical blob was seen before
+    Microsoft::WRL::ComPtr<ID3D12RootSignature> GetRootSignature(ID3DBlob* a_SerializedRootSignature);
+
+    Statistics GetStatistics();
+private:
+
+    struct Entry
+    {
+        // The blob is compared on a hash match, so a collision can't hand out the wrong layout
+        std::vector<uint8_t> m_Blob;
+        Microsoft::WRL::ComPtr<ID3D12RootSignature> m_RootSignature;
+    };
+
+    ServiceLocator& m_Services;
+
+    std::mutex m_Mutex;
+    std::unordered_map<uint64_t, std::vector<Entry>> m_RootSignatures;
+
+    Statistics m_Statistics;
+};
@@ -2,8 +2,14 @@
 #include <memory>
 
 class Application;
+class DeferredReleaseQueue;
 class Device;
+class GpuMemoryAllocator;
+class ResidencyManager;
+class ShaderStore;
 class SwapChain;
+class ThreadPool;
+class UploadManager;
 
 /*
  * Service Locator struct to avoid using a singleton.
@@ -11,7 +17,16 @@ class SwapChain;
  */
 struct ServiceLocator
 {
-    std::unique_ptr<Application> m_App;
+    // Declared before everything which allocates memory, so it is destroyed after all of it has been untracked
+    std::unique_ptr<ResidencyManager> m_ResidencyManager;
+    // Declared before everything which owns resources, so it can still take the resources they release when they are destroyed
+    std::unique_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
     std::unique_ptr<Device>      m_Device;
+    std::unique_ptr<ShaderStore> m_ShaderStore;
     std::unique_ptr<SwapChain>   m_SwapChain;
+    std::unique_ptr<ThreadPool>  m_ThreadPool;
+    std::unique_ptr<UploadManager> m_UploadManager;
+    std::unique_ptr<GpuMemoryAllocator> m_MemoryAllocator;
+    // Declared last so it is destroyed first, the resources the application owns are released while all the services still exist
+    std::unique_ptr<Application> m_App;
 };
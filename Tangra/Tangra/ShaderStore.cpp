@@ -0,0 +1,266 @@
+#include "ShaderStore.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = std::experimental::filesystem;
+
+const uint32_t ShaderStore::s_ArchiveMagic;
+const uint32_t ShaderStore::s_ArchiveVersion;
+const uint64_t ShaderStore::s_DataAlignment;
+
+ShaderStore::ShaderStore(const std::wstring& a_ShaderDirectory, const std::wstring& a_ArchiveName)
+    : m_ShaderDirectory(a_ShaderDirectory)
+{
+    const std::wstring archivePath = (fs::path(a_ShaderDirectory) / a_ArchiveName).wstring();
+
+    // Without an archive every shader is mapped on its own, which still shares them between pipeline states
+    try
+    {
+        if (IsArchiveOutOfDate(a_ShaderDirectory, archivePath))
+        {
+            std::cout << "Packing compiled shaders into an archive" << std::endl;
+            WriteArchive(a_ShaderDirectory, archivePath);
+        }
+        MapArchive(archivePath);
+    }
+    catch (const std::exception& a_Exception)
+    {
+        std::cout << "WARNING: Shader archive unavailable, mapping shader files separately: " << a_Exception.what() << std::endl;
+        m_Archive = MappedFile();
+        m_ArchiveShaders.clear();
+    }
+}
+
+D3D12_SHADER_BYTECODE ShaderStore::GetShader(const std::wstring& a_Path)
+{
+    const std::wstring key = NormalizePath(a_Path);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ++m_Statistics.m_NumRequests;
+
+    auto archiveShader = m_ArchiveShaders.find(key);
+    if (archiveShader != m_ArchiveShaders.end())
+    {
+        ++m_Statistics.m_NumHits;
+        return archiveShader->second;
+    }
+
+    auto mappedFile = m_MappedFiles.find(key);
+    if (mappedFile == m_MappedFiles.end())
+    {
+        // Shaders compiled after the archive was written, or outside the shader directory
+        auto file = std::make_unique<MappedFile>(a_Path);
+        m_Statistics.m_MappedBytes += file->GetSize();
+        mappedFile = m_MappedFiles.emplace(key, std::move(file)).first;
+        m_Statistics.m_NumMappedFiles = m_MappedFiles.size();
+    }
+    else
+    {
+        ++m_Statistics.m_NumHits;
+    }
+
+    D3D12_SHADER_BYTECODE bytecode;
+    bytecode.pShaderBytecode = mappedFile->second->GetData();
+    bytecode.BytecodeLength = mappedFile->second->GetSize();
+    return bytecode;
+}
+
+void ShaderStore::WriteArchive(const std::wstring& a_ShaderDirectory, const std::wstring& a_ArchivePath)
+{
+    std::vector<fs::path> shaderPaths;
+    for (const auto& entry : fs::directory_iterator(a_ShaderDirectory))
+    {
+        if (fs::is_regular_file(entry.path()) && entry.path().extension() == L".cso")
+        {
+            shaderPaths.push_back(entry.path());
+        }
+    }
+
+    // Lay out the header, the entry table and the names first, the bytecode follows aligned
+    ArchiveHeader header = {};
+    header.m_Magic = s_ArchiveMagic;
+    header.m_Version = s_ArchiveVersion;
+    header.m_NumEntries = static_cast<uint32_t>(shaderPaths.size());
+
+    std::vector<ArchiveEntry> entries(shaderPaths.size());
+    std::vector<std::wstring> names(shaderPaths.size());
+    uint64_t offset = sizeof(ArchiveHeader) + sizeof(ArchiveEntry) * entries.size();
+    for (size_t i = 0; i < shaderPaths.size(); i++)
+    {
+        names[i] = shaderPaths[i].filename().wstring();
+        entries[i].m_NameOffset = offset;
+        entries[i].m_NameLength = names[i].size();
+        offset += names[i].size() * sizeof(wchar_t);
+    }
+    for (size_t i = 0; i < shaderPaths.size(); i++)
+    {
+        offset = (offset + s_DataAlignment - 1) & ~(s_DataAlignment - 1);
+        entries[i].m_DataOffset = offset;
+        entries[i].m_DataSize = fs::file_size(shaderPaths[i]);
+        offset += entries[i].m_DataSize;
+    }
+
+    // Written to a temporary file first, so a failed write never leaves a broken archive behind
+    const std::wstring temporaryPath = a_ArchivePath + L".tmp";
+    {
+        std::ofstream archive(temporaryPath, std::ios::binary | std::ios::trunc);
+        archive.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        archive.write(reinterpret_cast<const char*>(entries.data()), sizeof(ArchiveEntry) * entries.size());
+        for (const std::wstring& name : names)
+        {
+            archive.write(reinterpret_cast<const char*>(name.data()), name.size() * sizeof(wchar_t));
+        }
+
+        std::vector<char> bytecode;
+        for (size_t i = 0; i < shaderPaths.size(); i++)
+        {
+            const std::streamoff padding = static_cast<std::streamoff>(entries[i].m_DataOffset) - static_cast<std::streamoff>(archive.tellp());
+            for (std::streamoff j = 0; j < padding; j++)
+            {
+                archive.put(0);
+            }
+
+            std::ifstream shader(shaderPaths[i], std::ios::binary);
+            bytecode.resize(static_cast<size_t>(entries[i].m_DataSize));
+            shader.read(bytecode.data(), bytecode.size());
+            if (!shader)
+            {
+                throw std::runtime_error("Could not read " + shaderPaths[i].string());
+            }
+            archive.write(bytecode.data(), bytecode.size());
+        }
+
+        if (!archive)
+        {
+            throw std::runtime_error("Could not write the shader archive");
+        }
+    }
+
+    fs::remove(a_ArchivePath);
+    fs::rename(temporaryPath, a_ArchivePath);
+}
+
+ShaderStore::Statistics ShaderStore::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
+
+bool ShaderStore::IsArchiveOutOfDate(const std::wstring& a_ShaderDirectory, const std::wstring& a_ArchivePath)
+{
+    if (!fs::exists(a_ArchivePath))
+    {
+        return true;
+    }
+
+    // Only the table of the archive is read, the bytecode pages are never touched
+    std::unordered_map<std::wstring, uint64_t> archiveSizes;
+    try
+    {
+        MappedFile archive(a_ArchivePath);
+        for (const auto& entry : ReadArchiveEntries(archive.GetData(), archive.GetSize()))
+        {
+            archiveSizes[NormalizePath(entry.first)] = entry.second.m_DataSize;
+        }
+    }
+    catch (const std::exception&)
+    {
+        return true;
+    }
+
+    // Only the directory listing is read, none of the shader files are opened.
+    // A shader which was added, removed or rebuilt to a different size changes the set of files even if the timestamps don't give it away.
+    const auto archiveTime = fs::last_write_time(a_ArchivePath);
+    for (const auto& entry : fs::directory_iterator(a_ShaderDirectory))
+    {
+        if (!fs::is_regular_file(entry.path()) || entry.path().extension() != L".cso")
+        {
+            continue;
+        }
+
+        auto archiveSize = archiveSizes.find(NormalizePath(entry.path().filename().wstring()));
+        if (archiveSize == archiveSizes.end() || archiveSize->second != fs::file_size(entry.path()) || fs::last_write_time(entry.path()) > archiveTime)
+        {
+            return true;
+        }
+        archiveSizes.erase(archiveSize);
+    }
+    return !archiveSizes.empty();
+}
+
+std::vector<std::pair<std::wstring, ShaderStore::ArchiveEntry>> ShaderStore::ReadArchiveEntries(const uint8_t* a_Data, uint64_t a_Size)
+{
+    if (a_Size < sizeof(ArchiveHeader))
+    {
+        throw std::runtime_error("Shader archive is truncated");
+    }
+    const ArchiveHeader* header = reinterpret_cast<const ArchiveHeader*>(a_Data);
+    if (header->m_Magic != s_ArchiveMagic || header->m_Version != s_ArchiveVersion ||
+        a_Size < sizeof(ArchiveHeader) + sizeof(ArchiveEntry) * static_cast<uint64_t>(header->m_NumEntries))
+    {
+        throw std::runtime_error("Shader archive has an unknown format");
+    }
+
+    std::vector<std::pair<std::wstring, ArchiveEntry>> entries;
+    entries.reserve(header->m_NumEntries);
+    const ArchiveEntry* table = reinterpret_cast<const ArchiveEntry*>(a_Data + sizeof(ArchiveHeader));
+    for (uint32_t i = 0; i < header->m_NumEntries; i++)
+    {
+        // The offsets and sizes come from the file, so they are compared against the space left instead of added up, which could overflow
+        const ArchiveEntry& entry = table[i];
+        if (entry.m_NameOffset > a_Size || entry.m_NameLength > (a_Size - entry.m_NameOffset) / sizeof(wchar_t) ||
+            entry.m_DataOffset > a_Size || entry.m_DataSize > a_Size - entry.m_DataOffset)
+        {
+            throw std::runtime_error("Shader archive entry points outside of the archive");
+        }
+
+        std::wstring name(reinterpret_cast<const wchar_t*>(a_Data + entry.m_NameOffset), static_cast<size_t>(entry.m_NameLength));
+        entries.emplace_back(std::move(name), entry);
+    }
+    return entries;
+}
+
+void ShaderStore::MapArchive(const std::wstring& a_ArchivePath)
+{
+    m_Archive = MappedFile(a_ArchivePath);
+    const uint8_t* data = m_Archive.GetData();
+    const uint64_t size = m_Archive.GetSize();
+
+    for (const auto& entry : ReadArchiveEntries(data, size))
+    {
+        D3D12_SHADER_BYTECODE bytecode;
+        bytecode.pShaderBytecode = data + entry.second.m_DataOffset;
+        bytecode.BytecodeLength = static_cast<SIZE_T>(entry.second.m_DataSize);
+        m_ArchiveShaders[NormalizePath(m_ShaderDirectory + L"/" + entry.first)] = bytecode;
+    }
+
+    m_Statistics.m_NumArchiveShaders = m_ArchiveShaders.size();
+    m_Statistics.m_MappedBytes += size;
+}
+
+std::wstring ShaderStore::NormalizePath(const std::wstring& a_Path)
+{
+    std::wstring normalized;
+    normalized.reserve(a_Path.size());
+    for (wchar_t character : a_Path)
+    {
+        character = character == L'\\' ? L'/' : static_cast<wchar_t>(std::towlower(character));
+        // Collapse repeated separators
+        if (character == L'/' && !normalized.empty() && normalized.back() == L'/')
+        {
+            continue;
+        }
+        normalized.push_back(character);
+    }
+
+    while (normalized.compare(0, 2, L"./") == 0)
+    {
+        normalized.erase(0, 2);
+    }
+    return normalized;
+}
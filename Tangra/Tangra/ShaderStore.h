@@ -0,0 +1,85 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Hands out zero-copy views of compiled shader bytecode. Every shader file is memory-mapped once and shared by all the pipeline states which use it.
+// The .cso files of the shader directory are packed into a single archive, so startup maps one file instead of opening every shader.
+// The archive is rebuilt when a .cso file is newer than it, or when .cso files were added, removed or changed size since it was written. Views stay valid for as long as the store exists. Thread-safe.
+class ShaderStore
+{
+public:
+
+    struct Statistics
+    {
+        // Number of shaders served from the archive, and of shader files mapped on their own
+        size_t m_NumArchiveShaders = 0;
+        size_t m_NumMappedFiles = 0;
+        uint64_t m_MappedBytes = 0;
+        uint64_t m_NumRequests = 0;
+        // Requests for shaders which were already mapped
+        uint64_t m_NumHits = 0;
+    };
+
+    // Maps the archive of the shader directory, packing the .cso files into it first if it is missing or out of date
+    ShaderStore(const std::wstring& a_ShaderDirectory = L"ShaderCSOs", const std::wstring& a_ArchiveName = L"Shaders.csopack");
+
+    // Returns the bytecode of the compiled shader at the path. Shaders in the shader directory come from the archive, other files are mapped on first use.
+    D3D12_SHADER_BYTECODE GetShader(const std::wstring& a_Path);
+
+    // Pack all the .cso files in the directory into an archive which the store can map
+    static void WriteArchive(const std::wstring& a_ShaderDirectory, const std::wstring& a_ArchivePath);
+
+    Statistics GetStatistics();
+private:
+
+    // The archive starts with a header and a table of entries, followed by the names and the bytecode
+    struct ArchiveHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint32_t m_NumEntries;
+        uint32_t m_Padding;
+    };
+
+    struct ArchiveEntry
+    {
+        // Offsets from the start of the archive, the name is the UTF-16 file name without a terminator
+        uint64_t m_NameOffset;
+        uint64_t m_NameLength;
+        uint64_t m_DataOffset;
+        uint64_t m_DataSize;
+    };
+
+    static const uint32_t s_ArchiveMagic = 0x4B505343; // "CSPK"
+    static const uint32_t s_ArchiveVersion = 1;
+    // Bytecode is aligned in the archive so the views have the same alignment as a separately mapped file would
+    static const uint64_t s_DataAlignment = 16;
+
+    // Returns true if the archive is missing, unreadable, or doesn't hold exactly the .cso files of the directory as they are now
+    static bool IsArchiveOutOfDate(const std::wstring& a_ShaderDirectory, const std::wstring& a_ArchivePath);
+    // Check the header and the entry table of a mapped archive and return the file name of every entry with it. Throws if anything points outside of the archive.
+    static std::vector<std::pair<std::wstring, ArchiveEntry>> ReadArchiveEntries(const uint8_t* a_Data, uint64_t a_Size);
+    void MapArchive(const std::wstring& a_ArchivePath);
+    // Lowercase path with forward slashes, so different spellings of a path find the same shader
+    static std::wstring NormalizePath(const std::wstring& a_Path);
+
+    std::wstring m_ShaderDirectory;
+
+    std::mutex m_Mutex;
+    MappedFile m_Archive;
+    // Shaders of the archive by normalized path
+    std::unordered_map<std::wstring, D3D12_SHADER_BYTECODE> m_ArchiveShaders;
+    // Shader files mapped on their own by normalized path
+    std::unordered_map<std::wstring, std::unique_ptr<MappedFile>> m_MappedFiles;
+
+    Statistics m_Statistics;
+};
@@ -0,0 +1,122 @@
+#include "SplitBarrierPlanner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const D3D12_RESOURCE_STATES g_WriteStates = D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+        D3D12_RESOURCE_STATE_DEPTH_WRITE | D3D12_RESOURCE_STATE_STREAM_OUT | D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_RESOLVE_DEST;
+
+    // Consecutive steps which use a resource in the same state
+    struct AccessGroup
+    {
+        D3D12_RESOURCE_STATES m_State;
+        size_t m_FirstStep;
+        size_t m_LastStep;
+    };
+}
+
+void SplitBarrierPlanner::AddAccess(size_t a_Step, size_t a_Resource, D3D12_RESOURCE_STATES a_State)
+{
+    m_Accesses.push_back({ a_Step, a_Resource, a_State });
+}
+
+void SplitBarrierPlanner::SetFinalState(size_t a_Resource, D3D12_RESOURCE_STATES a_State)
+{
+    m_FinalStates[a_Resource] = a_State;
+}
+
+std::vector<SplitBarrierPlanner::Transition> SplitBarrierPlanner::Plan(size_t a_NumSteps) const
+{
+    // Sort the accesses per resource in step order, keeping the order they were added in for accesses in the same step
+    std::vector<Access> accesses = m_Accesses;
+    std::stable_sort(accesses.begin(), accesses.end(), [](const Access& a_Left, const Access& a_Right)
+    {
+        return a_Left.m_Resource != a_Right.m_Resource ? a_Left.m_Resource < a_Right.m_Resource : a_Left.m_Step < a_Right.m_Step;
+    });
+
+    // Resources which only have a final state still need their transition
+    std::vector<size_t> resources;
+    for (const Access& access : accesses)
+    {
+        if (resources.empty() || resources.back() != access.m_Resource)
+        {
+            resources.push_back(access.m_Resource);
+        }
+    }
+    for (const auto& finalState : m_FinalStates)
+    {
+        if (!std::binary_search(resources.begin(), resources.end(), finalState.first))
+        {
+            resources.insert(std::upper_bound(resources.begin(), resources.end(), finalState.first), finalState.first);
+        }
+    }
+
+    std::vector<Transition> transitions;
+    auto nextAccess = accesses.begin();
+    for (size_t resource : resources)
+    {
+        std::vector<AccessGroup> groups;
+        for (; nextAccess != accesses.end() && nextAccess->m_Resource == resource; ++nextAccess)
+        {
+            if (!groups.empty())
+            {
+                AccessGroup& group = groups.back();
+                // Accesses in the same state are combined, and so are read-only accesses in a row.
+                // A write can't share its step with another state, there is no point between them to put the transition.
+                bool sameState = group.m_State == nextAccess->m_State;
+                bool combinedRead = IsReadOnlyState(group.m_State) && IsReadOnlyState(nextAccess->m_State);
+                if (group.m_LastStep == nextAccess->m_Step && !sameState && !combinedRead)
+                {
+                    throw std::runtime_error("A step writes a resource and uses it in another state at the same time");
+                }
+                if (sameState || combinedRead)
+                {
+                    group.m_State |= nextAccess->m_State;
+                    group.m_LastStep = nextAccess->m_Step;
+                    continue;
+                }
+            }
+            groups.push_back({ nextAccess->m_State, nextAccess->m_Step, nextAccess->m_Step });
+        }
+
+        auto finalState = m_FinalStates.find(resource);
+        if (finalState != m_FinalStates.end() && (groups.empty() || groups.back().m_State != finalState->second))
+        {
+            groups.push_back({ finalState->second, a_NumSteps, a_NumSteps });
+        }
+
+        // The state before the first group isn't known here, so its transition can start as early as the first step
+        size_t beginStep = 0;
+        for (const AccessGroup& group : groups)
+        {
+            Transition transition;
+            transition.m_Resource = resource;
+            transition.m_StateAfter = group.m_State;
+            transition.m_BeginStep = beginStep;
+            transition.m_EndStep = group.m_FirstStep;
+            transitions.push_back(transition);
+
+            beginStep = group.m_LastStep + 1;
+        }
+    }
+
+    std::stable_sort(transitions.begin(), transitions.end(), [](const Transition& a_Left, const Transition& a_Right)
+    {
+        return a_Left.m_EndStep < a_Right.m_EndStep;
+    });
+    return transitions;
+}
+
+void SplitBarrierPlanner::Clear()
+{
+    m_Accesses.clear();
+    m_FinalStates.clear();
+}
+
+bool SplitBarrierPlanner::IsReadOnlyState(D3D12_RESOURCE_STATES a_State)
+{
+    // The common state can't be combined with anything
+    return a_State != D3D12_RESOURCE_STATE_COMMON && (a_State & g_WriteStates) == 0;
+}
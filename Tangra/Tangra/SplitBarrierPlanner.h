@@ -0,0 +1,53 @@
+#pragma once
+
+#include <d3d12.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Decides where the halves of split barriers go, based on the points at which a sequence of recording steps reads and writes resources.
+// A transition begins right after the last step that uses the resource in its old state and ends right before the first step that
+// uses it in the new state, so the GPU can do the transition while it executes the steps in between.
+// The planner doesn't touch D3D12 itself, GraphicsCommandList::RecordWithSplitBarriers records the planned transitions.
+class SplitBarrierPlanner
+{
+public:
+
+    struct Transition
+    {
+        // Index the caller gave the resource
+        size_t m_Resource = 0;
+        D3D12_RESOURCE_STATES m_StateAfter = D3D12_RESOURCE_STATE_COMMON;
+        // The halves are recorded before the steps with these indices, an index equal to the number of steps means after the last step.
+        // When both are the same there is no work to hide the transition behind and a regular barrier is used.
+        size_t m_BeginStep = 0;
+        size_t m_EndStep = 0;
+
+        bool IsSplit() const { return m_BeginStep < m_EndStep; }
+    };
+
+    // Record that a step uses the resource in the specified state. Read-only states of accesses in a row are combined.
+    // Plan throws if a step uses a resource in a write state and in any other state.
+    void AddAccess(size_t a_Step, size_t a_Resource, D3D12_RESOURCE_STATES a_State);
+    // Set the state the resource needs to be in after the last step, like the present state for a back buffer
+    void SetFinalState(size_t a_Resource, D3D12_RESOURCE_STATES a_State);
+
+    // Plan the transitions for a sequence of steps, ordered by the point where they end
+    std::vector<Transition> Plan(size_t a_NumSteps) const;
+
+    void Clear();
+
+    // Returns true if the state only allows reading, so it can be combined with other read-only states
+    static bool IsReadOnlyState(D3D12_RESOURCE_STATES a_State);
+private:
+
+    struct Access
+    {
+        size_t m_Step;
+        size_t m_Resource;
+        D3D12_RESOURCE_STATES m_State;
+    };
+
+    std::vector<Access> m_Accesses;
+    std::unordered_map<size_t, D3D12_RESOURCE_STATES> m_FinalStates;
+};
@@ -3,6 +3,7 @@
 #include "Application.h"
 #include "CommandQueue.h"
 #include "Device.h"
+#include "GpuMemoryAllocator.h"
 #include "GraphicsCommandList.h"
 #include "ServiceLocator.h"
 
@@ -65,35 +66,22 @@ uint8_t SwapChain::GetBufferCount() const
 }
 
 
-void SwapChain::CreateDescriptorHeaps()
+SwapChain::~SwapChain()
 {
-    D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-
-    // fill out desc struct for RTV heap
-    rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    rtvHeapDesc.NodeMask = 0;
-    rtvHeapDesc.NumDescriptors = m_NumBackBuffers;
-    rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-
-    // fill out desc struct for DSV heap
-    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    dsvHeapDesc.NodeMask = 0;
-    dsvHeapDesc.NumDescriptors = 1;
-    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    m_Services.m_Device->GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_RTV).Free(m_RTVDescriptors);
+    m_Services.m_Device->GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV).Free(m_DSVDescriptor);
+}
 
-    auto d3d12Device = m_Services.m_Device->GetDeviceObject();
-    ThrowIfFailed(d3d12Device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_RTVDescriptorHeap)));
-    ThrowIfFailed(d3d12Device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_DSVDescriptorHeap)));
+void SwapChain::AllocateDescriptors()
+{
+    m_RTVDescriptors = m_Services.m_Device->GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_RTV).Allocate(m_NumBackBuffers);
+    m_DSVDescriptor = m_Services.m_Device->GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV).Allocate(1);
 }
 
 void SwapChain::CreateRenderTargets()
 {
     auto d3d12Device = m_Services.m_Device->GetDeviceObject();
 
-    // handle to the beginning of the RTV descriptor heap
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
     for (size_t i = 0; i < m_NumBackBuffers; i++)
     {
         // create a new resource interface and allocate one of the swap chain's buffers in it
@@ -104,11 +92,10 @@ void SwapChain::CreateRenderTargets()
         buffer->SetName((std::wstring(L"Render Target #") + std::to_wstring(i)).c_str());
 
         // create an RTV for the resource
-        d3d12Device->CreateRenderTargetView(buffer.Get(), nullptr, rtvHandle);
+        d3d12Device->CreateRenderTargetView(buffer.Get(), nullptr, m_RTVDescriptors.GetCPUHandle(static_cast<uint32_t>(i)));
 
-        // move the descriptor handle to the next descriptor in the heap
-        rtvHandle.Offset(1, m_Services.m_Device->GetDescriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV));
-        m_BackBuffers.push_back(buffer);
+        // The back buffers start out in the present state
+        m_BackBuffers.push_back(RenderResource(buffer, D3D12_RESOURCE_STATE_PRESENT));
     }
 
 }
@@ -137,15 +124,14 @@ void SwapChain::CreateDepthStencilBuffer(GraphicsCommandList& a_CommandList, DXG
     clearValue.DepthStencil.Depth = 1.0f;
     clearValue.DepthStencil.Stencil = 0;
 
-    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(device->GetDeviceObject()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE,
-        &dsvResourceDesc, D3D12_RESOURCE_STATE_COMMON, &clearValue, IID_PPV_ARGS(&m_DepthStencilBuffer)));
-    device->GetDeviceObject()->CreateDepthStencilView(m_DepthStencilBuffer.Get(), nullptr, GetDSVHandle());
+    ComPtr<ID3D12Resource> depthStencilBuffer = m_Services.m_MemoryAllocator->CreateResource(dsvResourceDesc, D3D12_HEAP_TYPE_DEFAULT,
+        D3D12_RESOURCE_STATE_COMMON, &clearValue);
+    device->GetDeviceObject()->CreateDepthStencilView(depthStencilBuffer.Get(), nullptr, GetDSVHandle());
 
-    m_DepthStencilBuffer->SetName(L"Depth Stencil Buffer");
+    m_DepthStencilBuffer = RenderResource(depthStencilBuffer, D3D12_RESOURCE_STATE_COMMON);
+    m_DepthStencilBuffer.SetName(L"Depth Stencil Buffer");
 
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_DepthStencilBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE);
-    a_CommandList.ResourceBarrier(barrier);
+    a_CommandList.TransitionResource(m_DepthStencilBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 }
 
 void SwapChain::SetClearColor(DirectX::SimpleMath::Color a_NewClearColor)
@@ -155,35 +141,28 @@ void SwapChain::SetClearColor(DirectX::SimpleMath::Color a_NewClearColor)
 
 void SwapChain::ClearBackBuffer(GraphicsCommandList& a_CommandList)
 {
-    auto currentBackBuffer = GetCurrentBackbufferResource();
     auto currentRTV = GetCurrentRTVHandle();
 
-
     // The render target resource needs to be transitioned to render target state before it can be cleared
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(currentBackBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    a_CommandList.ResourceBarrier(barrier);
+    a_CommandList.TransitionResource(m_BackBuffers[m_CurrentBackBuffer], D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-    a_CommandList.GetCommandListPtr()->ClearRenderTargetView(currentRTV, m_ClearColor, 0, nullptr);
+    a_CommandList.ClearRenderTargetView(currentRTV, m_ClearColor);
 }
 
 void SwapChain::ClearDSV(GraphicsCommandList& a_CommandList)
 {
-    a_CommandList.GetCommandListPtr()->ClearDepthStencilView(GetDSVHandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    a_CommandList.TransitionResource(m_DepthStencilBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    a_CommandList.ClearDepthStencilView(GetDSVHandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0);
 }
 
-void SwapChain::Present()
+void SwapChain::PrepareForPresent(GraphicsCommandList& a_CommandList)
 {
-    auto currentBackBuffer = GetCurrentBackbufferResource();
-
-    auto cmdList = m_CommandQueue->GetCommandList();
-
     // The current back buffer needs to be transitioned into common/present state to be used displayed
-    auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(currentBackBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-
-    cmdList->ResourceBarrier(barrier);
-
-    m_CommandQueue->ExecuteCommandList(*cmdList);
+    a_CommandList.TransitionResource(m_BackBuffers[m_CurrentBackBuffer], D3D12_RESOURCE_STATE_PRESENT);
+}
 
+void SwapChain::Present()
+{
     ThrowIfFailed(m_DXGISwapChain->Present(1, 0));
 
     m_CurrentBackBuffer = (m_CurrentBackBuffer + 1) % m_NumBackBuffers;
@@ -192,18 +171,27 @@ void SwapChain::Present()
 
 D3D12_CPU_DESCRIPTOR_HANDLE SwapChain::GetCurrentRTVHandle()
 {
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), m_CurrentBackBuffer,
-        m_Services.m_Device->GetDescriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV));
+    return m_RTVDescriptors.GetCPUHandle(m_CurrentBackBuffer);
 }
 
 Microsoft::WRL::ComPtr<ID3D12Resource> SwapChain::GetCurrentBackbufferResource()
+{
+    return m_BackBuffers[m_CurrentBackBuffer].GetD3D12Resource();
+}
+
+const RenderResource& SwapChain::GetCurrentBackBuffer() const
 {
     return m_BackBuffers[m_CurrentBackBuffer];
 }
 
+const RenderResource& SwapChain::GetDepthStencilBuffer() const
+{
+    return m_DepthStencilBuffer;
+}
+
 D3D12_CPU_DESCRIPTOR_HANDLE SwapChain::GetDSVHandle()
 {
-    return m_DSVDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    return m_DSVDescriptor.GetCPUHandle();
 }
 
 DXGI_FORMAT SwapChain::GetDepthStencilFormat() const
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "SimpleMath.h"
+#include "DescriptorAllocator.h"
 #include "GraphicsCommandList.h"
 
 class CommandQueue;
@@ -17,8 +18,10 @@ class SwapChain
 {
 public:
     SwapChain(ServiceLocator& a_ServiceLocator, HWND a_HWND, uint8_t a_NumBackBuffers,DXGI_FORMAT a_BackBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM);
+    ~SwapChain();
 
-    void CreateDescriptorHeaps();
+    // Allocate the RTVs of the back buffers and the DSV of the depth stencil buffer from the device's descriptor allocators
+    void AllocateDescriptors();
     void CreateRenderTargets();
     void CreateDepthStencilBuffer(GraphicsCommandList& a_CommandList, DXGI_FORMAT a_Format = DXGI_FORMAT_D24_UNORM_S8_UINT);
 
@@ -29,12 +32,17 @@ public:
     // Clear the depth stencil buffer
     void ClearDSV(GraphicsCommandList& a_CommandList);
 
+    // Queue the transition of the current back buffer to the present state. The list needs to be executed before calling Present.
+    void PrepareForPresent(GraphicsCommandList& a_CommandList);
     // Swap the buffers
     void Present();
 
     // Get the handle to the current back buffer
     D3D12_CPU_DESCRIPTOR_HANDLE GetCurrentRTVHandle();
     Microsoft::WRL::ComPtr<ID3D12Resource> GetCurrentBackbufferResource();
+    // Get the current back buffer and the depth stencil buffer with their tracked states
+    const RenderResource& GetCurrentBackBuffer() const;
+    const RenderResource& GetDepthStencilBuffer() const;
     // Get the handle to the Depth Stencil buffer
     D3D12_CPU_DESCRIPTOR_HANDLE GetDSVHandle();
 
@@ -51,12 +59,12 @@ private:
     DXGI_FORMAT m_BackBufferFormat;
     uint8_t m_NumBackBuffers;
     uint8_t m_CurrentBackBuffer;
-    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_BackBuffers;
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_RTVDescriptorHeap;
+    std::vector<RenderResource> m_BackBuffers;
+    DescriptorAllocation m_RTVDescriptors;
 
     DirectX::SimpleMath::Color m_ClearColor;
         
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_DSVDescriptorHeap;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthStencilBuffer;
+    DescriptorAllocation m_DSVDescriptor;
+    RenderResource m_DepthStencilBuffer;
 };
 
@@ -13,13 +13,33 @@ Texture::Texture()
 {
 }
 
-Texture::Texture(Microsoft::WRL::ComPtr<ID3D12Resource> a_Buffer, CD3DX12_GPU_DESCRIPTOR_HANDLE a_DescriptorHandle)
+Texture::Texture(Microsoft::WRL::ComPtr<ID3D12Resource> a_Buffer, const DescriptorAllocation& a_SRV, DescriptorAllocator& a_SRVAllocator, std::shared_ptr<DescriptorAllocation> a_CPUSRV)
     : RenderResource(a_Buffer)
-    , m_DescriptorHandle(a_DescriptorHandle)
+    , m_CPUSRV(a_CPUSRV)
 {
+    m_TrackedState->m_ShaderVisibleDescriptors = a_SRV;
+    m_TrackedState->m_ShaderVisibleAllocator = &a_SRVAllocator;
 }
 
 CD3DX12_GPU_DESCRIPTOR_HANDLE Texture::GetGPUDescriptorHandle() const
 {
-    return m_DescriptorHandle;
+    if (!m_TrackedState || !m_TrackedState->m_ShaderVisibleDescriptors.IsValid())
+    {
+        return CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
+    }
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_TrackedState->m_ShaderVisibleDescriptors.GetGPUHandle());
+}
+
+uint32_t Texture::GetBindlessIndex() const
+{
+    return m_TrackedState ? m_TrackedState->m_ShaderVisibleDescriptors.m_HeapIndex : 0;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE Texture::GetCPUDescriptorHandle() const
+{
+    if (!m_CPUSRV)
+    {
+        return D3D12_CPU_DESCRIPTOR_HANDLE{ 0 };
+    }
+    return m_CPUSRV->GetCPUHandle();
 }
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "DescriptorAllocator.h"
 #include "RenderResource.h"
 #include "d3dx12.h"
 
+#include <memory>
 #include <string>
 
 class GraphicsCommandList;
@@ -16,14 +18,19 @@ class Texture
 public:
     Texture();
 
-    // Used by command list class
-    Texture(Microsoft::WRL::ComPtr<ID3D12Resource> a_Buffer, CD3DX12_GPU_DESCRIPTOR_HANDLE a_DescriptorHandle);
+    // Used by command list class. The SRVs are shared by all copies of the texture. The shader visible SRV belongs to the tracked state,
+    // so it is freed once the submissions which used the texture are done. The CPU only SRV is the copy source when the texture is staged into a dynamic descriptor table.
+    Texture(Microsoft::WRL::ComPtr<ID3D12Resource> a_Buffer, const DescriptorAllocation& a_SRV, DescriptorAllocator& a_SRVAllocator, std::shared_ptr<DescriptorAllocation> a_CPUSRV);
 
 
     CD3DX12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle() const;
+    // Index of the texture's SRV in the shader visible heap, used by shaders which read the textures through the bindless table
+    uint32_t GetBindlessIndex() const;
+    // Handle to the texture's SRV in a CPU only heap, which descriptors can be copied from
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPUDescriptorHandle() const;
 
 private:
 
-    CD3DX12_GPU_DESCRIPTOR_HANDLE m_DescriptorHandle;
+    std::shared_ptr<DescriptorAllocation> m_CPUSRV;
 };
 
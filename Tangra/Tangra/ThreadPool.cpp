@@ -0,0 +1,76 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t a_NumThreads)
+    : m_ShuttingDown(false)
+{
+    if (a_NumThreads == 0)
+    {
+        // Leave one hardware thread for the thread that owns the pool
+        size_t hardwareThreads = static_cast<size_t>(std::thread::hardware_concurrency());
+        a_NumThreads = std::max<size_t>(1, hardwareThreads > 0 ? hardwareThreads - 1 : 1);
+    }
+
+    m_Threads.reserve(a_NumThreads);
+    for (size_t i = 0; i < a_NumThreads; i++)
+    {
+        m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_ShuttingDown = true;
+    }
+    m_Condition.notify_all();
+
+    for (std::thread& thread : m_Threads)
+    {
+        thread.join();
+    }
+}
+
+std::future<void> ThreadPool::Enqueue(std::function<void()> a_Task)
+{
+    std::packaged_task<void()> task(std::move(a_Task));
+    std::future<void> future = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push(std::move(task));
+    }
+    m_Condition.notify_one();
+
+    return future;
+}
+
+size_t ThreadPool::GetNumThreads() const
+{
+    return m_Threads.size();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_ShuttingDown || !m_Tasks.empty(); });
+
+            // Keep working until the queue is drained, even when shutting down
+            if (m_Tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop();
+        }
+
+        // Exceptions thrown by the task are stored in its future
+        task();
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads which execute tasks in the order they were enqueued
+class ThreadPool
+{
+public:
+    // Creates the worker threads. A thread count of 0 uses one thread less than the number of hardware threads.
+    explicit ThreadPool(size_t a_NumThreads = 0);
+    // Finishes all the queued tasks and joins the worker threads
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task to be executed on one of the worker threads. The returned future becomes ready once the task has finished.
+    std::future<void> Enqueue(std::function<void()> a_Task);
+
+    size_t GetNumThreads() const;
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Threads;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::queue<std::packaged_task<void()>> m_Tasks;
+    bool m_ShuttingDown;
+};
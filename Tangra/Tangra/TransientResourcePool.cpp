@@ -0,0 +1,198 @@
+#include "TransientResourcePool.h"
+#include "CommandQueue.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "ResidencyManager.h"
+#include "ServiceLocator.h"
+
+#include "d3dx12.h"
+
+#include <stdexcept>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    template<typename T>
+    void AppendToKey(std::string& a_Key, const T& a_Value)
+    {
+        a_Key.append(reinterpret_cast<const char*>(&a_Value), sizeof(T));
+    }
+}
+
+TransientResourcePool::TransientResourcePool(ServiceLocator& a_ServiceLocator, size_t a_MaxCachedAllocations)
+    : m_Services(a_ServiceLocator)
+    , m_MaxCachedAllocations(a_MaxCachedAllocations)
+{
+}
+
+TransientResourcePool::~TransientResourcePool()
+{
+    if (m_Services.m_ResidencyManager)
+    {
+        for (auto& allocation : m_Allocations)
+        {
+            m_Services.m_ResidencyManager->Untrack(allocation.second->m_ResidencyObject);
+        }
+    }
+}
+
+TransientResourcePool::Allocation& TransientResourcePool::Acquire(const std::vector<Request>& a_Requests)
+{
+    ++m_FrameCounter;
+    ++m_Statistics.m_NumRequests;
+
+    std::string key = GetKey(a_Requests);
+    auto cached = m_Allocations.find(key);
+    if (cached != m_Allocations.end())
+    {
+        ++m_Statistics.m_NumReuseHits;
+    }
+    else
+    {
+        cached = m_Allocations.emplace(key, CreateAllocation(a_Requests)).first;
+    }
+
+    Allocation& allocation = *cached->second;
+    allocation.m_LastUsedFrame = m_FrameCounter;
+    m_Statistics.m_LastDedicatedBytes = allocation.m_Plan.m_DedicatedSize;
+    m_Statistics.m_LastAliasedBytes = allocation.m_Plan.m_HeapSize;
+
+    ReleaseUnusedAllocations(&allocation);
+
+    return allocation;
+}
+
+void TransientResourcePool::Release(Allocation& a_Allocation, uint64_t a_FenceValue)
+{
+    a_Allocation.m_LastUsedFenceValue = a_FenceValue;
+}
+
+TransientResourcePool::Statistics TransientResourcePool::GetStatistics() const
+{
+    return m_Statistics;
+}
+
+std::unique_ptr<TransientResourcePool::Allocation> TransientResourcePool::CreateAllocation(const std::vector<Request>& a_Requests)
+{
+    auto device = m_Services.m_Device->GetDeviceObject();
+
+    AliasingPlanner planner;
+    for (const Request& request : a_Requests)
+    {
+        const D3D12_RESOURCE_FLAGS targetFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+        if (request.m_Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER || (request.m_Desc.Flags & targetFlags) == 0)
+        {
+            throw std::runtime_error("Transient resources need to be render targets or depth stencil buffers");
+        }
+
+        D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->GetResourceAllocationInfo(0, 1, &request.m_Desc);
+        planner.AddResource(allocationInfo.SizeInBytes, allocationInfo.Alignment, request.m_FirstUse, request.m_LastUse);
+    }
+
+    auto allocation = std::make_unique<Allocation>();
+    allocation->m_Plan = planner.CreatePlan();
+
+    // Heaps which only hold render targets and depth buffers are supported on every resource heap tier
+    CD3DX12_HEAP_DESC heapDesc(allocation->m_Plan.m_HeapSize, D3D12_HEAP_TYPE_DEFAULT, allocation->m_Plan.m_HeapAlignment,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+    ThrowIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&allocation->m_Heap)));
+    allocation->m_Heap->SetName((std::wstring(L"Transient Resource Heap ") + std::to_wstring(m_Allocations.size() + 1)).c_str());
+    if (m_Services.m_ResidencyManager)
+    {
+        allocation->m_ResidencyObject = m_Services.m_ResidencyManager->Track(allocation->m_Heap.Get(), allocation->m_Plan.m_HeapSize);
+    }
+
+    for (size_t i = 0; i < a_Requests.size(); i++)
+    {
+        const Request& request = a_Requests[i];
+        ComPtr<ID3D12Resource> resource;
+        ThrowIfFailed(device->CreatePlacedResource(allocation->m_Heap.Get(), allocation->m_Plan.m_Placements[i].m_Offset, &request.m_Desc,
+            D3D12_RESOURCE_STATE_COMMON, request.m_HasClearValue ? &request.m_ClearValue : nullptr, IID_PPV_ARGS(&resource)));
+        if (m_Services.m_ResidencyManager)
+        {
+            ResidencyManager::SetResidencyObject(resource.Get(), allocation->m_ResidencyObject);
+        }
+
+        allocation->m_Resources.push_back(RenderResource(resource, D3D12_RESOURCE_STATE_COMMON));
+        allocation->m_Resources.back().SetName(L"Transient Resource " + std::to_wstring(i));
+    }
+
+    m_Statistics.m_NumHeaps++;
+    m_Statistics.m_HeapBytes += allocation->m_Plan.m_HeapSize;
+
+    return allocation;
+}
+
+void TransientResourcePool::ReleaseUnusedAllocations(const Allocation* a_Keep)
+{
+    CommandQueue* directQueue = m_Services.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+    while (m_Allocations.size() > m_MaxCachedAllocations)
+    {
+        auto leastRecentlyUsed = m_Allocations.end();
+        for (auto it = m_Allocations.begin(); it != m_Allocations.end(); ++it)
+        {
+            const Allocation* allocation = it->second.get();
+            bool canRelease = allocation != a_Keep && directQueue->IsFenceComplete(allocation->m_LastUsedFenceValue);
+            if (canRelease && (leastRecentlyUsed == m_Allocations.end() || allocation->m_LastUsedFrame < leastRecentlyUsed->second->m_LastUsedFrame))
+            {
+                leastRecentlyUsed = it;
+            }
+        }
+
+        // Everything else is still in use by the GPU, try again next time
+        if (leastRecentlyUsed == m_Allocations.end())
+        {
+            return;
+        }
+
+        m_Statistics.m_NumHeaps--;
+        m_Statistics.m_HeapBytes -= leastRecentlyUsed->second->m_Plan.m_HeapSize;
+        if (m_Services.m_ResidencyManager)
+        {
+            m_Services.m_ResidencyManager->Untrack(leastRecentlyUsed->second->m_ResidencyObject);
+        }
+        m_Allocations.erase(leastRecentlyUsed);
+    }
+}
+
+std::string TransientResourcePool::GetKey(const std::vector<Request>& a_Requests)
+{
+    // Written field by field, the padding in the structs isn't guaranteed to be cleared
+    std::string key;
+    for (const Request& request : a_Requests)
+    {
+        const D3D12_RESOURCE_DESC& desc = request.m_Desc;
+        AppendToKey(key, desc.Dimension);
+        AppendToKey(key, desc.Alignment);
+        AppendToKey(key, desc.Width);
+        AppendToKey(key, desc.Height);
+        AppendToKey(key, desc.DepthOrArraySize);
+        AppendToKey(key, desc.MipLevels);
+        AppendToKey(key, desc.Format);
+        AppendToKey(key, desc.SampleDesc.Count);
+        AppendToKey(key, desc.SampleDesc.Quality);
+        AppendToKey(key, desc.Layout);
+        AppendToKey(key, desc.Flags);
+
+        AppendToKey(key, request.m_HasClearValue);
+        if (request.m_HasClearValue)
+        {
+            AppendToKey(key, request.m_ClearValue.Format);
+            if ((desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) != 0)
+            {
+                AppendToKey(key, request.m_ClearValue.DepthStencil.Depth);
+                AppendToKey(key, request.m_ClearValue.DepthStencil.Stencil);
+            }
+            else
+            {
+                AppendToKey(key, request.m_ClearValue.Color);
+            }
+        }
+
+        AppendToKey(key, request.m_FirstUse);
+        AppendToKey(key, request.m_LastUse);
+    }
+    return key;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AliasingPlanner.h"
+#include "RenderResource.h"
+
+struct ServiceLocator;
+
+// Pool of render targets and depth buffers which only live within a frame. A set of requests is placed in a single heap,
+// where requests with lifetimes that don't overlap share memory. Sets are cached by the descriptions and lifetimes of their requests,
+// so a frame which needs the same targets as an earlier frame gets the same resources back without creating anything.
+// Not thread-safe, the render graph executor acquires the resources before recording.
+class TransientResourcePool
+{
+public:
+
+    struct Request
+    {
+        // Needs to describe a texture which allows render target or depth stencil use
+        D3D12_RESOURCE_DESC m_Desc = {};
+        bool m_HasClearValue = false;
+        D3D12_CLEAR_VALUE m_ClearValue = {};
+        // Inclusive range of steps the resource is used in
+        size_t m_FirstUse = 0;
+        size_t m_LastUse = 0;
+    };
+
+    // The resources for a set of requests, in the order of the requests
+    struct Allocation
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> m_Heap;
+        std::vector<RenderResource> m_Resources;
+        // Offsets of the resources and the resources they alias
+        AliasingPlanner::Plan m_Plan;
+        uint64_t m_LastUsedFenceValue = 0;
+        uint64_t m_LastUsedFrame = 0;
+        // The heap is tracked by the residency manager if there is one, and untracked before it is released
+        uint64_t m_ResidencyObject = 0;
+    };
+
+    struct Statistics
+    {
+        // Number and size of the heaps currently held by the pool
+        size_t m_NumHeaps = 0;
+        uint64_t m_HeapBytes = 0;
+        // Memory the last acquired set would take with a committed resource per request, and the memory it takes in its heap
+        uint64_t m_LastDedicatedBytes = 0;
+        uint64_t m_LastAliasedBytes = 0;
+        uint64_t m_NumRequests = 0;
+        // Number of sets which were served with cached resources
+        uint64_t m_NumReuseHits = 0;
+    };
+
+    // Sets which haven't been used for a while are released once more than the maximum number of sets is cached
+    TransientResourcePool(ServiceLocator& a_ServiceLocator, size_t a_MaxCachedAllocations = 4);
+    ~TransientResourcePool();
+
+    // Returns resources for the requests, reusing a cached set if one matches
+    Allocation& Acquire(const std::vector<Request>& a_Requests);
+    // Mark the set as used by the GPU until the direct queue reaches the fence value. It won't be released before that.
+    void Release(Allocation& a_Allocation, uint64_t a_FenceValue);
+
+    Statistics GetStatistics() const;
+private:
+    ServiceLocator& m_Services;
+
+    size_t m_MaxCachedAllocations;
+    uint64_t m_FrameCounter = 0;
+
+    // Create the heap and the placed resources for the requests
+    std::unique_ptr<Allocation> CreateAllocation(const std::vector<Request>& a_Requests);
+    // Release the least recently used sets the GPU is done with until no more than the maximum are cached
+    void ReleaseUnusedAllocations(const Allocation* a_Keep);
+
+    // Returns a key which is equal for equal sets of requests
+    static std::string GetKey(const std::vector<Request>& a_Requests);
+
+    std::unordered_map<std::string, std::unique_ptr<Allocation>> m_Allocations;
+
+    Statistics m_Statistics;
+};
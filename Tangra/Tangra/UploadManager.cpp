@@ -0,0 +1,481 @@
+#include "UploadManager.h"
+#include "Helpers.h"
+#include "Device.h"
+#include "GraphicsCommandList.h"
+#include "ServiceLocator.h"
+
+#include "d3dx12.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+    uint64_t AlignUp(uint64_t a_Value, uint64_t a_Alignment)
+    {
+        return (a_Value + a_Alignment - 1) & ~(a_Alignment - 1);
+    }
+
+    // Copy buffer regions don't have an alignment requirement, but keeping the staging data aligned makes the memcpy cheaper
+    const uint64_t g_BufferStagingAlignment = 16;
+}
+
+UploadManager::UploadManager(ServiceLocator& a_ServiceLocator, uint64_t a_RingSize, uint64_t a_FrameBudget)
+    : m_Services(a_ServiceLocator)
+    , m_RingData(nullptr)
+    , m_RingSize(a_RingSize)
+    , m_RingHead(0)
+    , m_RingTail(0)
+    , m_RingBytesInUse(0)
+    , m_FrameBudget(a_FrameBudget)
+    , m_FrameBytesStaged(0)
+    , m_CurrentBatchList(nullptr)
+    , m_CurrentBatchRingBytes(0)
+    , m_LastStagedId(0)
+    , m_NextUploadId(1)
+    , m_LastSubmittedId(0)
+    , m_LastCompletedId(0)
+    , m_BytesUploaded(0)
+    , m_NumSubmissions(0)
+    , m_StatisticsStartTime(std::chrono::high_resolution_clock::now())
+{
+    m_CopyQueue = m_Services.m_Device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+
+    // Create the ring buffer and keep it mapped for its whole lifetime
+    auto device = m_Services.m_Device->GetDeviceObject();
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(m_RingSize);
+    ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_RingBuffer)));
+    m_RingBuffer->SetName(L"Upload Ring Buffer");
+
+    // The CPU never reads from the ring
+    D3D12_RANGE readRange = { 0, 0 };
+    void* ringData = nullptr;
+    ThrowIfFailed(m_RingBuffer->Map(0, &readRange, &ringData));
+    m_RingData = static_cast<uint8_t*>(ringData);
+}
+
+UploadManager::~UploadManager()
+{
+    // Make sure the GPU is done reading from the ring before it is released
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        SubmitBatch();
+    }
+    m_CopyQueue->Flush();
+
+    m_RingBuffer->Unmap(0, nullptr);
+}
+
+UploadManager::UploadToken UploadManager::UploadBuffer(ComPtr<ID3D12Resource> a_Destination, uint64_t a_DestinationOffset, const void* a_Data, uint64_t a_Size)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    UploadToken token;
+    token.m_Id = m_NextUploadId++;
+
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources(1);
+    subresources[0].pData = a_Data;
+    // A buffer is a single row, so the row pitch and the slice pitch are the same
+    subresources[0].RowPitch = static_cast<LONG_PTR>(a_Size);
+    subresources[0].SlicePitch = subresources[0].RowPitch;
+
+    // Stage the data right away if there is nothing queued in front of it, it fits in the budget and the ring has space
+    if (m_PendingUploads.empty() && m_FrameBytesStaged + a_Size <= m_FrameBudget)
+    {
+        RetireCompletedBatches();
+        if (a_Size > m_RingSize)
+        {
+            StageOversizedUpload(token.m_Id, a_Destination.Get(), false, a_DestinationOffset, 0, subresources, a_Size);
+            return token;
+        }
+        if (TryStageUpload(token.m_Id, a_Destination.Get(), false, a_DestinationOffset, 0, subresources, a_Size))
+        {
+            return token;
+        }
+    }
+
+    // Otherwise keep a copy of the data until it can be staged
+    PendingUpload upload;
+    upload.m_Id = token.m_Id;
+    upload.m_Destination = a_Destination;
+    upload.m_IsTexture = false;
+    upload.m_DestinationOffset = a_DestinationOffset;
+    upload.m_StagingSize = a_Size;
+    upload.m_Data.resize(static_cast<size_t>(a_Size));
+    memcpy(upload.m_Data.data(), a_Data, static_cast<size_t>(a_Size));
+    subresources[0].pData = upload.m_Data.data();
+    upload.m_Subresources = subresources;
+
+    m_PendingUploads.push_back(std::move(upload));
+    return token;
+}
+
+UploadManager::UploadToken UploadManager::UploadTexture(ComPtr<ID3D12Resource> a_Destination, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources, UINT a_FirstSubresource)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    UploadToken token;
+    token.m_Id = m_NextUploadId++;
+
+    // The layout of the texture data in the ring is decided by the footprints
+    UINT numSubresources = static_cast<UINT>(a_Subresources.size());
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(numSubresources);
+    D3D12_RESOURCE_DESC desc = a_Destination->GetDesc();
+    UINT64 stagingSize = 0;
+    m_Services.m_Device->GetDeviceObject()->GetCopyableFootprints(&desc, a_FirstSubresource, numSubresources, 0, layouts.data(), nullptr, nullptr, &stagingSize);
+
+    if (m_PendingUploads.empty() && m_FrameBytesStaged + stagingSize <= m_FrameBudget)
+    {
+        RetireCompletedBatches();
+        if (stagingSize > m_RingSize)
+        {
+            StageOversizedUpload(token.m_Id, a_Destination.Get(), true, 0, a_FirstSubresource, a_Subresources, stagingSize);
+            return token;
+        }
+        if (TryStageUpload(token.m_Id, a_Destination.Get(), true, 0, a_FirstSubresource, a_Subresources, stagingSize))
+        {
+            return token;
+        }
+    }
+
+    PendingUpload upload;
+    upload.m_Id = token.m_Id;
+    upload.m_Destination = a_Destination;
+    upload.m_IsTexture = true;
+    upload.m_FirstSubresource = a_FirstSubresource;
+    upload.m_StagingSize = stagingSize;
+
+    // Copy all the subresources into one block of memory and point the subresource data at it
+    std::vector<size_t> dataOffsets(numSubresources);
+    size_t dataSize = 0;
+    for (UINT i = 0; i < numSubresources; i++)
+    {
+        dataOffsets[i] = dataSize;
+        dataSize += static_cast<size_t>(a_Subresources[i].SlicePitch) * layouts[i].Footprint.Depth;
+    }
+    upload.m_Data.resize(dataSize);
+    upload.m_Subresources = a_Subresources;
+    for (UINT i = 0; i < numSubresources; i++)
+    {
+        size_t size = static_cast<size_t>(a_Subresources[i].SlicePitch) * layouts[i].Footprint.Depth;
+        memcpy(upload.m_Data.data() + dataOffsets[i], a_Subresources[i].pData, size);
+        upload.m_Subresources[i].pData = upload.m_Data.data() + dataOffsets[i];
+    }
+
+    m_PendingUploads.push_back(std::move(upload));
+    return token;
+}
+
+void UploadManager::ProcessUploads()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // A new frame starts with a fresh budget
+    m_FrameBytesStaged = 0;
+
+    StagePendingUploads(false, 0);
+    SubmitBatch();
+}
+
+CommandQueue::SyncPoint UploadManager::GetSyncPoint(UploadToken a_Token)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    RetireCompletedBatches();
+    if (!a_Token.IsValid() || a_Token.m_Id <= m_LastCompletedId)
+    {
+        return CommandQueue::SyncPoint();
+    }
+
+    // Something depends on the upload, so it can't wait for the budget anymore
+    if (a_Token.m_Id > m_LastSubmittedId)
+    {
+        if (a_Token.m_Id > m_LastStagedId)
+        {
+            StagePendingUploads(true, a_Token.m_Id);
+        }
+        SubmitBatch();
+    }
+
+    for (const SubmittedBatch& batch : m_SubmittedBatches)
+    {
+        if (batch.m_LastUploadId >= a_Token.m_Id)
+        {
+            return m_CopyQueue->GetSyncPoint(batch.m_FenceValue);
+        }
+    }
+    return CommandQueue::SyncPoint();
+}
+
+bool UploadManager::IsUploadComplete(UploadToken a_Token)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    RetireCompletedBatches();
+    return a_Token.m_Id <= m_LastCompletedId;
+}
+
+void UploadManager::WaitForUpload(UploadToken a_Token)
+{
+    CommandQueue::SyncPoint syncPoint = GetSyncPoint(a_Token);
+    if (syncPoint.IsValid())
+    {
+        syncPoint.m_Queue->WaitForFenceValue(syncPoint.m_FenceValue);
+    }
+}
+
+UploadManager::Statistics UploadManager::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    RetireCompletedBatches();
+
+    Statistics statistics;
+    statistics.m_BytesUploaded = m_BytesUploaded;
+    double elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_StatisticsStartTime).count();
+    statistics.m_BytesPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(m_BytesUploaded) / elapsedSeconds : 0.0;
+    statistics.m_RingSize = m_RingSize;
+    statistics.m_RingBytesInUse = m_RingBytesInUse;
+    statistics.m_RingUtilization = static_cast<float>(static_cast<double>(m_RingBytesInUse) / static_cast<double>(m_RingSize));
+    statistics.m_NumPendingUploads = m_PendingUploads.size();
+    statistics.m_NumSubmissions = m_NumSubmissions;
+    return statistics;
+}
+
+void UploadManager::ResetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_BytesUploaded = 0;
+    m_NumSubmissions = 0;
+    m_StatisticsStartTime = std::chrono::high_resolution_clock::now();
+}
+
+bool UploadManager::TryStageUpload(uint64_t a_Id, ID3D12Resource* a_Destination, bool a_IsTexture, uint64_t a_DestinationOffset,
+    UINT a_FirstSubresource, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources, uint64_t a_StagingSize)
+{
+    uint64_t alignment = a_IsTexture ? D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : g_BufferStagingAlignment;
+    uint64_t ringOffset = 0;
+    if (!TryAllocateFromRing(a_StagingSize, alignment, ringOffset))
+    {
+        return false;
+    }
+
+    RecordCopy(m_RingBuffer.Get(), m_RingData, ringOffset, a_Destination, a_IsTexture, a_DestinationOffset, a_FirstSubresource, a_Subresources);
+
+    m_FrameBytesStaged += a_StagingSize;
+    m_BytesUploaded += a_StagingSize;
+    m_LastStagedId = a_Id;
+    return true;
+}
+
+void UploadManager::StageOversizedUpload(uint64_t a_Id, ID3D12Resource* a_Destination, bool a_IsTexture, uint64_t a_DestinationOffset,
+    UINT a_FirstSubresource, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources, uint64_t a_StagingSize)
+{
+    // The upload can never fit in the ring, so it gets its own upload buffer which lives until the copy has finished
+    ComPtr<ID3D12Resource> uploadBuffer;
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(a_StagingSize);
+    ThrowIfFailed(m_Services.m_Device->GetDeviceObject()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer)));
+
+    D3D12_RANGE readRange = { 0, 0 };
+    void* uploadData = nullptr;
+    ThrowIfFailed(uploadBuffer->Map(0, &readRange, &uploadData));
+    RecordCopy(uploadBuffer.Get(), static_cast<uint8_t*>(uploadData), 0, a_Destination, a_IsTexture, a_DestinationOffset, a_FirstSubresource, a_Subresources);
+    uploadBuffer->Unmap(0, nullptr);
+
+    m_CurrentBatchList->TrackIntermediateBuffer(uploadBuffer);
+
+    m_FrameBytesStaged += a_StagingSize;
+    m_BytesUploaded += a_StagingSize;
+    m_LastStagedId = a_Id;
+}
+
+void UploadManager::RecordCopy(ID3D12Resource* a_StagingBuffer, uint8_t* a_StagingData, uint64_t a_StagingOffset, ID3D12Resource* a_Destination,
+    bool a_IsTexture, uint64_t a_DestinationOffset, UINT a_FirstSubresource, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources)
+{
+    if (m_CurrentBatchList == nullptr)
+    {
+        m_CurrentBatchList = m_CopyQueue->GetCommandList();
+    }
+
+    // The copy isn't recorded in the destination's tracked state, so the batch keeps the destination alive until the copy queue is done with it.
+    // Otherwise a resource dropped right after its upload would count as never submitted and be released while the copy is still running.
+    m_CurrentBatchList->TrackIntermediateBuffer(a_Destination);
+
+    if (!a_IsTexture)
+    {
+        uint64_t size = static_cast<uint64_t>(a_Subresources[0].RowPitch);
+        memcpy(a_StagingData + a_StagingOffset, a_Subresources[0].pData, static_cast<size_t>(size));
+        m_CurrentBatchList->CopyBufferRegion(a_Destination, a_DestinationOffset, a_StagingBuffer, a_StagingOffset, size);
+        return;
+    }
+
+    // Get the footprints of the subresources at the staging offset, they describe where every row needs to go
+    UINT numSubresources = static_cast<UINT>(a_Subresources.size());
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(numSubresources);
+    std::vector<UINT> numRows(numSubresources);
+    std::vector<UINT64> rowSizes(numSubresources);
+    D3D12_RESOURCE_DESC desc = a_Destination->GetDesc();
+    m_Services.m_Device->GetDeviceObject()->GetCopyableFootprints(&desc, a_FirstSubresource, numSubresources, a_StagingOffset,
+        layouts.data(), numRows.data(), rowSizes.data(), nullptr);
+
+    for (UINT i = 0; i < numSubresources; i++)
+    {
+        const D3D12_SUBRESOURCE_FOOTPRINT& footprint = layouts[i].Footprint;
+        const uint8_t* source = static_cast<const uint8_t*>(a_Subresources[i].pData);
+        uint8_t* destination = a_StagingData + layouts[i].Offset;
+
+        // The row pitch in the staging memory is aligned, so the rows are copied one by one
+        for (UINT z = 0; z < footprint.Depth; z++)
+        {
+            for (UINT y = 0; y < numRows[i]; y++)
+            {
+                memcpy(destination + static_cast<size_t>(footprint.RowPitch) * (z * numRows[i] + y),
+                    source + static_cast<size_t>(a_Subresources[i].SlicePitch) * z + static_cast<size_t>(a_Subresources[i].RowPitch) * y,
+                    static_cast<size_t>(rowSizes[i]));
+            }
+        }
+
+        CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(a_Destination, a_FirstSubresource + i);
+        CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(a_StagingBuffer, layouts[i]);
+        m_CurrentBatchList->CopyTextureRegion(destinationLocation, sourceLocation);
+    }
+}
+
+void UploadManager::StagePendingUploads(bool a_IgnoreBudget, uint64_t a_UpToId)
+{
+    RetireCompletedBatches();
+
+    while (!m_PendingUploads.empty())
+    {
+        PendingUpload& upload = m_PendingUploads.front();
+
+        if (a_IgnoreBudget)
+        {
+            if (upload.m_Id > a_UpToId)
+            {
+                break;
+            }
+        }
+        // Always allow at least one upload per frame, so uploads over the budget don't get stuck
+        else if (m_FrameBytesStaged > 0 && m_FrameBytesStaged + upload.m_StagingSize > m_FrameBudget)
+        {
+            break;
+        }
+
+        if (upload.m_StagingSize > m_RingSize)
+        {
+            StageOversizedUpload(upload.m_Id, upload.m_Destination.Get(), upload.m_IsTexture, upload.m_DestinationOffset,
+                upload.m_FirstSubresource, upload.m_Subresources, upload.m_StagingSize);
+        }
+        else if (!TryStageUpload(upload.m_Id, upload.m_Destination.Get(), upload.m_IsTexture, upload.m_DestinationOffset,
+            upload.m_FirstSubresource, upload.m_Subresources, upload.m_StagingSize))
+        {
+            // The ring is full. Streaming uploads just try again next frame.
+            if (!a_IgnoreBudget)
+            {
+                break;
+            }
+
+            // Something is waiting for this upload, so submit what has been staged and wait for the oldest batch to free up its space
+            SubmitBatch();
+            m_CopyQueue->WaitForFenceValue(m_SubmittedBatches.front().m_FenceValue);
+            RetireCompletedBatches();
+            continue;
+        }
+
+        m_PendingUploads.pop_front();
+    }
+}
+
+void UploadManager::SubmitBatch()
+{
+    if (m_CurrentBatchList == nullptr)
+    {
+        return;
+    }
+
+    SubmittedBatch batch;
+    batch.m_LastUploadId = m_LastStagedId;
+    batch.m_FenceValue = m_CopyQueue->ExecuteCommandList(*m_CurrentBatchList);
+    batch.m_RingEnd = m_RingHead;
+    batch.m_RingBytes = m_CurrentBatchRingBytes;
+    m_SubmittedBatches.push_back(batch);
+
+    m_LastSubmittedId = m_LastStagedId;
+    m_CurrentBatchList = nullptr;
+    m_CurrentBatchRingBytes = 0;
+    ++m_NumSubmissions;
+}
+
+void UploadManager::RetireCompletedBatches()
+{
+    // Batches complete in submission order, so the ring is freed from the tail
+    while (!m_SubmittedBatches.empty() && m_CopyQueue->IsFenceComplete(m_SubmittedBatches.front().m_FenceValue))
+    {
+        const SubmittedBatch& batch = m_SubmittedBatches.front();
+        m_RingTail = batch.m_RingEnd;
+        m_RingBytesInUse -= batch.m_RingBytes;
+        m_LastCompletedId = batch.m_LastUploadId;
+        m_SubmittedBatches.pop_front();
+    }
+}
+
+bool UploadManager::TryAllocateFromRing(uint64_t a_Size, uint64_t a_Alignment, uint64_t& a_Offset)
+{
+    // Start at the beginning again when the ring is empty, to keep allocations from wrapping unnecessarily
+    if (m_RingBytesInUse == 0)
+    {
+        m_RingHead = 0;
+        m_RingTail = 0;
+    }
+    // The head caught up with the tail, so the ring is completely full
+    else if (m_RingHead == m_RingTail)
+    {
+        return false;
+    }
+
+    uint64_t alignedHead = AlignUp(m_RingHead, a_Alignment);
+
+    if (m_RingHead >= m_RingTail)
+    {
+        // The free space is from the head to the end and from the start to the tail
+        if (alignedHead + a_Size <= m_RingSize)
+        {
+            a_Offset = alignedHead;
+        }
+        else if (a_Size <= m_RingTail)
+        {
+            // Wrap around, the space at the end of the ring is wasted until the allocation is retired
+            a_Offset = 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // The free space is between the head and the tail
+        if (alignedHead + a_Size > m_RingTail)
+        {
+            return false;
+        }
+        a_Offset = alignedHead;
+    }
+
+    uint64_t newHead = a_Offset + a_Size;
+    // Account for the alignment padding and the space wasted by wrapping around as well
+    uint64_t consumedBytes = a_Offset >= m_RingHead ? newHead - m_RingHead : (m_RingSize - m_RingHead) + newHead;
+
+    m_RingHead = newHead == m_RingSize ? 0 : newHead;
+    m_RingBytesInUse += consumedBytes;
+    m_CurrentBatchRingBytes += consumedBytes;
+    return true;
+}
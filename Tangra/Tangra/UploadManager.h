@@ -0,0 +1,148 @@
+#pragma once
+
+#include <wrl.h>
+#include <d3d12.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "CommandQueue.h"
+
+class GraphicsCommandList;
+
+struct ServiceLocator;
+
+// Uploads data to default heap resources through the copy queue.
+// The data is staged in one large persistently mapped upload buffer which is used as a ring, and many uploads are batched into a single copy queue submission.
+// Uploads over the per-frame byte budget are kept in a queue and staged in later frames, unless something depends on them earlier.
+class UploadManager
+{
+public:
+
+    // Handle to a single upload, used to find out when the data has arrived on the GPU
+    struct UploadToken
+    {
+        uint64_t m_Id = 0;
+
+        bool IsValid() const { return m_Id != 0; }
+    };
+
+    struct Statistics
+    {
+        // Total number of bytes copied to the GPU since the statistics were last reset
+        uint64_t m_BytesUploaded = 0;
+        // Average upload throughput since the statistics were last reset
+        double m_BytesPerSecond = 0.0;
+        uint64_t m_RingSize = 0;
+        // Bytes of the ring which are waiting for the GPU to finish copying from them
+        uint64_t m_RingBytesInUse = 0;
+        // Fraction of the ring in use, between 0 and 1
+        float m_RingUtilization = 0.0f;
+        // Number of uploads which have not been staged yet because of the budget or a full ring
+        size_t m_NumPendingUploads = 0;
+        // Number of copy queue submissions
+        uint64_t m_NumSubmissions = 0;
+    };
+
+    UploadManager(ServiceLocator& a_ServiceLocator, uint64_t a_RingSize = 64 * 1024 * 1024, uint64_t a_FrameBudget = 8 * 1024 * 1024);
+    ~UploadManager();
+
+    // Queue a copy of linear data into a buffer. The buffer needs to be in the common state.
+    UploadToken UploadBuffer(Microsoft::WRL::ComPtr<ID3D12Resource> a_Destination, uint64_t a_DestinationOffset, const void* a_Data, uint64_t a_Size);
+    // Queue a copy of texture data into the subresources of a texture, starting at the specified subresource. The texture needs to be in the common state.
+    UploadToken UploadTexture(Microsoft::WRL::ComPtr<ID3D12Resource> a_Destination, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources, UINT a_FirstSubresource = 0);
+
+    // Stage queued uploads until the per-frame budget is used up and submit everything that has been staged. Should be called once per frame.
+    void ProcessUploads();
+
+    // Returns the sync point the GPU needs to wait for before it can use the data of the upload.
+    // An upload which has not been submitted yet is submitted right away, regardless of the budget.
+    // Returns an invalid sync point if the upload has already completed.
+    CommandQueue::SyncPoint GetSyncPoint(UploadToken a_Token);
+    // Check if the data of the upload has arrived on the GPU without blocking
+    bool IsUploadComplete(UploadToken a_Token);
+    // Block the calling thread until the data of the upload has arrived on the GPU
+    void WaitForUpload(UploadToken a_Token);
+
+    Statistics GetStatistics();
+    void ResetStatistics();
+private:
+
+    // Copy of the data of an upload which could not be staged right away
+    struct PendingUpload
+    {
+        uint64_t m_Id = 0;
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_Destination;
+        bool m_IsTexture = false;
+        uint64_t m_DestinationOffset = 0;
+        UINT m_FirstSubresource = 0;
+        // The subresource data points into m_Data
+        std::vector<D3D12_SUBRESOURCE_DATA> m_Subresources;
+        std::vector<uint8_t> m_Data;
+        // Number of bytes the upload needs in the ring
+        uint64_t m_StagingSize = 0;
+    };
+
+    // Copy queue submission of a number of uploads
+    struct SubmittedBatch
+    {
+        uint64_t m_LastUploadId = 0;
+        uint64_t m_FenceValue = 0;
+        // Ring offset after the last allocation of the batch, and the number of ring bytes the batch used including padding
+        uint64_t m_RingEnd = 0;
+        uint64_t m_RingBytes = 0;
+    };
+
+    // Copy the data into the ring and record the copy into the current batch. Returns false if the ring is too full.
+    bool TryStageUpload(uint64_t a_Id, ID3D12Resource* a_Destination, bool a_IsTexture, uint64_t a_DestinationOffset,
+        UINT a_FirstSubresource, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources, uint64_t a_StagingSize);
+    // Stage the upload through a dedicated upload buffer, for uploads that are larger than the whole ring
+    void StageOversizedUpload(uint64_t a_Id, ID3D12Resource* a_Destination, bool a_IsTexture, uint64_t a_DestinationOffset,
+        UINT a_FirstSubresource, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources, uint64_t a_StagingSize);
+    // Record the copy from the staging memory to the destination
+    void RecordCopy(ID3D12Resource* a_StagingBuffer, uint8_t* a_StagingData, uint64_t a_StagingOffset, ID3D12Resource* a_Destination,
+        bool a_IsTexture, uint64_t a_DestinationOffset, UINT a_FirstSubresource, const std::vector<D3D12_SUBRESOURCE_DATA>& a_Subresources);
+
+    // Stage pending uploads in order. Stops at the budget unless a_IgnoreBudget is set, in which case it stages up to a_UpToId and waits for ring space if needed.
+    void StagePendingUploads(bool a_IgnoreBudget, uint64_t a_UpToId);
+    // Submit the current batch to the copy queue
+    void SubmitBatch();
+    // Free the ring space of all batches the GPU has finished
+    void RetireCompletedBatches();
+
+    bool TryAllocateFromRing(uint64_t a_Size, uint64_t a_Alignment, uint64_t& a_Offset);
+
+    ServiceLocator& m_Services;
+    CommandQueue* m_CopyQueue;
+
+    std::mutex m_Mutex;
+
+    // Persistently mapped upload heap buffer used as a ring
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_RingBuffer;
+    uint8_t* m_RingData;
+    uint64_t m_RingSize;
+    uint64_t m_RingHead;
+    uint64_t m_RingTail;
+    uint64_t m_RingBytesInUse;
+
+    uint64_t m_FrameBudget;
+    uint64_t m_FrameBytesStaged;
+
+    // Copy list which records the uploads that have been staged but not submitted yet
+    GraphicsCommandList* m_CurrentBatchList;
+    uint64_t m_CurrentBatchRingBytes;
+    uint64_t m_LastStagedId;
+
+    std::deque<PendingUpload> m_PendingUploads;
+    std::deque<SubmittedBatch> m_SubmittedBatches;
+
+    uint64_t m_NextUploadId;
+    uint64_t m_LastSubmittedId;
+    uint64_t m_LastCompletedId;
+
+    uint64_t m_BytesUploaded;
+    uint64_t m_NumSubmissions;
+    std::chrono::high_resolution_clock::time_point m_StatisticsStartTime;
+};
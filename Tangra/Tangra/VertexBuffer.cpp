@@ -8,10 +8,10 @@ VertexBuffer::VertexBuffer()
 
 VertexBuffer::VertexBuffer(Microsoft::WRL::ComPtr<ID3D12Resource> a_DefaultBuffer,
     D3D12_VERTEX_BUFFER_VIEW a_VertexBufferView)
-    : m_VertexBufferView(a_VertexBufferView)
+    : RenderResource(a_DefaultBuffer)
+    , m_VertexBufferView(a_VertexBufferView)
     , m_NumVertices(a_VertexBufferView.SizeInBytes / a_VertexBufferView.StrideInBytes)
 {
-    m_DefaultBuffer = a_DefaultBuffer;
 }
 
 UINT VertexBuffer::GetNumVertices() const
@@ -27,6 +27,7 @@ D3D12_VERTEX_BUFFER_VIEW VertexBuffer::GetVertexBufferView()
 VertexBuffer& VertexBuffer::operator=(const VertexBuffer& a_Other)
 {
     m_DefaultBuffer = a_Other.m_DefaultBuffer;
+    m_TrackedState = a_Other.m_TrackedState;
     m_NumVertices = a_Other.m_NumVertices;
     m_VertexBufferView = a_Other.m_VertexBufferView;
 
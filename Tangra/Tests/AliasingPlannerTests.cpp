@@ -0,0 +1,120 @@
+#include "TestFramework.h"
+#include "AliasingPlanner.h"
+
+#include <algorithm>
+
+namespace
+{
+    bool Aliases(const AliasingPlanner::Plan& a_Plan, size_t a_Resource, size_t a_Aliased)
+    {
+        const std::vector<size_t>& aliased = a_Plan.m_Placements[a_Resource].m_AliasedResources;
+        return std::find(aliased.begin(), aliased.end(), a_Aliased) != aliased.end();
+    }
+
+    bool MemoryOverlaps(const AliasingPlanner::Plan& a_Plan, size_t a_Left, uint64_t a_LeftSize, size_t a_Right, uint64_t a_RightSize)
+    {
+        uint64_t left = a_Plan.m_Placements[a_Left].m_Offset;
+        uint64_t right = a_Plan.m_Placements[a_Right].m_Offset;
+        return left < right + a_RightSize && right < left + a_LeftSize;
+    }
+}
+
+TEST(ResourcesAliveAtTheSameTimeDontShareMemory)
+{
+    AliasingPlanner planner;
+    size_t a = planner.AddResource(1024, 256, 0, 2);
+    size_t b = planner.AddResource(512, 256, 1, 3);
+    size_t c = planner.AddResource(2048, 256, 2, 2);
+
+    AliasingPlanner::Plan plan = planner.CreatePlan();
+    CHECK(!MemoryOverlaps(plan, a, 1024, b, 512));
+    CHECK(!MemoryOverlaps(plan, a, 1024, c, 2048));
+    CHECK(!MemoryOverlaps(plan, b, 512, c, 2048));
+    CHECK(plan.m_HeapSize == 1024 + 512 + 2048);
+    CHECK(plan.GetMemorySaved() == 0);
+    for (const AliasingPlanner::Placement& placement : plan.m_Placements)
+    {
+        CHECK(placement.m_AliasedResources.empty());
+    }
+}
+
+TEST(ResourcesWithDisjointLifetimesShareMemory)
+{
+    AliasingPlanner planner;
+    size_t a = planner.AddResource(4096, 4096, 0, 1);
+    size_t b = planner.AddResource(4096, 4096, 2, 3);
+
+    AliasingPlanner::Plan plan = planner.CreatePlan();
+    CHECK(plan.m_Placements[a].m_Offset == 0);
+    CHECK(plan.m_Placements[b].m_Offset == 0);
+    CHECK(plan.m_HeapSize == 4096);
+    CHECK(plan.m_HeapAlignment == 4096);
+    CHECK(plan.GetMemorySaved() == 4096);
+    CHECK(plan.m_Placements[a].m_AliasedResources.empty());
+    CHECK(Aliases(plan, b, a));
+}
+
+TEST(PlacementsRespectAlignment)
+{
+    AliasingPlanner planner;
+    size_t a = planner.AddResource(1000, 256, 0, 0);
+    size_t b = planner.AddResource(100, 65536, 0, 0);
+
+    AliasingPlanner::Plan plan = planner.CreatePlan();
+    CHECK(plan.m_Placements[a].m_Offset % 256 == 0);
+    CHECK(plan.m_Placements[b].m_Offset % 65536 == 0);
+    CHECK(plan.m_HeapAlignment == 65536);
+}
+
+// A, B and C follow each other in the same memory. C may only take the memory over from B, an aliasing barrier from A could activate C while B is still in use.
+TEST(OnlyTheMostRecentOccupantIsAliased)
+{
+    AliasingPlanner planner;
+    size_t a = planner.AddResource(4096, 4096, 0, 1);
+    size_t b = planner.AddResource(4096, 4096, 2, 3);
+    size_t c = planner.AddResource(4096, 4096, 4, 5);
+
+    AliasingPlanner::Plan plan = planner.CreatePlan();
+    CHECK(plan.m_Placements[a].m_Offset == plan.m_Placements[b].m_Offset);
+    CHECK(plan.m_Placements[b].m_Offset == plan.m_Placements[c].m_Offset);
+
+    CHECK(plan.m_Placements[a].m_AliasedResources.empty());
+    CHECK(plan.m_Placements[b].m_AliasedResources.size() == 1);
+    CHECK(Aliases(plan, b, a));
+    CHECK(plan.m_Placements[c].m_AliasedResources.size() == 1);
+    CHECK(Aliases(plan, c, b));
+}
+
+// A large resource which takes over the memory of two smaller ones, used at different times, aliases both of them
+TEST(EveryPartOfTheMemoryIsAliasedFromItsLastOccupant)
+{
+    AliasingPlanner planner;
+    size_t large = planner.AddResource(8192, 4096, 4, 5);
+    size_t a = planner.AddResource(4096, 4096, 0, 1);
+    size_t b = planner.AddResource(4096, 4096, 0, 3);
+    size_t c = planner.AddResource(4096, 4096, 2, 3);
+
+    AliasingPlanner::Plan plan = planner.CreatePlan();
+    CHECK(plan.m_HeapSize == 8192);
+    // C replaced A, so the large resource takes over from B and C
+    CHECK(Aliases(plan, c, a));
+    CHECK(Aliases(plan, large, b));
+    CHECK(Aliases(plan, large, c));
+    CHECK(!Aliases(plan, large, a));
+}
+
+TEST(ClearRemovesTheResources)
+{
+    AliasingPlanner planner;
+    planner.AddResource(4096, 4096, 0, 1);
+    planner.Clear();
+
+    AliasingPlanner::Plan plan = planner.CreatePlan();
+    CHECK(plan.m_Placements.empty());
+    CHECK(plan.m_HeapSize == 0);
+}
+
+int main()
+{
+    return RUN_TESTS();
+}
@@ -0,0 +1,96 @@
+#include "BuddyAllocator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Places resources of typical sizes in 256 MB heaps, the way GpuMemoryAllocator does, while they are created and released at random.
+// Reports the time per allocation and free, and the memory used compared to a committed resource per allocation,
+// which rounds every resource up to 64 KB.
+namespace
+{
+    const uint64_t g_HeapSize = 256ull * 1024 * 1024;
+    const uint64_t g_MinBlockSize = 256;
+    const uint64_t g_CommittedAlignment = 64 * 1024;
+    const int g_NumOperations = 1000000;
+
+    // Mostly small buffers, like constant and mesh buffers, with a few larger textures
+    uint64_t RandomSize(std::mt19937& a_Random)
+    {
+        uint32_t kind = a_Random() % 100;
+        if (kind < 70)
+        {
+            return 256 + a_Random() % (16 * 1024);
+        }
+        if (kind < 95)
+        {
+            return 64 * 1024 + a_Random() % (512 * 1024);
+        }
+        return 1024 * 1024 + a_Random() % (4 * 1024 * 1024);
+    }
+}
+
+int main()
+{
+    BuddyAllocator allocator(g_HeapSize, g_MinBlockSize);
+    std::mt19937 random(1);
+
+    struct Allocation
+    {
+        uint64_t m_Offset;
+        uint64_t m_Size;
+    };
+    std::vector<Allocation> allocations;
+
+    uint64_t numAllocations = 0;
+    uint64_t numFailed = 0;
+    uint64_t requestedSize = 0;
+    uint64_t committedSize = 0;
+    double sumRequested = 0.0;
+    double sumAllocated = 0.0;
+    double sumCommitted = 0.0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < g_NumOperations; i++)
+    {
+        // Keep the heap around three quarters full by freeing more often once it fills up
+        bool allocate = allocations.empty() || allocator.GetAllocatedSize() < g_HeapSize * 3 / 4 ? random() % 4 != 0 : random() % 4 == 0;
+        if (allocate)
+        {
+            uint64_t size = RandomSize(random);
+            uint64_t offset = allocator.Allocate(size, g_MinBlockSize);
+            if (offset == BuddyAllocator::s_InvalidOffset)
+            {
+                ++numFailed;
+                continue;
+            }
+            allocations.push_back({ offset, size });
+            requestedSize += size;
+            committedSize += (size + g_CommittedAlignment - 1) / g_CommittedAlignment * g_CommittedAlignment;
+            ++numAllocations;
+        }
+        else
+        {
+            size_t index = random() % allocations.size();
+            const Allocation& allocation = allocations[index];
+            allocator.Free(allocation.m_Offset);
+            requestedSize -= allocation.m_Size;
+            committedSize -= (allocation.m_Size + g_CommittedAlignment - 1) / g_CommittedAlignment * g_CommittedAlignment;
+            allocations[index] = allocations.back();
+            allocations.pop_back();
+        }
+
+        sumRequested += static_cast<double>(requestedSize);
+        sumAllocated += static_cast<double>(allocator.GetAllocatedSize());
+        sumCommitted += static_cast<double>(committedSize);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+
+    std::printf("%d operations, %llu allocations, %llu failed, %.1f ns per operation\n", g_NumOperations,
+        static_cast<unsigned long long>(numAllocations), static_cast<unsigned long long>(numFailed), nanoseconds / g_NumOperations);
+    std::printf("Average memory per requested byte: buddy blocks %.3f, committed resources %.3f\n",
+        sumAllocated / sumRequested, sumCommitted / sumRequested);
+    return 0;
+}
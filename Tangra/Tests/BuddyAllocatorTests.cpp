@@ -0,0 +1,175 @@
+#include "TestFramework.h"
+#include "BuddyAllocator.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEST(AllocationsSplitTheRangeFromTheStart)
+{
+    BuddyAllocator allocator(1024, 64);
+    CHECK(allocator.Allocate(64) == 0);
+    CHECK(allocator.Allocate(64) == 64);
+    CHECK(allocator.Allocate(128) == 128);
+    CHECK(allocator.Allocate(256) == 256);
+    CHECK(allocator.Allocate(512) == 512);
+    CHECK(allocator.GetAllocatedSize() == 1024);
+    CHECK(allocator.GetLargestFreeBlockSize() == 0);
+    CHECK(allocator.GetNumAllocations() == 5);
+}
+
+TEST(SizesAreRoundedUpToAPowerOfTwo)
+{
+    BuddyAllocator allocator(1024, 64);
+    uint64_t small = allocator.Allocate(1);
+    uint64_t odd = allocator.Allocate(65);
+    CHECK(small == 0);
+    CHECK(odd == 128);
+    CHECK(allocator.GetAllocatedSize() == 64 + 128);
+}
+
+TEST(FreedBuddiesMergeBackIntoTheWholeRange)
+{
+    BuddyAllocator allocator(1024, 64);
+    uint64_t a = allocator.Allocate(64);
+    uint64_t b = allocator.Allocate(64);
+    CHECK(allocator.GetLargestFreeBlockSize() == 512);
+
+    allocator.Free(a);
+    CHECK(allocator.GetLargestFreeBlockSize() == 512);
+    allocator.Free(b);
+    CHECK(allocator.GetLargestFreeBlockSize() == 1024);
+    CHECK(allocator.GetAllocatedSize() == 0);
+    CHECK(allocator.GetNumAllocations() == 0);
+
+    // The merged block can be handed out in one piece again
+    CHECK(allocator.Allocate(1024) == 0);
+}
+
+TEST(BlocksOnlyMergeWithTheirOwnBuddy)
+{
+    BuddyAllocator allocator(1024, 64);
+    uint64_t a = allocator.Allocate(64);
+    uint64_t b = allocator.Allocate(64);
+    uint64_t c = allocator.Allocate(64);
+    uint64_t d = allocator.Allocate(64);
+
+    // B and C are next to each other, but they belong to different pairs
+    allocator.Free(b);
+    allocator.Free(c);
+    CHECK(allocator.GetLargestFreeBlockSize() == 512);
+    CHECK(allocator.Allocate(128) == 256);
+
+    allocator.Free(a);
+    CHECK(allocator.Allocate(128) == 0);
+    allocator.Free(d);
+}
+
+TEST(AllocationsAreAligned)
+{
+    BuddyAllocator allocator(1 << 20, 256);
+    allocator.Allocate(256);
+    uint64_t aligned = allocator.Allocate(256, 65536);
+    CHECK(aligned != BuddyAllocator::s_InvalidOffset);
+    CHECK(aligned % 65536 == 0);
+
+    std::mt19937 random(7);
+    for (int i = 0; i < 100; i++)
+    {
+        uint64_t alignment = 256ull << (random() % 6);
+        uint64_t offset = allocator.Allocate(1 + random() % 4096, alignment);
+        if (offset != BuddyAllocator::s_InvalidOffset)
+        {
+            CHECK(offset % alignment == 0);
+        }
+    }
+}
+
+TEST(ExhaustionReturnsAnInvalidOffset)
+{
+    BuddyAllocator allocator(1024, 64);
+    CHECK(allocator.Allocate(2048) == BuddyAllocator::s_InvalidOffset);
+
+    for (int i = 0; i < 16; i++)
+    {
+        CHECK(allocator.Allocate(64) != BuddyAllocator::s_InvalidOffset);
+    }
+    CHECK(allocator.Allocate(64) == BuddyAllocator::s_InvalidOffset);
+
+    // Freeing one block makes room for exactly one more
+    allocator.Free(320);
+    CHECK(allocator.Allocate(64) == 320);
+    CHECK(allocator.Allocate(64) == BuddyAllocator::s_InvalidOffset);
+}
+
+TEST(FreeingInReverseOrderRestoresTheRange)
+{
+    BuddyAllocator allocator(1 << 16, 64);
+    std::vector<uint64_t> offsets;
+    for (uint64_t size = 64; size <= 4096; size *= 2)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            offsets.push_back(allocator.Allocate(size));
+        }
+    }
+
+    for (auto offset = offsets.rbegin(); offset != offsets.rend(); ++offset)
+    {
+        CHECK(*offset != BuddyAllocator::s_InvalidOffset);
+        allocator.Free(*offset);
+    }
+    CHECK(allocator.GetAllocatedSize() == 0);
+    CHECK(allocator.GetLargestFreeBlockSize() == allocator.GetSize());
+}
+
+TEST(FreeingInRandomOrderRestoresTheRange)
+{
+    BuddyAllocator allocator(1 << 20, 64);
+    std::mt19937 random(42);
+
+    std::vector<std::pair<uint64_t, uint64_t>> allocations;
+    for (int i = 0; i < 500; i++)
+    {
+        uint64_t size = 1 + random() % 8192;
+        uint64_t offset = allocator.Allocate(size);
+        if (offset != BuddyAllocator::s_InvalidOffset)
+        {
+            allocations.push_back({ offset, size });
+        }
+    }
+    CHECK(!allocations.empty());
+
+    // No two allocations overlap
+    std::vector<std::pair<uint64_t, uint64_t>> sorted = allocations;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 1; i < sorted.size(); i++)
+    {
+        CHECK(sorted[i - 1].first + sorted[i - 1].second <= sorted[i].first);
+    }
+
+    std::shuffle(allocations.begin(), allocations.end(), random);
+    for (const auto& allocation : allocations)
+    {
+        allocator.Free(allocation.first);
+    }
+    CHECK(allocator.GetAllocatedSize() == 0);
+    CHECK(allocator.GetNumAllocations() == 0);
+    CHECK(allocator.GetLargestFreeBlockSize() == allocator.GetSize());
+}
+
+TEST(FreeingAnUnknownOffsetIsIgnored)
+{
+    BuddyAllocator allocator(1024, 64);
+    uint64_t a = allocator.Allocate(64);
+    allocator.Free(512);
+    allocator.Free(a);
+    allocator.Free(a);
+    CHECK(allocator.GetAllocatedSize() == 0);
+    CHECK(allocator.GetLargestFreeBlockSize() == 1024);
+}
+
+int main()
+{
+    return RUN_TESTS();
+}
@@ -0,0 +1,138 @@
+#include "TestFramework.h"
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // Stands in for the direct queue's fence. The GPU runs behind the CPU and only finishes work when it gets around to it, or when the CPU waits.
+    struct FakeFence
+    {
+        uint64_t m_SignaledValue = 0;
+        uint64_t m_CompletedValue = 0;
+
+        uint64_t Signal() { return ++m_SignaledValue; }
+        void Wait(uint64_t a_FenceValue) { m_CompletedValue = std::max(m_CompletedValue, a_FenceValue); }
+        void Progress(uint64_t a_NumValues) { m_CompletedValue = std::min(m_SignaledValue, m_CompletedValue + a_NumValues); }
+    };
+
+    // Recycles the command allocators of the lists the same way CommandAllocatorPool does:
+    // they come back with the fence value of their submission and only the oldest is reused, once the fence has reached its value
+    struct FakeListPool
+    {
+        std::deque<std::pair<uint64_t, size_t>> m_InFlight;
+        size_t m_NumCreated = 0;
+
+        size_t Request(uint64_t a_CompletedFenceValue)
+        {
+            if (!m_InFlight.empty() && m_InFlight.front().first <= a_CompletedFenceValue)
+            {
+                size_t list = m_InFlight.front().second;
+                m_InFlight.pop_front();
+                return list;
+            }
+            return m_NumCreated++;
+        }
+
+        void Return(size_t a_List, uint64_t a_FenceValue) { m_InFlight.push_back({ a_FenceValue, a_List }); }
+    };
+
+    // Runs the frames the way Application::Render does and returns the number of lists the pool created.
+    // A pacer with 0 frames in flight stands for the loop without pacing, which never waits.
+    size_t RunFrames(size_t a_FramesInFlight, size_t a_ListsPerFrame, size_t a_NumFrames, uint64_t a_GpuSpeed, std::mt19937& a_Random)
+    {
+        FakeFence fence;
+        FakeListPool pool;
+        FramePacer pacer(std::max<size_t>(1, a_FramesInFlight));
+
+        for (size_t frame = 0; frame < a_NumFrames; frame++)
+        {
+            if (a_FramesInFlight != 0)
+            {
+                fence.Wait(pacer.BeginFrame());
+            }
+
+            std::vector<size_t> lists;
+            for (size_t i = 0; i < a_ListsPerFrame; i++)
+            {
+                lists.push_back(pool.Request(fence.m_CompletedValue));
+            }
+
+            uint64_t fenceValue = fence.Signal();
+            for (size_t list : lists)
+            {
+                pool.Return(list, fenceValue);
+            }
+            pacer.EndFrame(fenceValue);
+
+            fence.Progress(a_GpuSpeed == 0 ? 0 : a_Random() % (a_GpuSpeed + 1));
+        }
+        return pool.m_NumCreated;
+    }
+}
+
+TEST(TheFirstFramesDontWait)
+{
+    FramePacer pacer(3);
+    for (uint64_t frame = 1; frame <= 3; frame++)
+    {
+        CHECK(pacer.BeginFrame() == 0);
+        pacer.EndFrame(frame * 10);
+    }
+}
+
+TEST(AFrameWaitsForTheFrameWhichUsedItsContext)
+{
+    FramePacer pacer(2);
+    pacer.BeginFrame();
+    pacer.EndFrame(5);
+    pacer.BeginFrame();
+    pacer.EndFrame(8);
+
+    CHECK(pacer.BeginFrame() == 5);
+    pacer.EndFrame(9);
+    CHECK(pacer.BeginFrame() == 8);
+    pacer.EndFrame(12);
+    CHECK(pacer.BeginFrame() == 9);
+}
+
+TEST(AtLeastOneFrameIsInFlight)
+{
+    FramePacer pacer(0);
+    CHECK(pacer.GetFramesInFlight() == 1);
+    pacer.BeginFrame();
+    pacer.EndFrame(4);
+    CHECK(pacer.BeginFrame() == 4);
+}
+
+TEST(TheListPoolIsBoundedByTheFramesInFlight)
+{
+    std::mt19937 random(11);
+    for (size_t framesInFlight = 1; framesInFlight <= 4; framesInFlight++)
+    {
+        for (size_t listsPerFrame = 1; listsPerFrame <= 8; listsPerFrame *= 2)
+        {
+            // A GPU which never catches up on its own, and one which randomly falls behind
+            for (uint64_t gpuSpeed : { 0, 1, 2 })
+            {
+                size_t numLists = RunFrames(framesInFlight, listsPerFrame, 1000, gpuSpeed, random);
+                CHECK(numLists <= framesInFlight * listsPerFrame);
+            }
+        }
+    }
+}
+
+TEST(TheListPoolGrowsWithoutPacing)
+{
+    std::mt19937 random(11);
+    CHECK(RunFrames(0, 4, 1000, 0, random) == 4000);
+}
+
+int main()
+{
+    return RUN_TESTS();
+}
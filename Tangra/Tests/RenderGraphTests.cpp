@@ -0,0 +1,156 @@
+#include "TestFramework.h"
+#include "RenderGraph.h"
+
+#include <stdexcept>
+
+namespace
+{
+    using Usage = RenderGraph::ResourceUsage;
+
+    Usage Combine(Usage a_Left, Usage a_Right)
+    {
+        return static_cast<Usage>(static_cast<uint32_t>(a_Left) | static_cast<uint32_t>(a_Right));
+    }
+
+    // Returns the barriers of the step which belong to the resource
+    std::vector<RenderGraph::Barrier> GetBarriers(const RenderGraph::Step& a_Step, RenderGraph::ResourceHandle a_Resource)
+    {
+        std::vector<RenderGraph::Barrier> barriers;
+        for (const RenderGraph::Barrier& barrier : a_Step.m_Barriers)
+        {
+            if (barrier.m_Resource == a_Resource)
+            {
+                barriers.push_back(barrier);
+            }
+        }
+        return barriers;
+    }
+}
+
+TEST(PassesWithoutResultsAreCulled)
+{
+    RenderGraph graph;
+    RenderGraph::ResourceHandle backBuffer = graph.ImportResource("Back Buffer", Usage::Present, Usage::Present);
+    RenderGraph::ResourceHandle unused = graph.CreateResource("Unused");
+
+    graph.AddPass("Unused", RenderGraph::PassType::Graphics, nullptr).Write(unused, Usage::RenderTarget);
+    graph.AddPass("Draw", RenderGraph::PassType::Graphics, nullptr).Write(backBuffer, Usage::RenderTarget);
+
+    RenderGraph::Schedule schedule = graph.Compile();
+    CHECK(schedule.m_CulledPasses.size() == 1);
+    CHECK(schedule.m_CulledPasses[0] == 0);
+    CHECK(!schedule.m_ResourceLifetimes[unused].IsUsed());
+}
+
+TEST(ImportedResourcesEndInTheirFinalUsage)
+{
+    RenderGraph graph;
+    RenderGraph::ResourceHandle backBuffer = graph.ImportResource("Back Buffer", Usage::Present, Usage::Present);
+    graph.AddPass("Draw", RenderGraph::PassType::Graphics, nullptr).Write(backBuffer, Usage::RenderTarget);
+
+    RenderGraph::Schedule schedule = graph.Compile();
+    CHECK(schedule.m_Steps.size() == 2);
+    CHECK(schedule.m_NumBarriers == 2);
+
+    std::vector<RenderGraph::Barrier> first = GetBarriers(schedule.m_Steps[0], backBuffer);
+    CHECK(first.size() == 1 && first[0].m_Before == Usage::Present && first[0].m_After == Usage::RenderTarget);
+    std::vector<RenderGraph::Barrier> last = GetBarriers(schedule.m_Steps[1], backBuffer);
+    CHECK(schedule.m_Steps[1].m_Pass == RenderGraph::s_InvalidIndex);
+    CHECK(last.size() == 1 && last[0].m_Before == Usage::RenderTarget && last[0].m_After == Usage::Present);
+}
+
+TEST(UnorderedAccessAfterUnorderedAccessGetsAUAVBarrier)
+{
+    RenderGraph graph;
+    graph.SetAsyncComputeEnabled(false);
+    RenderGraph::ResourceHandle buffer = graph.ImportResource("Buffer", Usage::UnorderedAccess, Usage::UnorderedAccess);
+    graph.AddPass("First", RenderGraph::PassType::Compute, nullptr).Write(buffer, Usage::UnorderedAccess);
+    graph.AddPass("Second", RenderGraph::PassType::Compute, nullptr).Write(buffer, Usage::UnorderedAccess);
+
+    RenderGraph::Schedule schedule = graph.Compile();
+    CHECK(schedule.m_Steps.size() == 2);
+    CHECK(schedule.m_Steps[0].m_Barriers.empty());
+    CHECK(schedule.m_Steps[1].m_Barriers.size() == 1 && schedule.m_Steps[1].m_Barriers[0].IsUAVBarrier());
+}
+
+TEST(AsyncComputeWaitsForTheGraphicsQueue)
+{
+    RenderGraph graph;
+    RenderGraph::ResourceHandle backBuffer = graph.ImportResource("Back Buffer", Usage::Present, Usage::Present);
+    RenderGraph::ResourceHandle buffer = graph.CreateResource("Buffer");
+
+    graph.AddPass("Produce", RenderGraph::PassType::Graphics, nullptr).Write(buffer, Usage::CopyDest);
+    graph.AddPass("Process", RenderGraph::PassType::Compute, nullptr).Write(buffer, Usage::UnorderedAccess);
+    graph.AddPass("Consume", RenderGraph::PassType::Graphics, nullptr).Read(buffer, Usage::NonPixelShaderResource).Write(backBuffer, Usage::RenderTarget);
+
+    RenderGraph::Schedule schedule = graph.Compile();
+    CHECK(schedule.m_Steps[1].m_Queue == RenderGraph::QueueType::Compute);
+    CHECK(schedule.m_ResourceLifetimes[buffer].m_UsedOnCompute);
+
+    // The compute submission waits for the graphics one before it, and the graphics submission after it waits for the compute one
+    CHECK(schedule.m_Submissions.size() == 3);
+    CHECK(schedule.m_Submissions[1].m_Queue == RenderGraph::QueueType::Compute);
+    CHECK(schedule.m_Submissions[1].m_WaitForSubmissions.size() == 1 && schedule.m_Submissions[1].m_WaitForSubmissions[0] == 0);
+    CHECK(schedule.m_Submissions[2].m_WaitForSubmissions.size() == 1 && schedule.m_Submissions[2].m_WaitForSubmissions[0] == 1);
+}
+
+// Reading the same resource in two ways in one pass needs a single transition to both states, not two transitions from the same state
+TEST(ReadOnlyUsagesInAPassAreCombined)
+{
+    RenderGraph graph;
+    RenderGraph::ResourceHandle backBuffer = graph.ImportResource("Back Buffer", Usage::Present, Usage::Present);
+    RenderGraph::ResourceHandle texture = graph.ImportResource("Texture", Usage::CopyDest, Usage::CopyDest);
+
+    graph.AddPass("Draw", RenderGraph::PassType::Graphics, nullptr)
+        .Read(texture, Usage::PixelShaderResource)
+        .Read(texture, Usage::NonPixelShaderResource)
+        .Write(backBuffer, Usage::RenderTarget);
+
+    RenderGraph::Schedule schedule = graph.Compile();
+    Usage combined = Combine(Usage::PixelShaderResource, Usage::NonPixelShaderResource);
+    std::vector<RenderGraph::Barrier> barriers = GetBarriers(schedule.m_Steps[0], texture);
+    CHECK(barriers.size() == 1);
+    CHECK(barriers[0].m_Before == Usage::CopyDest && barriers[0].m_After == combined);
+
+    std::vector<RenderGraph::Barrier> finalBarriers = GetBarriers(schedule.m_Steps.back(), texture);
+    CHECK(finalBarriers.size() == 1 && finalBarriers[0].m_Before == combined && finalBarriers[0].m_After == Usage::CopyDest);
+
+    CHECK(RenderGraph::IsReadOnly(combined));
+    CHECK(!RenderGraph::IsComputeCompatible(combined));
+}
+
+TEST(RepeatedDeclarationsOfTheSameUsageAreMerged)
+{
+    RenderGraph graph;
+    RenderGraph::ResourceHandle backBuffer = graph.ImportResource("Back Buffer", Usage::Present, Usage::Present);
+
+    graph.AddPass("Draw", RenderGraph::PassType::Graphics, nullptr)
+        .Read(backBuffer, Usage::RenderTarget)
+        .Write(backBuffer, Usage::RenderTarget);
+
+    RenderGraph::Schedule schedule = graph.Compile();
+    // The write makes the pass live, and there is only one transition into the render target state
+    CHECK(schedule.m_CulledPasses.empty());
+    CHECK(GetBarriers(schedule.m_Steps[0], backBuffer).size() == 1);
+}
+
+TEST(ReadingAResourceThePassWritesThrows)
+{
+    RenderGraph graph;
+    RenderGraph::ResourceHandle texture = graph.CreateResource("Texture");
+
+    RenderGraph::PassBuilder pass = graph.AddPass("Draw", RenderGraph::PassType::Graphics, nullptr);
+    pass.Write(texture, Usage::RenderTarget);
+    CHECK_THROWS(pass.Read(texture, Usage::PixelShaderResource), std::runtime_error);
+    CHECK_THROWS(pass.Write(texture, Usage::UnorderedAccess), std::runtime_error);
+
+    RenderGraph::PassBuilder readPass = graph.AddPass("Read", RenderGraph::PassType::Graphics, nullptr);
+    readPass.Read(texture, Usage::PixelShaderResource);
+    CHECK_THROWS(readPass.Write(texture, Usage::CopyDest), std::runtime_error);
+    CHECK_THROWS(readPass.Read(texture, Usage::Present), std::runtime_error);
+}
+
+int main()
+{
+    return RUN_TESTS();
+}
@@ -0,0 +1,155 @@
+#include "TestFramework.h"
+#include "ResidencyPolicy.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const size_t g_DirectQueue = 0;
+    const size_t g_CopyQueue = 1;
+
+    bool Contains(const std::vector<ResidencyPolicy::ObjectId>& a_Objects, ResidencyPolicy::ObjectId a_Object)
+    {
+        return std::find(a_Objects.begin(), a_Objects.end(), a_Object) != a_Objects.end();
+    }
+}
+
+TEST(NothingIsEvictedWithinTheBudget)
+{
+    ResidencyPolicy policy(2);
+    policy.AddObject(100);
+    policy.AddObject(100);
+    CHECK(policy.SelectEvictions(200, 200, { 0, 0 }).empty());
+    CHECK(policy.GetResidentSize() == 200);
+}
+
+TEST(LeastRecentlyUsedObjectsAreEvictedFirst)
+{
+    ResidencyPolicy policy(2);
+    ResidencyPolicy::ObjectId a = policy.AddObject(100);
+    ResidencyPolicy::ObjectId b = policy.AddObject(100);
+    ResidencyPolicy::ObjectId c = policy.AddObject(100);
+    policy.MarkUsed(a, g_DirectQueue, 1);
+    policy.MarkUsed(c, g_DirectQueue, 2);
+
+    std::vector<ResidencyPolicy::ObjectId> evictions = policy.SelectEvictions(300, 150, { 2, 0 });
+    CHECK(evictions.size() == 2);
+    CHECK(evictions[0] == b);
+    CHECK(evictions[1] == a);
+    CHECK(!policy.IsResident(a));
+    CHECK(!policy.IsResident(b));
+    CHECK(policy.IsResident(c));
+    CHECK(policy.GetResidentSize() == 100);
+}
+
+TEST(ObjectsInUseOnAnyQueueAreNotEvicted)
+{
+    ResidencyPolicy policy(2);
+    ResidencyPolicy::ObjectId a = policy.AddObject(100);
+    ResidencyPolicy::ObjectId b = policy.AddObject(100);
+    policy.MarkUsed(a, g_DirectQueue, 5);
+    policy.MarkUsed(a, g_CopyQueue, 3);
+    policy.MarkUsed(b, g_DirectQueue, 6);
+
+    // The direct queue is done with A, but the copy queue isn't
+    std::vector<ResidencyPolicy::ObjectId> evictions = policy.SelectEvictions(200, 0, { 5, 2 });
+    CHECK(evictions.empty());
+
+    evictions = policy.SelectEvictions(200, 0, { 5, 3 });
+    CHECK(evictions.size() == 1);
+    CHECK(evictions[0] == a);
+}
+
+TEST(PendingUsesBlockEvictionUntilTheyAreSubmitted)
+{
+    ResidencyPolicy policy(2);
+    ResidencyPolicy::ObjectId a = policy.AddObject(100);
+    policy.MarkUsed(a, g_DirectQueue, ResidencyPolicy::s_PendingFenceValue);
+    CHECK(policy.SelectEvictions(100, 0, { 1000, 1000 }).empty());
+
+    // A submission which fails marks the objects with the last fence value of the queue, so they don't stay pending forever
+    policy.MarkUsed(a, g_DirectQueue, 10);
+    CHECK(policy.SelectEvictions(100, 0, { 9, 0 }).empty());
+    CHECK(policy.SelectEvictions(100, 0, { 10, 0 }).size() == 1);
+}
+
+TEST(EvictedObjectsCountAgainOnceResident)
+{
+    ResidencyPolicy policy(1);
+    ResidencyPolicy::ObjectId a = policy.AddObject(100);
+    policy.SelectEvictions(100, 0, { 0 });
+    CHECK(policy.GetResidentSize() == 0);
+
+    policy.SetResident(a, true);
+    policy.SetResident(a, true);
+    CHECK(policy.GetResidentSize() == 100);
+
+    policy.RemoveObject(a);
+    CHECK(policy.GetResidentSize() == 0);
+    CHECK(policy.GetNumObjects() == 0);
+}
+
+// Runs frames which each use a random part of a working set that is larger than the budget, the way ResidencyManager drives the policy.
+// The GPU runs two frames behind, so memory used by the last two frames can't be evicted.
+TEST(SimulatedBudgetKeepsTheUsageWithinTheBudget)
+{
+    const uint64_t objectSize = 64;
+    const size_t numObjects = 64;
+    const size_t objectsPerFrame = 8;
+    const uint64_t budget = objectSize * 32;
+    const uint64_t framesInFlight = 2;
+    CHECK(objectSize * objectsPerFrame * (framesInFlight + 1) <= budget);
+
+    ResidencyPolicy policy(1);
+    std::vector<ResidencyPolicy::ObjectId> objects;
+    for (size_t i = 0; i < numObjects; i++)
+    {
+        objects.push_back(policy.AddObject(objectSize));
+    }
+
+    std::mt19937 random(3);
+    uint64_t numEvictions = 0;
+    uint64_t numMakeResidents = 0;
+    for (uint64_t frame = 1; frame <= 200; frame++)
+    {
+        uint64_t completedFrame = frame > framesInFlight ? frame - framesInFlight : 0;
+
+        std::vector<ResidencyPolicy::ObjectId> used;
+        std::sample(objects.begin(), objects.end(), std::back_inserter(used), objectsPerFrame, random);
+        for (ResidencyPolicy::ObjectId object : used)
+        {
+            policy.MarkUsed(object, 0, ResidencyPolicy::s_PendingFenceValue);
+            if (!policy.IsResident(object))
+            {
+                policy.SetResident(object, true);
+                ++numMakeResidents;
+            }
+        }
+
+        // The worker runs while the frame is being submitted, so the frame's own objects must survive it
+        std::vector<ResidencyPolicy::ObjectId> evictions = policy.SelectEvictions(policy.GetResidentSize(), budget, { completedFrame });
+        for (ResidencyPolicy::ObjectId object : used)
+        {
+            CHECK(!Contains(evictions, object));
+        }
+        numEvictions += evictions.size();
+
+        for (ResidencyPolicy::ObjectId object : used)
+        {
+            policy.MarkUsed(object, 0, frame);
+        }
+
+        // The frames in flight use less memory than the budget, so there is always enough idle memory to evict
+        CHECK(policy.GetResidentSize() <= budget);
+    }
+
+    CHECK(numEvictions > 0);
+    CHECK(numMakeResidents > 0);
+}
+
+int main()
+{
+    return RUN_TESTS();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal test framework. Every test file defines its tests with TEST and runs them with RUN_TESTS in main.
+// A failed CHECK reports the location and fails the test, but the remaining tests still run.
+
+namespace TestFramework
+{
+    struct Test
+    {
+        const char* m_Name;
+        std::function<void()> m_Function;
+    };
+
+    inline std::vector<Test>& GetTests()
+    {
+        static std::vector<Test> s_Tests;
+        return s_Tests;
+    }
+
+    inline int& GetNumFailedChecks()
+    {
+        static int s_NumFailedChecks = 0;
+        return s_NumFailedChecks;
+    }
+
+    struct Registration
+    {
+        Registration(const char* a_Name, std::function<void()> a_Function)
+        {
+            GetTests().push_back({ a_Name, a_Function });
+        }
+    };
+
+    inline void ReportFailure(const char* a_Expression, const char* a_File, int a_Line)
+    {
+        std::printf("%s(%d): check failed: %s\n", a_File, a_Line, a_Expression);
+        GetNumFailedChecks()++;
+    }
+
+    inline int RunTests()
+    {
+        int numFailedTests = 0;
+        for (const Test& test : GetTests())
+        {
+            int failedBefore = GetNumFailedChecks();
+            try
+            {
+                test.m_Function();
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("%s: unexpected exception: %s\n", test.m_Name, e.what());
+                GetNumFailedChecks()++;
+            }
+
+            bool passed = GetNumFailedChecks() == failedBefore;
+            std::printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.m_Name);
+            numFailedTests += passed ? 0 : 1;
+        }
+        std::printf("%zu tests, %d failed\n", GetTests().size(), numFailedTests);
+        return numFailedTests == 0 ? 0 : 1;
+    }
+}
+
+#define TEST(a_Name) \
+    static void a_Name(); \
+    static TestFramework::Registration s_Registration##a_Name(#a_Name, a_Name); \
+    static void a_Name()
+
+#define CHECK(a_Expression) \
+    do { if (!(a_Expression)) { TestFramework::ReportFailure(#a_Expression, __FILE__, __LINE__); } } while (false)
+
+// Checks that the expression throws an exception of the given type
+#define CHECK_THROWS(a_Expression, a_Exception) \
+    do { bool thrown = false; try { a_Expression; } catch (const a_Exception&) { thrown = true; } \
+        if (!thrown) { TestFramework::ReportFailure(#a_Expression " throws " #a_Exception, __FILE__, __LINE__); } } while (false)
+
+#define RUN_TESTS() TestFramework::RunTests()